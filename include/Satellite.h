@@ -3,9 +3,19 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <stdexcept>
 
+#include "earth_orientation.h"
+#include "environment.h"
+#include "epoch.h"
+#include "ephemeris.h"
+#include "geomagnetic_field.h"
+#include "schedule.h"
+#include "sgp4.h"
+#include "thrust_curve.h"
+
 // Define constants
 const double G =
     6.674 *
@@ -14,9 +24,27 @@ const double mass_Earth =
     5.9722 * pow(10, 24);  // https://en.wikipedia.org/wiki/Earth_mass
 const double radius_Earth =
     6378137;  // https://en.wikipedia.org/wiki/Earth_radius
+const double standard_gravity =
+    9.80665;  // https://en.wikipedia.org/wiki/Standard_gravity
+const double J2_Earth =
+    1.083 * pow(10, -3);  // https://en.wikipedia.org/wiki/Geopotential_model
 
 using json = nlohmann::json;
 
+// Terms which can make up the force model used for a satellite's orbital
+// motion. See force_model.h for how a list of these is turned into the
+// acceleration function used during time evolution
+enum class ForceTerm {
+  central_body,
+  J2,
+  atmospheric_drag,
+  thrust,
+  third_body,
+  solar_radiation_pressure
+};
+
+class ForceModelContext;
+
 class ThrustProfileLVLH {
   // Note: for now, thrust forces are assumed to act through center of mass of
   // satellite.
@@ -24,6 +52,9 @@ class ThrustProfileLVLH {
   double t_start_ = {0};
   double t_end_ = {0};
   std::array<double, 3> LVLH_force_vec_ = {0, 0, 0};
+  // Specific impulse of the thruster, in s. A value of 0 means the profile
+  // doesn't consume propellant, so the satellite's mass is left unchanged
+  double Isp_ = {0};
   ThrustProfileLVLH(const double t_start, const double t_end,
                     const std::array<double, 3> LVLH_force_vec) {
     t_start_ = t_start;
@@ -33,20 +64,35 @@ class ThrustProfileLVLH {
   ThrustProfileLVLH(
       const double t_start, const double t_end,
       const std::array<double, 3> LVLH_normalized_force_direction_vec,
-      const double input_force_magnitude) {
+      const double input_force_magnitude, const double input_Isp = 0) {
     t_start_ = t_start;
     t_end_ = t_end;
     for (size_t ind = 0; ind < 3; ind++) {
       LVLH_force_vec_.at(ind) =
           input_force_magnitude * LVLH_normalized_force_direction_vec.at(ind);
     }
+    Isp_ = input_Isp;
   }
 
-  bool operator==(const ThrustProfileLVLH& input_profile) {
+  // Rate at which propellant is consumed while this profile is active, in
+  // kg/s. Ref: https://en.wikipedia.org/wiki/Specific_impulse
+  double calculate_mass_flow_rate() const {
+    if (Isp_ <= 0) {
+      return 0;
+    }
+    double force_magnitude =
+        sqrt(LVLH_force_vec_.at(0) * LVLH_force_vec_.at(0) +
+             LVLH_force_vec_.at(1) * LVLH_force_vec_.at(1) +
+             LVLH_force_vec_.at(2) * LVLH_force_vec_.at(2));
+    return force_magnitude / (Isp_ * standard_gravity);
+  }
+
+  bool operator==(const ThrustProfileLVLH& input_profile) const {
     return ((t_start_ == input_profile.t_start_) &&
             (t_end_ == input_profile.t_end_) &&
             (std::equal(LVLH_force_vec_.begin(), LVLH_force_vec_.end(),
-                        input_profile.LVLH_force_vec_.begin())));
+                        input_profile.LVLH_force_vec_.begin())) &&
+            (Isp_ == input_profile.Isp_));
   }
 };
 
@@ -72,7 +118,7 @@ class BodyframeTorqueProfile {
           input_torque_magnitude * bodyframe_normalized_torque_axis_vec.at(ind);
     }
   }
-  bool operator==(const BodyframeTorqueProfile& input_profile) {
+  bool operator==(const BodyframeTorqueProfile& input_profile) const {
     return (
         (t_start_ == input_profile.t_start_) &&
         (t_end_ == input_profile.t_end_) &&
@@ -81,6 +127,116 @@ class BodyframeTorqueProfile {
   }
 };
 
+// Frame in which an impulsive maneuver's delta-v is specified
+enum class ManeuverFrame { LVLH, ECI };
+
+class ImpulsiveManeuver {
+  // Instantaneous change in velocity at a given time. Time evolution stops
+  // exactly at the maneuver time, applies the delta-v, and then resumes,
+  // rather than resolving a very short, very high-thrust burn
+ public:
+  double t_maneuver_ = {0};
+  std::array<double, 3> delta_v_vec_ = {0, 0, 0};
+  ManeuverFrame frame_ = ManeuverFrame::LVLH;
+  // Specific impulse of the thruster, in s. A value of 0 means the maneuver
+  // doesn't consume propellant
+  double Isp_ = {0};
+  ImpulsiveManeuver(const double t_maneuver,
+                    const std::array<double, 3> delta_v_vec,
+                    const ManeuverFrame frame = ManeuverFrame::LVLH,
+                    const double input_Isp = 0) {
+    t_maneuver_ = t_maneuver;
+    delta_v_vec_ = delta_v_vec;
+    frame_ = frame;
+    Isp_ = input_Isp;
+  }
+
+  // Mass remaining after the maneuver, from the Tsiolkovsky rocket equation.
+  // Ref: https://en.wikipedia.org/wiki/Tsiolkovsky_rocket_equation
+  double calculate_final_mass(const double input_initial_mass) const {
+    if (Isp_ <= 0) {
+      return input_initial_mass;
+    }
+    double delta_v_magnitude = sqrt(delta_v_vec_.at(0) * delta_v_vec_.at(0) +
+                                    delta_v_vec_.at(1) * delta_v_vec_.at(1) +
+                                    delta_v_vec_.at(2) * delta_v_vec_.at(2));
+    return input_initial_mass *
+           exp(-delta_v_magnitude / (Isp_ * standard_gravity));
+  }
+};
+
+class ForceModelFidelitySwitch {
+  // Automatically drops optional force terms (J2, atmospheric drag, Sun/Moon
+  // third-body, SRP) while their estimated acceleration at the satellite's
+  // current altitude is below an error budget, so that e.g. a satellite on an
+  // eccentric orbit only pays for drag and J2 near perigee. Which terms are
+  // dropped is updated at the start of each time step. A term is only dropped
+  // once its estimate falls below hysteresis_ratio_ times the budget, and is
+  // re-enabled once the estimate rises back above the budget, so satellites
+  // near a crossover altitude don't switch back and forth every step
+ public:
+  // In m/s^2. A budget of 0 turns off automatic switching
+  double error_budget_ = {0};
+  double hysteresis_ratio_ = {0.5};
+  // Bits (see force_term_bit) of the terms currently dropped
+  unsigned int disabled_force_term_mask_ = {0};
+
+  // Updates which terms are dropped from their estimated accelerations at the
+  // given state, then returns input_force_term_mask without them
+  unsigned int select_force_terms(
+      const unsigned int input_force_term_mask,
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& input_velocity_vec,
+      const double input_evaluation_time, ForceModelContext& input_context);
+};
+
+class InertiaTensor {
+  // Symmetric, positive definite inertia tensor (kg*m^2, body frame). The
+  // inverse is computed once when the tensor is set, since the attitude
+  // dynamics need J^-1 at every RK stage. Diagonal tensors (principal axes
+  // aligned with the body frame) are detected automatically and use
+  // componentwise products instead of matrix products
+ public:
+  Matrix3d J_matrix_ = Matrix3d::Identity();
+  Matrix3d inverse_J_matrix_ = Matrix3d::Identity();
+  bool is_diagonal_ = true;
+
+  InertiaTensor(const Matrix3d input_J_matrix = Matrix3d::Identity());
+
+  // J v
+  Eigen::Vector3d multiply(const Eigen::Vector3d& input_vec) const {
+    if (is_diagonal_) {
+      return J_matrix_.diagonal().cwiseProduct(input_vec);
+    }
+    return J_matrix_ * input_vec;
+  }
+  // J^-1 v
+  Eigen::Vector3d solve(const Eigen::Vector3d& input_vec) const {
+    if (is_diagonal_) {
+      return input_vec.cwiseQuotient(J_matrix_.diagonal());
+    }
+    return inverse_J_matrix_ * input_vec;
+  }
+};
+
+// Initial orbital elements and basic properties of a satellite, for setting
+// satellites up in memory rather than from an input file. Units and defaults
+// are as for the corresponding input file fields; everything else a
+// satellite has can be set afterwards through its setters
+struct SatelliteElements {
+  std::string name = "";
+  double semimajor_axis = {0};  // km
+  double eccentricity = {0};
+  double inclination = {0};       // deg
+  double raan = {0};              // deg
+  double arg_of_periapsis = {0};  // deg
+  double true_anomaly = {0};      // deg
+  double mass = {1};              // kg
+  AbsoluteEpoch epoch;  // Defaults to J2000
+  bool include_precession_nutation = false;
+  std::string plotting_color = "";
+};
+
 class Satellite {
  private:
   double inclination_ = {0};
@@ -94,29 +250,61 @@ class Satellite {
   double orbital_period_ = {0};
   double m_ = {1};  // default value to prevent infinities in acceleration
                     // calculations from a=F/m
+  // Mass of the satellite without propellant. Thrust profiles and curves
+  // with a nonzero Isp cut out once m_ reaches this, and need it to be set
+  double dry_mass_ = {0};
   // double I_={1}; //moment of inertia, taken to be same for all 3 principal
   // axes, set to default value for same reasons as mass
   double t_ = {0};
+  // Absolute time corresponding to t_ = 0
+  AbsoluteEpoch epoch_;
+  // Time and the orbital, angular velocity and mass components of the state
+  // are accumulated over the time steps with compensated summation (see
+  // add_compensated in utils.h) while this is enabled, so that rounding
+  // error doesn't build up with the number of steps. The compensation terms
+  // hold what has been lost to rounding so far, with the state ones in the
+  // order of the combined RK45 state in evolve_RK45_with_force_model
+  bool compensated_summation_enabled_ = true;
+  double t_compensation_ = {0};
+  std::array<double, 13> state_compensation_ = {0};
+  // If enabled, time is accumulated as whole seconds plus a fraction of a
+  // second (with t_compensation_ applying to the fraction while compensated
+  // summation is enabled), so its resolution doesn't depend on how long the
+  // run is. t_ is then the rounded sum of the two
+  bool split_time_enabled_ = false;
+  int64_t t_whole_seconds_ = {0};
+  double t_fraction_ = {0};
 
   double orbital_rate_ = {0};
   double orbital_angular_acceleration_ = {0};  // Time derivative of orbital
                                                // rate
 
   // Now body-frame attributes
-  // Assuming diagonal J matrix
-  double J_11_ = {1};
-  double J_22_ = {1};
-  double J_33_ = {1};
+  InertiaTensor inertia_tensor_;
   // The following angles are angles of the satellite body frame with respect to
   // the LVLH frame, represented in the body frame
   double pitch_angle_ = {0};
   double roll_angle_ = {0};
   double yaw_angle_ = {0};
 
+  // Orbital elements (along with the perifocal position and velocity), the
+  // orbit rate and the Tait-Bryan angles are derived from the ECI state and
+  // the attitude quaternion. Time evolution only marks them as stale, and
+  // they're recomputed the next time they're read
+  bool orbital_elements_stale_ = false;
+  bool orbit_rate_stale_ = false;
+  bool attitude_angles_stale_ = false;
+
   // For atmospheric drag calculations
   // Surface area of satellite assumed to face drag conditions
   double A_s_ = {0};
 
+  // For solar radiation pressure calculations
+  // Surface area of satellite assumed to face the Sun, and its radiation
+  // pressure coefficient
+  double A_srp_ = {0};
+  double C_R_ = {1.3};
+
   // body-frame angular velocities relative to the LVLH frame, represented in
   // the body frame
   std::array<double, 3> body_angular_velocity_vec_wrt_LVLH_in_body_frame_ = {
@@ -130,6 +318,10 @@ class Satellite {
 
   std::array<double, 3> perifocal_position_ = {0, 0, 0};
   std::array<double, 3> perifocal_velocity_ = {0, 0, 0};
+  // Rotation from the perifocal frame to ECI, and the RAAN, inclination and
+  // argument of periapsis it was built from
+  Matrix3d perifocal_to_ECI_matrix_ = Matrix3d::Identity();
+  std::array<double, 3> perifocal_to_ECI_angles_ = {NAN, NAN, NAN};
 
   std::array<double, 3> ECI_position_ = {0, 0, 0};
   std::array<double, 3> ECI_velocity_ = {0, 0, 0};
@@ -137,6 +329,37 @@ class Satellite {
   std::vector<ThrustProfileLVLH> thrust_profile_list_ = {};
   std::vector<BodyframeTorqueProfile> bodyframe_torque_profile_list_ = {};
 
+  // The above profiles compiled into timelines of summed LVLH force (plus
+  // propellant mass flow rate as the 4th component) and bodyframe torque,
+  // which is what's looked up during time evolution
+  PiecewiseConstantSchedule<4> thrust_schedule_LVLH_;
+  // Thrust with time-varying magnitude and direction, from tabulated or
+  // spline knots
+  std::vector<ThrustCurveLVLH> thrust_curve_list_ = {};
+  PiecewiseConstantSchedule<3> bodyframe_torque_schedule_;
+
+  // Magnetic dipole (A*m^2, body frame) commanded from the magnetorquers over
+  // time, plus the satellite's permanent residual dipole. Both produce a
+  // torque through the geomagnetic field
+  PiecewiseConstantSchedule<3> magnetorquer_dipole_schedule_;
+  std::array<double, 3> residual_magnetic_dipole_ = {0, 0, 0};
+  // Field model, shared between copies of a Satellite object
+  std::shared_ptr<GeomagneticField> geomagnetic_field_;
+
+  // Gravity-gradient torque, and the offset of the center of pressure from
+  // the center of mass (in m, body frame) used for the aerodynamic torque
+  bool gravity_gradient_torque_enabled_ = false;
+  std::array<double, 3> center_of_pressure_offset_ = {0, 0, 0};
+
+  ForceModelFidelitySwitch force_model_fidelity_switch_;
+
+  // Impulsive maneuvers, sorted by time, and the index of the first one which
+  // hasn't been applied yet
+  std::vector<ImpulsiveManeuver> impulsive_maneuver_list_ = {};
+  size_t next_impulsive_maneuver_index_ = {0};
+  // Scheduled times (in s) of maneuvers skipped for lack of propellant
+  std::vector<double> skipped_impulsive_maneuver_times_ = {};
+
   std::vector<std::array<double, 3>> list_of_LVLH_forces_at_this_time_ = {};
   std::vector<std::array<double, 3>> list_of_ECI_forces_at_this_time_ = {};
   std::vector<std::array<double, 3>> list_of_body_frame_torques_at_this_time_ =
@@ -145,10 +368,59 @@ class Satellite {
   double drag_surface_area = {0};  // Surface area of satellite used for
   // atmospheric drag calculations
 
+  // Sun and Moon positions, rotation between the ECI and Earth-fixed frames
+  // and space weather, cached per evaluation time. Copies of a Satellite
+  // object share the same cache, and it can be shared between satellites with
+  // the same epoch (see share_environment in utils.h)
+  std::shared_ptr<EnvironmentCache> environment_;
+
+  // For satellites set up from a TLE: the SGP4 propagator holding its element
+  // set (shared between the satellites loaded from the same TLE file), and
+  // whether evolve_RK45 uses it in place of numerical integration
+  std::shared_ptr<const SGP4Propagator> SGP4_propagator_;
+  size_t SGP4_element_set_index_ = {0};
+  bool SGP4_propagation_enabled_ = false;
+
   std::pair<double, double> calculate_eccentric_anomaly(
       const double input_eccentricity, const double input_true_anomaly,
       const double input_semimajor_axis);
   void initialize_body_angular_velocity_vec_wrt_LVLH_in_body_frame();
+  void check_dry_mass_for_Isp(const double input_Isp) const;
+  void add_thrust_profile_to_schedule(
+      const ThrustProfileLVLH input_thrust_profile);
+  template <typename OrbitalForceModel>
+  std::pair<double, int> evolve_RK45_with_force_model(
+      const double input_epsilon, const double input_initial_timestep,
+      ForceModelContext& input_force_model_context);
+  std::pair<double, int> evolve_RK45_with_force_terms(
+      const double input_epsilon, const double input_initial_timestep,
+      const std::vector<ForceTerm>& input_force_terms,
+      std::pair<double, double> drag_elements);
+  void apply_impulsive_maneuver(const ImpulsiveManeuver input_maneuver);
+  void mark_orbital_state_changed() {
+    orbital_elements_stale_ = true;
+    orbit_rate_stale_ = true;
+  }
+  void refresh_orbital_elements() {
+    if (orbital_elements_stale_) {
+      update_orbital_elements_from_position_and_velocity();
+    }
+  }
+  int check_state_validity();
+  void refresh_orbit_rate();
+  void refresh_attitude_angles();
+  const Matrix3d& get_perifocal_to_ECI_matrix();
+  void update_ECI_state(const std::array<double, 3>& input_position,
+                        const std::array<double, 3>& input_velocity);
+  void advance_time(const double input_timestep);
+  void set_time(const double input_time);
+  // SGP4 position and velocity at input_time, converted from TEME to the ECI
+  // frame. Returns the SGP4 error code
+  int calculate_SGP4_ECI_state(const double input_time,
+                               std::array<double, 3>& output_ECI_position,
+                               std::array<double, 3>& output_ECI_velocity);
+  // Only used before setting the satellite up, e.g. from an input file
+  Satellite() {}
 
  public:
   std::string plotting_color_ = "";
@@ -158,8 +430,37 @@ class Satellite {
     // units of degrees, then internally translated to radians
     std::ifstream input_filestream(input_file_name);
     json input_data = json::parse(input_filestream);
-
-    inclination_ = input_data.at("Inclination");
+    initialize_from_JSON(input_data);
+  }
+  // From elements held in memory, without an input file, e.g. when generating
+  // a constellation (see constellation.h)
+  explicit Satellite(const SatelliteElements& input_elements) {
+    initialize_from_elements(input_elements);
+  }
+  // From the contents of an input file which have already been parsed, e.g.
+  // one entry of a catalog (see catalog.h)
+  static Satellite from_JSON(const json& input_data) {
+    Satellite new_satellite;
+    new_satellite.initialize_from_JSON(input_data);
+    return new_satellite;
+  }
+  // From element set input_element_set_index of an SGP4 propagator (see
+  // sgp4.h). The epoch is the TLE epoch, the initial state is the SGP4 state
+  // there and the mass is 1 kg, since TLEs don't hold one. SGP4 propagation
+  // is enabled, see set_SGP4_propagation
+  static Satellite from_TLE(
+      std::shared_ptr<const SGP4Propagator> input_SGP4_propagator,
+      const size_t input_element_set_index = 0);
+  static Satellite from_TLE(const TwoLineElementSet& input_element_set) {
+    return from_TLE(std::make_shared<const SGP4Propagator>(
+        std::vector<TwoLineElementSet>{input_element_set}));
+  }
+ private:
+  // Sets the satellite up from its elements, with every other property at
+  // its default. Roll, pitch and yaw angles which have already been set are
+  // used for the initial attitude
+  void initialize_from_elements(const SatelliteElements& input_elements) {
+    inclination_ = input_elements.inclination;
     // convert to radians
     inclination_ *= (M_PI / 180.0);
     if (inclination_ == 0) {
@@ -167,28 +468,100 @@ class Satellite {
           "Zero inclination orbits are not currently supported");
     }
 
-    raan_ = input_data.at("RAAN");
+    raan_ = input_elements.raan;
     // convert to radians
     raan_ *= (M_PI / 180.0);
 
-    arg_of_periapsis_ = input_data.at("Argument of Periapsis");
+    arg_of_periapsis_ = input_elements.arg_of_periapsis;
     // convert to radians
     arg_of_periapsis_ *= (M_PI / 180.0);
 
-    eccentricity_ = input_data.at("Eccentricity");
+    eccentricity_ = input_elements.eccentricity;
     // If circular orbit, arg of periapsis is undefined, using convention of
     // setting it to 0 in this case
     if (eccentricity_ == 0) {
       arg_of_periapsis_ = 0;
     }
 
-    a_ = input_data.at("Semimajor Axis");
+    a_ = input_elements.semimajor_axis;
     a_ *= 1000.0;  // converting from km to m
 
-    true_anomaly_ = input_data.at("True Anomaly");
+    true_anomaly_ = input_elements.true_anomaly;
     // convert to radians
     true_anomaly_ *= (M_PI / 180.0);
 
+    initialize_and_normalize_body_quaternion(roll_angle_, pitch_angle_,
+                                             yaw_angle_);
+
+    m_ = input_elements.mass;
+    name_ = input_elements.name;
+    plotting_color_ = input_elements.plotting_color;
+
+    geomagnetic_field_ = std::make_shared<GeomagneticField>();
+
+    // t_ is measured from the satellite's own epoch
+    t_ = 0;
+    epoch_ = input_elements.epoch;
+
+    // The epoch (Julian date corresponding to t=0) is used for Sun and Moon
+    // positions and the ECI to Earth-fixed transformation
+    environment_ = std::make_shared<EnvironmentCache>(
+        std::make_shared<SunMoonEphemeris>(
+            input_elements.epoch.get_julian_date()),
+        std::make_shared<EarthOrientation>(
+            input_elements.epoch.get_julian_date(),
+            input_elements.include_precession_nutation));
+
+    orbital_period_ = calculate_orbital_period();
+
+    // updated workflow
+    perifocal_position_ = calculate_perifocal_position();
+    perifocal_velocity_ = calculate_perifocal_velocity();
+
+    ECI_position_ = convert_perifocal_to_ECI(perifocal_position_);
+    ECI_velocity_ = convert_perifocal_to_ECI(perifocal_velocity_);
+
+    orbital_rate_ = calculate_instantaneous_orbit_rate();
+    initialize_body_angular_velocity_vec_wrt_LVLH_in_body_frame();
+
+    orbital_angular_acceleration_ =
+        calculate_instantaneous_orbit_angular_acceleration();
+  }
+
+  // Sets the satellite up from the fields of an input file
+  void initialize_from_JSON(const json& input_data) {
+    SatelliteElements elements;
+    elements.inclination = input_data.at("Inclination");
+    elements.raan = input_data.at("RAAN");
+    elements.arg_of_periapsis = input_data.at("Argument of Periapsis");
+    elements.eccentricity = input_data.at("Eccentricity");
+    elements.semimajor_axis = input_data.at("Semimajor Axis");
+    elements.true_anomaly = input_data.at("True Anomaly");
+    elements.mass = input_data.at("Mass");
+    elements.name = input_data.at("Name");
+
+    // Making plotting color an optional parameter
+    if (input_data.find("Plotting Color") != input_data.end()) {
+      elements.plotting_color = input_data.at("Plotting Color");
+    }
+    // Making the epoch (corresponding to t=0) an optional parameter, given
+    // either as a Julian date or, to keep full precision, as a whole Julian
+    // day number and the seconds into that day. Defaults to J2000
+    if (input_data.find("Epoch") != input_data.end()) {
+      const json& epoch_data = input_data.at("Epoch");
+      if (epoch_data.is_array()) {
+        elements.epoch = AbsoluteEpoch(epoch_data.at(0), epoch_data.at(1));
+      } else {
+        elements.epoch = AbsoluteEpoch::from_julian_date(epoch_data);
+      }
+    }
+    // Making precession and nutation (on top of the Earth's rotation) in the
+    // ECI to Earth-fixed transformation an optional parameter
+    if (input_data.find("Precession Nutation") != input_data.end()) {
+      elements.include_precession_nutation =
+          input_data.at("Precession Nutation");
+    }
+
     // making initial pitch angle an optional parameter
     if (input_data.find("Initial Pitch Angle") != input_data.end()) {
       pitch_angle_ = input_data.at("Initial Pitch Angle");
@@ -208,15 +581,15 @@ class Satellite {
       yaw_angle_ *= (M_PI / 180.0);
     }
 
-    initialize_and_normalize_body_quaternion(roll_angle_, pitch_angle_,
-                                             yaw_angle_);
-
-    m_ = input_data.at("Mass");
-    name_ = input_data.at("Name");
+    initialize_from_elements(elements);
 
-    // Making plotting color an optional parameter
-    if (input_data.find("Plotting Color") != input_data.end()) {
-      plotting_color_ = input_data.at("Plotting Color");
+    // Making the dry mass (used to stop propellant-consuming thrust once the
+    // propellant runs out) an optional parameter
+    if (input_data.find("Dry Mass") != input_data.end()) {
+      dry_mass_ = input_data.at("Dry Mass");
+      if (dry_mass_ <= 0) {
+        throw std::invalid_argument("\"Dry Mass\" must be positive");
+      }
     }
 
     // Making satellite surface area facing drag conditions an optional
@@ -224,20 +597,61 @@ class Satellite {
     if (input_data.find("A_s") != input_data.end()) {
       A_s_ = input_data.at("A_s");
     }
+    // Making the area used for solar radiation pressure an optional
+    // parameter, defaulting to the drag area
+    A_srp_ = A_s_;
+    if (input_data.find("SRP Area") != input_data.end()) {
+      A_srp_ = input_data.at("SRP Area");
+    }
+    if (input_data.find("C_R") != input_data.end()) {
+      C_R_ = input_data.at("C_R");
+    }
+    // Making the acceleration error budget (in m/s^2) used to automatically
+    // drop negligible force terms an optional parameter
+    if (input_data.find("Force Model Error Budget") != input_data.end()) {
+      set_force_model_error_budget(input_data.at("Force Model Error Budget"));
+    }
 
-    t_ = 0;  // for now, assuming satellites are initialized at time t=0;
-
-    orbital_period_ = calculate_orbital_period();
-
-    // updated workflow
-    perifocal_position_ = calculate_perifocal_position();
-    perifocal_velocity_ = calculate_perifocal_velocity();
-
-    ECI_position_ = convert_perifocal_to_ECI(perifocal_position_);
-    ECI_velocity_ = convert_perifocal_to_ECI(perifocal_velocity_);
+    // Making the residual magnetic dipole (in A*m^2, body frame) and the
+    // degree of the geomagnetic field model optional parameters
+    if (input_data.find("Residual Magnetic Dipole") != input_data.end()) {
+      residual_magnetic_dipole_ = input_data.at("Residual Magnetic Dipole");
+    }
+    if (input_data.find("Geomagnetic Field Degree") != input_data.end()) {
+      int geomagnetic_field_degree = input_data.at("Geomagnetic Field Degree");
+      geomagnetic_field_ =
+          std::make_shared<GeomagneticField>(geomagnetic_field_degree);
+    }
+    // Making the inertia tensor (in kg*m^2, body frame) an optional
+    // parameter, given either as its 3 diagonal components or as a full 3x3
+    // matrix. Defaults to the identity
+    if (input_data.find("Inertia Tensor") != input_data.end()) {
+      Matrix3d J_matrix = Matrix3d::Zero();
+      const json& inertia_data = input_data.at("Inertia Tensor");
+      if (inertia_data.at(0).is_array()) {
+        for (size_t row = 0; row < 3; row++) {
+          for (size_t col = 0; col < 3; col++) {
+            J_matrix(row, col) = inertia_data.at(row).at(col);
+          }
+        }
+      } else {
+        for (size_t ind = 0; ind < 3; ind++) {
+          J_matrix(ind, ind) = inertia_data.at(ind);
+        }
+      }
+      inertia_tensor_ = InertiaTensor(J_matrix);
+    }
+    // Making the gravity-gradient torque and the center of pressure offset
+    // (in m, body frame, used for the aerodynamic torque when drag is
+    // included) optional parameters
+    if (input_data.find("Gravity Gradient Torque") != input_data.end()) {
+      gravity_gradient_torque_enabled_ =
+          input_data.at("Gravity Gradient Torque");
+    }
+    if (input_data.find("Center of Pressure Offset") != input_data.end()) {
+      center_of_pressure_offset_ = input_data.at("Center of Pressure Offset");
+    }
 
-    orbital_rate_ = calculate_instantaneous_orbit_rate();
-    initialize_body_angular_velocity_vec_wrt_LVLH_in_body_frame();
     // making initial omega_x an optional parameter
     if (input_data.find("Initial omega_x") != input_data.end()) {
       double initial_omega_x_wrt_LVLH_in_body_frame =
@@ -260,17 +674,28 @@ class Satellite {
       body_angular_velocity_vec_wrt_LVLH_in_body_frame_.at(2) +=
           initial_omega_z_wrt_LVLH_in_body_frame;
     }
-
-    orbital_angular_acceleration_ =
-        calculate_instantaneous_orbit_angular_acceleration();
   }
 
+ public:
+  // Restores a satellite written by write_checkpoint, including its profiles,
+  // maneuvers, field model and environment settings. Continuing the time
+  // evolution of the restored satellite reproduces that of the original
+  // exactly. See checkpoint.h for checkpoint files
+  explicit Satellite(std::istream& input_checkpoint_stream);
+  void write_checkpoint(std::ostream& output_stream) const;
+
   std::array<double, 3> get_ECI_position() { return ECI_position_; }
   std::array<double, 3> get_ECI_velocity() { return ECI_velocity_; }
+  // Attitude quaternion of the body frame with respect to the LVLH frame,
+  // scalar component first
+  std::array<double, 4> get_quaternion() {
+    return quaternion_satellite_bodyframe_wrt_LVLH_;
+  }
   double get_speed() {
     // shouldn't matter which frame I use, might as well use perifocal coords
     // since it's fewer operations (no W-direction component so can omit that
     // term, whereas there's x,y,z components in ECI)
+    refresh_orbital_elements();
     return sqrt(pow(perifocal_velocity_.at(0), 2) +
                 pow(perifocal_velocity_.at(1), 2));
   }
@@ -282,6 +707,7 @@ class Satellite {
     // shouldn't matter which frame I use, might as well use perifocal coords
     // since it's fewer operations (no W-direction component so can omit that
     // term, whereas there's x,y,z components in ECI)
+    refresh_orbital_elements();
     return sqrt(pow(perifocal_position_.at(0), 2) +
                 pow(perifocal_position_.at(1), 2));
   }
@@ -300,8 +726,22 @@ class Satellite {
     return (gravitational_potential_energy + kinetic_energy);
   }
 
-  double get_instantaneous_time() { return t_; }
-  std::string get_name() { return name_; }
+  double get_instantaneous_time() const { return t_; }
+  AbsoluteEpoch get_epoch() { return epoch_; }
+  // Absolute time the satellite has been evolved to
+  AbsoluteEpoch get_current_epoch();
+  // Compensated summation of the time and state increments is enabled by
+  // default. Disabling it accumulates them in plain double precision, as
+  // before it was added
+  void set_compensated_summation(const bool input_enabled);
+  bool get_compensated_summation() { return compensated_summation_enabled_; }
+  // Whether time is accumulated as whole seconds plus a fraction, see
+  // split_time_enabled_. Switching keeps the current time
+  void set_split_time(const bool input_enabled);
+  bool get_split_time() { return split_time_enabled_; }
+  double get_mass() { return m_; }
+  const std::string& get_name() const { return name_; }
+  void set_name(const std::string input_name) { name_ = input_name; }
   void evolve_RK4(const double input_timestep);
 
   std::array<double, 3> body_frame_to_ECI(
@@ -322,14 +762,43 @@ class Satellite {
   // std::array<double,3> convert_LVLH_to_ECI(std::array<double,3>
   // input_LVLH_vec);
 
+  // input_Isp (in s) is optional; if given, the satellite's mass decreases
+  // while the profile is active, and the satellite needs a "Dry Mass" so that
+  // the thrust cuts out before the mass runs out
   void add_LVLH_thrust_profile(
       const std::array<double, 3> input_LVLH_normalized_thrust_direction,
       const double input_LVLH_thrust_magnitude,
-      const double input_thrust_start_time, const double input_thrust_end_time);
+      const double input_thrust_start_time, const double input_thrust_end_time,
+      const double input_Isp = 0);
   void add_LVLH_thrust_profile(
       const std::array<double, 3> input_LVLH_thrust_vector,
       const double input_thrust_start_time, const double input_thrust_end_time);
 
+  std::vector<ThrustProfileLVLH> get_LVLH_thrust_profiles() {
+    return thrust_profile_list_;
+  }
+  // Replaces the satellite's LVLH thrust profiles (but not its thrust curves)
+  void set_LVLH_thrust_profiles(
+      const std::vector<ThrustProfileLVLH>& input_thrust_profiles);
+
+  // Thrust curves with an Isp also need a "Dry Mass"
+  void add_LVLH_thrust_curve(const ThrustCurveLVLH input_thrust_curve);
+  void add_LVLH_thrust_curve(const std::string input_file_name);
+
+  // Add an instantaneous delta-v (in m/s), specified in the LVLH or ECI
+  // frame, at the given time. input_Isp (in s) is optional; if given, the
+  // satellite's mass decreases according to the rocket equation. A maneuver
+  // which would take the mass below the dry mass is skipped, and its time is
+  // listed by get_skipped_impulsive_maneuver_times
+  void add_impulsive_maneuver(
+      const std::array<double, 3> input_delta_v_vec,
+      const double input_maneuver_time,
+      const ManeuverFrame input_frame = ManeuverFrame::LVLH,
+      const double input_Isp = 0);
+  const std::vector<double>& get_skipped_impulsive_maneuver_times() const {
+    return skipped_impulsive_maneuver_times_;
+  }
+
   void add_bodyframe_torque_profile(
       const std::array<double, 3> input_bodyframe_direction_unit_vec,
       const double input_bodyframe_torque_magnitude,
@@ -338,14 +807,83 @@ class Satellite {
       const std::array<double, 3> input_bodyframe_torque_vector,
       const double input_torque_start_time, const double input_torque_end_time);
 
+  // Magnetorquer dipole commands, in A*m^2 in the body frame
+  void add_magnetorquer_dipole_profile(
+      const std::array<double, 3> input_bodyframe_dipole_vector,
+      const double input_dipole_start_time, const double input_dipole_end_time);
+  void set_residual_magnetic_dipole(
+      const std::array<double, 3> input_bodyframe_dipole_vector) {
+    residual_magnetic_dipole_ = input_bodyframe_dipole_vector;
+  }
+  std::array<double, 3> get_residual_magnetic_dipole() {
+    return residual_magnetic_dipole_;
+  }
+  void set_inertia_tensor(const Matrix3d input_J_matrix) {
+    inertia_tensor_ = InertiaTensor(input_J_matrix);
+  }
+  Matrix3d get_inertia_tensor() { return inertia_tensor_.J_matrix_; }
+  void set_gravity_gradient_torque(const bool input_enabled) {
+    gravity_gradient_torque_enabled_ = input_enabled;
+  }
+  void set_center_of_pressure_offset(
+      const std::array<double, 3> input_bodyframe_offset) {
+    center_of_pressure_offset_ = input_bodyframe_offset;
+  }
+  // Geomagnetic field at the satellite's current position, in T
+  std::array<double, 3> get_magnetic_field_ECI();
+  std::array<double, 3> get_magnetic_field_bodyframe();
+  void set_geomagnetic_field(
+      std::shared_ptr<GeomagneticField> input_geomagnetic_field) {
+    geomagnetic_field_ = input_geomagnetic_field;
+  }
+  std::shared_ptr<GeomagneticField> get_geomagnetic_field() {
+    return geomagnetic_field_;
+  }
+
   int update_orbital_elements_from_position_and_velocity();
   std::array<double, 6> get_orbital_elements();
 
+  // Both versions return the step size to use next and an error code: 0 for
+  // nominal operation, or 2 if the step left the state non-finite or at the
+  // center of the Earth, so that propagation can be stopped
   std::pair<double, int> evolve_RK45(
       const double input_epsilon, const double input_initial_timestep,
       const bool perturbation = true, const bool atmospheric_drag = false,
+      std::pair<double, double> drag_elements = {},
+      const bool third_body = false,
+      const bool solar_radiation_pressure = false);
+  std::pair<double, int> evolve_RK45(
+      const double input_epsilon, const double input_initial_timestep,
+      const std::vector<ForceTerm>& input_force_terms,
       std::pair<double, double> drag_elements = {});
 
+  // Steps the satellite by input_timestep with SGP4 rather than by numerical
+  // integration. Only available for satellites set up from a TLE. Returns
+  // the same step size for the next step, and the SGP4 error code (see
+  // SGP4Propagator::propagate_element_set); the satellite isn't moved if
+  // this is nonzero. Thrust, maneuvers and the force terms don't apply, and
+  // the attitude stays fixed relative to the LVLH frame
+  std::pair<double, int> evolve_SGP4(const double input_timestep);
+  // While enabled, evolve_RK45 calls evolve_SGP4 with its step size instead
+  // of integrating, so the simulation drivers and output functions run SGP4
+  // for these satellites unchanged. Disabling it continues from the current
+  // state with numerical integration
+  void set_SGP4_propagation(const bool input_enabled);
+  bool get_SGP4_propagation() { return SGP4_propagation_enabled_; }
+  // The SGP4 propagator holding the satellite's element set (nullptr if it
+  // wasn't set up from a TLE), and the index of the element set in it
+  std::shared_ptr<const SGP4Propagator> get_SGP4_propagator() {
+    return SGP4_propagator_;
+  }
+  size_t get_SGP4_element_set_index() { return SGP4_element_set_index_; }
+  // Switches to element set input_element_set_index of another propagator,
+  // which must be the satellite's current element set (same catalog number
+  // and epoch), e.g. to share one propagator between many satellites (see
+  // share_SGP4_propagator in utils.h)
+  void set_SGP4_propagator(
+      std::shared_ptr<const SGP4Propagator> input_SGP4_propagator,
+      const size_t input_element_set_index);
+
   double get_orbital_element(const std::string orbital_element_name);
   double calculate_instantaneous_orbit_rate();
   double calculate_instantaneous_orbit_angular_acceleration();
@@ -354,6 +892,58 @@ class Satellite {
                                                 const double yaw_angle);
   double get_attitude_val(const std::string input_attitude_val_name);
   double calculate_orbital_period();
+
+  // Drop optional force terms while their estimated acceleration is below
+  // input_error_budget (in m/s^2), see ForceModelFidelitySwitch. A budget of 0
+  // (the default) always uses every requested term
+  void set_force_model_error_budget(const double input_error_budget,
+                                    const double input_hysteresis_ratio = 0.5);
+  // Bits (see force_term_bit) of the requested force terms dropped for the
+  // most recent time step
+  unsigned int get_disabled_force_term_mask() {
+    return force_model_fidelity_switch_.disabled_force_term_mask_;
+  }
+
+  void prefit_sun_moon_ephemeris(const double input_t_end) {
+    environment_->get_sun_moon_ephemeris()->prefit(t_, input_t_end);
+  }
+  // Replacing the ephemeris or Earth orientation gives this satellite its own
+  // copy of the environment, so other satellites sharing it are unaffected
+  void set_sun_moon_ephemeris(
+      std::shared_ptr<SunMoonEphemeris> input_sun_moon_ephemeris) {
+    environment_ = std::make_shared<EnvironmentCache>(*environment_);
+    environment_->set_sun_moon_ephemeris(input_sun_moon_ephemeris);
+  }
+  std::shared_ptr<SunMoonEphemeris> get_sun_moon_ephemeris() {
+    return environment_->get_sun_moon_ephemeris();
+  }
+
+  // Position and velocity in the Earth-fixed (ECEF) frame
+  std::array<double, 3> get_ECEF_position() {
+    return environment_->get_earth_orientation()->convert_ECI_to_ECEF(
+        ECI_position_, t_);
+  }
+  std::array<double, 3> get_ECEF_velocity() {
+    return environment_->get_earth_orientation()->convert_ECI_to_ECEF_velocity(
+        ECI_position_, ECI_velocity_, t_);
+  }
+  void set_earth_orientation(
+      std::shared_ptr<EarthOrientation> input_earth_orientation) {
+    environment_ = std::make_shared<EnvironmentCache>(*environment_);
+    environment_->set_earth_orientation(input_earth_orientation);
+  }
+  std::shared_ptr<EarthOrientation> get_earth_orientation() {
+    return environment_->get_earth_orientation();
+  }
+  void set_environment(std::shared_ptr<EnvironmentCache> input_environment) {
+    environment_ = input_environment;
+  }
+  // Gives this satellite its own copies of the environment (including the
+  // ephemeris and Earth orientation) and of the geomagnetic field model, so
+  // it no longer shares their caches with the satellites it was copied from
+  // and can be propagated on a different thread
+  void detach_shared_caches();
+  std::shared_ptr<EnvironmentCache> get_environment() { return environment_; }
 };
 
 #endif
\ No newline at end of file
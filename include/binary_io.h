@@ -0,0 +1,74 @@
+#ifndef BINARY_IO_HEADER
+#define BINARY_IO_HEADER
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Raw binary reads and writes of the values making up a checkpoint (see
+// checkpoint.h). Values are written in the machine's native byte order, so
+// checkpoints are only meant to be read back on the same kind of machine
+
+template <typename T>
+void write_binary_value(std::ostream& output_stream, const T& input_value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable values can be written directly");
+  output_stream.write(reinterpret_cast<const char*>(&input_value), sizeof(T));
+}
+
+template <typename T>
+T read_binary_value(std::istream& input_stream) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable values can be read directly");
+  // Read into raw storage, since T needn't be default constructible
+  alignas(T) char buffer[sizeof(T)];
+  input_stream.read(buffer, sizeof(T));
+  if (!input_stream) {
+    throw std::invalid_argument("Checkpoint ended unexpectedly");
+  }
+  return *reinterpret_cast<T*>(buffer);
+}
+
+// Vectors are written as their length followed by their elements
+template <typename T>
+void write_binary_vector(std::ostream& output_stream,
+                         const std::vector<T>& input_vector) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable values can be written directly");
+  write_binary_value<uint64_t>(output_stream, input_vector.size());
+  if (input_vector.size() > 0) {
+    output_stream.write(reinterpret_cast<const char*>(input_vector.data()),
+                        input_vector.size() * sizeof(T));
+  }
+}
+
+template <typename T>
+std::vector<T> read_binary_vector(std::istream& input_stream) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable values can be read directly");
+  uint64_t num_elements = read_binary_value<uint64_t>(input_stream);
+  std::vector<T> output_vector = {};
+  output_vector.reserve(num_elements);
+  for (uint64_t ind = 0; ind < num_elements; ind++) {
+    output_vector.push_back(read_binary_value<T>(input_stream));
+  }
+  return output_vector;
+}
+
+inline void write_binary_string(std::ostream& output_stream,
+                                const std::string& input_string) {
+  write_binary_vector(output_stream,
+                      std::vector<char>(input_string.begin(),
+                                        input_string.end()));
+}
+
+inline std::string read_binary_string(std::istream& input_stream) {
+  std::vector<char> characters = read_binary_vector<char>(input_stream);
+  return std::string(characters.begin(), characters.end());
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef CATALOG_HEADER
+#define CATALOG_HEADER
+
+#include <string>
+
+#include "satellite_store.h"
+
+// Loads many satellites at once from a single catalog file, rather than from
+// one input file per satellite. The format is chosen by file extension:
+//  - .json: a JSON array of objects, each with the same fields as a single
+//    satellite's input file
+//  - .csv: a header row of field names (as in the input files), then one row
+//    per satellite. Only single-valued fields are supported: "Name" and
+//    "Plotting Color" are read as text, true/false as booleans and
+//    everything else as numbers. Empty cells leave optional fields unset
+//  - .tle: two-line element sets, optionally each preceded by a name line
+//    (see load_TLE_file in sgp4.h). Satellites are set up as in
+//    Satellite::from_TLE, sharing a single SGP4 propagator
+// Satellites are set up on input_num_threads threads (CSV rows are also
+// parsed in parallel), and added to the store in catalog order. Satellites
+// with the same epoch share one environment, as in share_environment
+SatelliteStore load_catalog(const std::string input_file_name,
+                            const size_t input_num_threads = 1);
+
+// As load_catalog, but also keeps a binary copy of the loaded store in
+// input_cache_file_name. If the cache was written from the catalog file as it
+// is now (same size and modification time), the store is read back from the
+// cache instead, which skips parsing and setting up the satellites. Otherwise
+// the catalog is loaded and the cache (re)written. The cache is read into
+// memory with a single read rather than memory-mapped, since the satellites
+// are rebuilt from its records either way. Satellites restored from the
+// cache share environments, and TLE satellites share one SGP4 propagator,
+// as after load_catalog
+SatelliteStore load_catalog_cached(const std::string input_file_name,
+                                   const std::string input_cache_file_name,
+                                   const size_t input_num_threads = 1);
+
+#endif
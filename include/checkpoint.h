@@ -0,0 +1,41 @@
+#ifndef CHECKPOINT_HEADER
+#define CHECKPOINT_HEADER
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Satellite.h"
+#include "satellite_store.h"
+
+// Checkpoint files hold the full state of a satellite or of a SatelliteStore,
+// along with the step size to use for each satellite's next evolve_RK45 call
+// (i.e., the one suggested by its most recent call), so that a run can be
+// stopped and later resumed from the file. A resumed run reproduces the
+// uninterrupted one exactly.
+//
+// Files start with an identifier and a format version, and files from other
+// versions are rejected. Files are first written under a temporary name and
+// then renamed, so an interrupted write doesn't clobber the previous
+// checkpoint
+const uint32_t checkpoint_format_version = 7;
+
+void save_checkpoint(const std::string output_file_name,
+                     const Satellite& input_satellite,
+                     const double input_next_timestep);
+// Returns the restored satellite and the step size to continue with
+std::pair<Satellite, double> load_checkpoint(
+    const std::string input_file_name);
+
+// input_next_timesteps holds one step size per satellite, in handle order
+void save_store_checkpoint(const std::string output_file_name,
+                           const SatelliteStore& input_satellite_store,
+                           const std::vector<double>& input_next_timesteps);
+// Satellites with the same epoch share one environment after loading, as in
+// share_environment, and satellites set up from TLEs share one SGP4
+// propagator, as in share_SGP4_propagator
+std::pair<SatelliteStore, std::vector<double>> load_store_checkpoint(
+    const std::string input_file_name);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef CONSTELLATION_HEADER
+#define CONSTELLATION_HEADER
+
+#include <string>
+
+#include "satellite_store.h"
+
+// Walker constellations, ref:
+// https://en.wikipedia.org/wiki/Satellite_constellation#Walker_Constellation
+//  - delta: orbital planes spread evenly over 360 degrees of RAAN
+//  - star: orbital planes spread evenly over 180 degrees of RAAN, as used for
+//    polar constellations
+enum class WalkerPattern { delta, star };
+
+// Builds a Walker constellation with input_num_planes planes of
+// input_satellites_per_plane satellites each, in circular orbits at the given
+// altitude (in km) and inclination (in deg), directly into a store. In
+// Walker notation this is i:T/P/F, with T the total number of satellites, P
+// the number of planes and F = input_phasing (from 0 to P-1): satellites in
+// each plane are 360/(T/P) degrees apart in argument of latitude, and each
+// plane is shifted F*360/T degrees ahead of the one before it.
+//
+// Everything else comes from input_template (mass, epoch, plotting color,
+// etc.), whose RAAN and true anomaly set those of the first satellite of the
+// first plane. Satellites are named input_template.name (or "Walker" if
+// that's empty) followed by their plane and slot numbers, e.g. "Walker_2_5",
+// and added plane by plane. They share one environment, as in
+// share_environment
+SatelliteStore generate_walker_constellation(
+    const size_t input_num_planes, const size_t input_satellites_per_plane,
+    const size_t input_phasing, const double input_altitude,
+    const double input_inclination,
+    const WalkerPattern input_pattern = WalkerPattern::delta,
+    const SatelliteElements& input_template = SatelliteElements());
+
+#endif
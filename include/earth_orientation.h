@@ -0,0 +1,99 @@
+#ifndef EARTH_ORIENTATION_HEADER
+#define EARTH_ORIENTATION_HEADER
+
+#include <Eigen/Dense>
+#include <array>
+#include <unordered_map>
+
+#include "ephemeris.h"
+
+using Eigen::Matrix3d;
+
+// Define constants
+// Rotation rate of the Earth relative to the stars, in rad/s
+const double earth_rotation_rate =
+    7.292115 * pow(10, -5);  // https://en.wikipedia.org/wiki/Earth's_rotation
+
+// Frame rotation matrices about the x, y and z axes, which give a vector's
+// components in a frame rotated by input_angle about that axis
+Matrix3d frame_rotation_x(const double input_angle);
+Matrix3d frame_rotation_y(const double input_angle);
+Matrix3d frame_rotation_z(const double input_angle);
+// Greenwich mean sidereal time, in radians in [0, 2*pi)
+double calculate_GMST(const double input_julian_date);
+// IAU 1976 precession matrix from the J2000 ECI frame to the mean equator and
+// equinox of date
+Matrix3d calculate_precession_matrix(const double input_julian_date);
+// Nutation matrix from the mean to the true equator and equinox of date, using
+// the largest terms of the IAU 1980 series. Also returns the equation of the
+// equinoxes (GAST - GMST) in radians
+std::pair<Matrix3d, double> calculate_nutation_matrix(
+    const double input_julian_date);
+
+class EarthOrientation {
+  // Rotation between the (J2000) ECI frame and the Earth-fixed (ECEF) frame,
+  // as a function of simulation time in seconds since the epoch this object
+  // was built with. By default this is just the rotation by the Greenwich mean
+  // sidereal time; optionally it also includes precession and nutation. Polar
+  // motion and the difference between UT1 and TT are neglected.
+  //
+  // The rotation matrix for the most recent few evaluation times is kept, so
+  // satellites propagated in lockstep which share one EarthOrientation object
+  // (see Satellite::set_earth_orientation) only compute it once per evaluation
+  // time. Precession and nutation vary slowly, so they're computed on a grid of
+  // node times and interpolated between nodes
+ private:
+  double epoch_julian_date_ = {julian_date_J2000};
+  bool include_precession_nutation_ = false;
+  double node_spacing_ = {3600};  // s
+
+  // Precession-nutation matrices and equations of the equinoxes at node times,
+  // keyed by node index
+  std::unordered_map<long, std::pair<Matrix3d, double>>
+      precession_nutation_nodes_ = {};
+
+  // Recently computed ECI to ECEF matrices, overwritten round-robin
+  static constexpr size_t num_cached_matrices_ = 16;
+  std::array<double, num_cached_matrices_> cached_times_;
+  std::array<Matrix3d, num_cached_matrices_> cached_ECI_to_ECEF_matrices_;
+  size_t next_cache_slot_ = {0};
+  size_t num_matrix_calculations_ = {0};
+
+  const std::pair<Matrix3d, double>& get_precession_nutation_node(
+      const long input_node_index);
+  Matrix3d calculate_ECI_to_ECEF_matrix(const double input_time);
+
+ public:
+  EarthOrientation(const double input_epoch_julian_date = julian_date_J2000,
+                   const bool input_include_precession_nutation = false,
+                   const double input_node_spacing = 3600) {
+    epoch_julian_date_ = input_epoch_julian_date;
+    include_precession_nutation_ = input_include_precession_nutation;
+    node_spacing_ = input_node_spacing;
+    cached_times_.fill(NAN);
+  }
+
+  const Matrix3d& get_ECI_to_ECEF_matrix(const double input_time);
+  std::array<double, 3> convert_ECI_to_ECEF(
+      const std::array<double, 3> input_ECI_vec, const double input_time);
+  std::array<double, 3> convert_ECEF_to_ECI(
+      const std::array<double, 3> input_ECEF_vec, const double input_time);
+  // Velocities relative to the rotating frame also pick up the omega x r term
+  std::array<double, 3> convert_ECI_to_ECEF_velocity(
+      const std::array<double, 3> input_ECI_position,
+      const std::array<double, 3> input_ECI_velocity, const double input_time);
+  std::array<double, 3> convert_ECEF_to_ECI_velocity(
+      const std::array<double, 3> input_ECEF_position,
+      const std::array<double, 3> input_ECEF_velocity, const double input_time);
+
+  double get_epoch_julian_date() { return epoch_julian_date_; }
+  bool get_include_precession_nutation() {
+    return include_precession_nutation_;
+  }
+  double get_node_spacing() { return node_spacing_; }
+  // Number of times the rotation matrix was computed rather than read from
+  // the cache
+  size_t get_num_matrix_calculations() { return num_matrix_calculations_; }
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef ENVIRONMENT_HEADER
+#define ENVIRONMENT_HEADER
+
+#include <array>
+#include <cmath>
+#include <memory>
+
+#include "earth_orientation.h"
+#include "ephemeris.h"
+#include "schedule.h"
+
+class EnvironmentCache {
+  // Quantities which only depend on the evaluation time, not on the satellite:
+  // Sun and Moon positions, the ECI to ECEF rotation and space weather
+  // indices. Satellites with the same epoch can share one EnvironmentCache
+  // (see share_environment in utils.h), in which case each quantity is
+  // computed once per evaluation time and read by every satellite evaluated
+  // at that time, as happens when satellites are stepped in lockstep on a
+  // common time grid.
+  //
+  // Quantities are kept for the most recent num_snapshots_ evaluation times,
+  // and only computed when first requested at a given time
+ private:
+  struct EnvironmentSnapshot {
+    double t = NAN;
+    bool sun_position_computed = false;
+    bool moon_position_computed = false;
+    bool ECI_to_ECEF_matrix_computed = false;
+    std::array<double, 3> sun_position_ECI = {0, 0, 0};
+    std::array<double, 3> moon_position_ECI = {0, 0, 0};
+    Matrix3d ECI_to_ECEF_matrix;
+  };
+
+  std::shared_ptr<SunMoonEphemeris> sun_moon_ephemeris_;
+  std::shared_ptr<EarthOrientation> earth_orientation_;
+  // F_10 and A_p indices over time, used by the drag term in place of the
+  // values passed to Satellite::evolve_RK45 if any windows have been added
+  PiecewiseConstantSchedule<2> space_weather_schedule_;
+
+  static constexpr size_t num_snapshots_ = 32;
+  std::array<EnvironmentSnapshot, num_snapshots_> snapshots_;
+  size_t most_recent_snapshot_ = {0};
+  size_t num_sun_moon_evaluations_ = {0};
+
+  EnvironmentSnapshot& get_snapshot(const double input_time);
+
+ public:
+  EnvironmentCache(std::shared_ptr<SunMoonEphemeris> input_sun_moon_ephemeris,
+                   std::shared_ptr<EarthOrientation> input_earth_orientation) {
+    sun_moon_ephemeris_ = input_sun_moon_ephemeris;
+    earth_orientation_ = input_earth_orientation;
+  }
+  // Restores an environment written by write_checkpoint. Only the ephemeris
+  // and Earth orientation settings and the space weather windows are stored,
+  // since everything else is recomputed on demand
+  explicit EnvironmentCache(std::istream& input_checkpoint_stream);
+  void write_checkpoint(std::ostream& output_stream);
+
+  const std::array<double, 3>& get_sun_position_ECI(const double input_time);
+  const std::array<double, 3>& get_moon_position_ECI(const double input_time);
+  const Matrix3d& get_ECI_to_ECEF_matrix(const double input_time);
+
+  // Space weather indices are taken to be constant over each window. As with
+  // thrust windows, overlapping windows (including ones sharing an endpoint)
+  // add together where they overlap
+  void add_space_weather_window(const double input_t_start,
+                                const double input_t_end,
+                                const double input_F_10,
+                                const double input_A_p);
+  bool has_space_weather() {
+    return (space_weather_schedule_.get_num_windows() > 0);
+  }
+  // F_10 first, A_p second
+  std::pair<double, double> get_space_weather(const double input_time);
+
+  // Replacing the ephemeris or Earth orientation clears the cached values
+  void set_sun_moon_ephemeris(
+      std::shared_ptr<SunMoonEphemeris> input_sun_moon_ephemeris);
+  void set_earth_orientation(
+      std::shared_ptr<EarthOrientation> input_earth_orientation);
+  std::shared_ptr<SunMoonEphemeris> get_sun_moon_ephemeris() {
+    return sun_moon_ephemeris_;
+  }
+  std::shared_ptr<EarthOrientation> get_earth_orientation() {
+    return earth_orientation_;
+  }
+  double get_epoch_julian_date() {
+    return sun_moon_ephemeris_->get_epoch_julian_date();
+  }
+  // Number of times the Sun and Moon positions were read from the ephemeris
+  // rather than from the cache
+  size_t get_num_sun_moon_evaluations() { return num_sun_moon_evaluations_; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef EPHEMERIS_HEADER
+#define EPHEMERIS_HEADER
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+// Define constants
+const double mu_Sun =
+    1.32712440018 *
+    pow(10, 20);  // https://en.wikipedia.org/wiki/Standard_gravitational_parameter
+const double mu_Moon =
+    4.9028 *
+    pow(10, 12);  // https://en.wikipedia.org/wiki/Standard_gravitational_parameter
+const double radius_Sun =
+    6.957 * pow(10, 8);  // https://en.wikipedia.org/wiki/Solar_radius
+const double astronomical_unit =
+    1.495978707 * pow(10, 11);  // https://en.wikipedia.org/wiki/Astronomical_unit
+// Solar radiation pressure on a perfectly absorbing surface at 1 AU, in N/m^2
+// (Montenbruck & Gill, Satellite Orbits, section 3.4.1)
+const double solar_radiation_pressure_1AU = 4.56 * pow(10, -6);
+const double julian_date_J2000 = 2451545.0;
+const double seconds_per_day = 86400.0;
+
+// Low-precision analytic Sun and Moon positions in the (J2000) ECI frame, in m
+std::array<double, 3> calculate_sun_position_ECI_analytic(
+    const double input_julian_date);
+std::array<double, 3> calculate_moon_position_ECI_analytic(
+    const double input_julian_date);
+
+// Evaluates a Chebyshev series at normalized time tau in [-1,1] via Clenshaw's
+// recurrence. The coefficients of the series for component comp are stored at
+// input_coefficients[input_offset + comp*input_num_coefficients + j]
+std::array<double, 3> evaluate_chebyshev_series_3d(
+    const std::vector<double>& input_coefficients, const size_t input_offset,
+    const size_t input_num_coefficients, const double tau);
+
+class SunMoonEphemeris {
+  // Caches the analytic Sun and Moon positions as piecewise Chebyshev
+  // polynomials in time, so that each force evaluation only costs a polynomial
+  // evaluation rather than an evaluation of the analytic series. Times are
+  // simulation times in seconds since the epoch this object was built with.
+  // Segments are fitted on first use, or up front via prefit()
+ private:
+  double epoch_julian_date_ = {julian_date_J2000};
+  double segment_duration_ = {43200};  // s
+  size_t num_coefficients_ = {12};
+
+  // Segment k covers [k*segment_duration_, (k+1)*segment_duration_). Index
+  // first_segment_index_ is stored at position 0 of the vectors below
+  long first_segment_index_ = {0};
+  std::vector<bool> segment_fitted_ = {};
+  // Sun x,y,z coefficients followed by Moon x,y,z coefficients, per segment
+  std::vector<double> coefficients_ = {};
+
+  size_t ensure_segment_fitted(const long input_segment_index);
+  void fit_segment(const size_t input_storage_index,
+                   const long input_segment_index);
+
+ public:
+  SunMoonEphemeris(const double input_epoch_julian_date = julian_date_J2000,
+                   const double input_segment_duration = 43200,
+                   const size_t input_num_coefficients = 12) {
+    if (!(input_segment_duration > 0) ||
+        !std::isfinite(input_segment_duration)) {
+      throw std::invalid_argument(
+          "Ephemeris segment duration must be positive and finite");
+    }
+    if (input_num_coefficients < 1) {
+      throw std::invalid_argument(
+          "Ephemeris segments need at least 1 Chebyshev coefficient");
+    }
+    epoch_julian_date_ = input_epoch_julian_date;
+    segment_duration_ = input_segment_duration;
+    num_coefficients_ = input_num_coefficients;
+  }
+
+  void prefit(const double input_t_start, const double input_t_end);
+  std::array<double, 3> get_sun_position_ECI(const double input_time);
+  std::array<double, 3> get_moon_position_ECI(const double input_time);
+  double get_epoch_julian_date() { return epoch_julian_date_; }
+  double get_segment_duration() { return segment_duration_; }
+  size_t get_num_coefficients() { return num_coefficients_; }
+  size_t get_num_fitted_segments();
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef EPOCH_HEADER
+#define EPOCH_HEADER
+
+#include <cstdint>
+
+#include "ephemeris.h"
+
+struct AbsoluteEpoch {
+  // An instant given as a whole Julian day number plus the seconds into that
+  // day (starting at noon, as Julian days do), with the seconds kept in
+  // [0, 86400). A Julian date held in a single double only resolves ~40
+  // microseconds at current dates, while the split form resolves well under
+  // a nanosecond, and differences between nearby epochs stay exact
+  int64_t day = {2451545};  // J2000
+  double seconds = {0};
+
+  AbsoluteEpoch() {}
+  AbsoluteEpoch(const int64_t input_day, const double input_seconds);
+  static AbsoluteEpoch from_julian_date(const double input_julian_date);
+
+  double get_julian_date() const {
+    return day + seconds / seconds_per_day;
+  }
+  AbsoluteEpoch add_seconds(const double input_seconds) const {
+    return AbsoluteEpoch(day, seconds + input_seconds);
+  }
+  // Time from input_epoch to this epoch, in s
+  double seconds_since(const AbsoluteEpoch& input_epoch) const {
+    return (day - input_epoch.day) * seconds_per_day +
+           (seconds - input_epoch.seconds);
+  }
+
+  bool operator==(const AbsoluteEpoch& input_epoch) const {
+    return (day == input_epoch.day) && (seconds == input_epoch.seconds);
+  }
+  bool operator<(const AbsoluteEpoch& input_epoch) const {
+    return (day < input_epoch.day) ||
+           ((day == input_epoch.day) && (seconds < input_epoch.seconds));
+  }
+};
+
+#endif
@@ -0,0 +1,643 @@
+#ifndef FORCE_MODEL_HEADER
+#define FORCE_MODEL_HEADER
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "environment.h"
+#include "geomagnetic_field.h"
+#include "utils.h"
+
+// A force model is a class with a static function
+//   std::array<double, 3> calculate_acceleration(r, v, t, context)
+// returning the total acceleration on the satellite in the ECI frame. Force
+// models are built by composing force term classes, each of which adds its
+// own contribution onto a running acceleration vector. Composing them as a
+// template parameter pack means that a given combination of terms compiles
+// into a straight sequence of calls, with no per-evaluation branching on
+// which terms are enabled. New force terms only need a new term class (and a
+// new ForceTerm entry), rather than a new parameter threaded through every
+// derivative function
+
+constexpr unsigned int force_term_bit(const ForceTerm input_force_term) {
+  return 1u << static_cast<unsigned int>(input_force_term);
+}
+
+inline unsigned int calculate_force_term_mask(
+    const std::vector<ForceTerm>& input_force_terms) {
+  unsigned int force_term_mask = 0;
+  for (const ForceTerm force_term : input_force_terms) {
+    force_term_mask |= force_term_bit(force_term);
+  }
+  return force_term_mask;
+}
+
+class ForceModelContext {
+  // Everything the force terms need beyond the satellite's position, velocity
+  // and the evaluation time. Filled in once per time step by the satellite
+  // being evolved
+ public:
+  // Current mass, updated from the integrated state at every evaluation
+  double spacecraft_mass_ = {1};
+  double dry_mass_ = {0};
+  // Orbital elements at the start of the step, used by the J2 term
+  double inclination_ = {0};
+  double arg_of_periapsis_ = {0};
+  double true_anomaly_ = {0};
+  // Space weather inputs and area used by the atmospheric drag term
+  double F_10_ = {0};
+  double A_p_ = {0};
+  double A_s_ = {0};
+  // Area and radiation pressure coefficient used by the SRP term
+  double A_srp_ = {0};
+  double C_R_ = {1.3};
+  // Enabled terms, only consulted by RuntimeForceModel
+  unsigned int force_term_mask_ = {0};
+  // LVLH force, plus propellant mass flow rate as the 4th component
+  PiecewiseConstantSchedule<4>* thrust_schedule_LVLH_ = nullptr;
+  std::vector<ThrustCurveLVLH>* thrust_curve_list_ = nullptr;
+  // Time-dependent quantities shared by every satellite with the same epoch
+  EnvironmentCache* environment_ = nullptr;
+
+  std::array<double, 3> get_sun_position_ECI(
+      const double input_evaluation_time) {
+    return environment_->get_sun_position_ECI(input_evaluation_time);
+  }
+  std::array<double, 3> get_moon_position_ECI(
+      const double input_evaluation_time) {
+    return environment_->get_moon_position_ECI(input_evaluation_time);
+  }
+  // Which state-dependent torques act on the attitude, and the offset (in m,
+  // body frame) of the center of pressure from the center of mass used by
+  // the aerodynamic torque
+  bool gravity_gradient_torque_enabled_ = false;
+  bool aerodynamic_torque_enabled_ = false;
+  std::array<double, 3> center_of_pressure_offset_ = {0, 0, 0};
+  // Magnetic field model and dipole sources used by the magnetic torque
+  GeomagneticField* geomagnetic_field_ = nullptr;
+  PiecewiseConstantSchedule<3>* magnetorquer_dipole_schedule_ = nullptr;
+  std::array<double, 3> residual_magnetic_dipole_ = {0, 0, 0};
+  bool magnetic_torque_enabled_ = false;
+
+  // Field at the given position and evaluation time, in the ECI frame. The
+  // most recent evaluation is kept, so everything which needs the field at a
+  // given RK stage shares a single evaluation of the field model
+  const std::array<double, 3>& get_magnetic_field_ECI(
+      const std::array<double, 3>& input_r_vec,
+      const double input_evaluation_time) {
+    if ((input_evaluation_time != magnetic_field_time_) ||
+        (input_r_vec != magnetic_field_position_)) {
+      magnetic_field_ECI_ = calculate_geomagnetic_field_ECI(
+          *geomagnetic_field_,
+          environment_->get_ECI_to_ECEF_matrix(input_evaluation_time),
+          input_r_vec);
+      magnetic_field_time_ = input_evaluation_time;
+      magnetic_field_position_ = input_r_vec;
+    }
+    return magnetic_field_ECI_;
+  }
+
+  // F_10 and A_p from the environment's space weather windows if it has any,
+  // otherwise the values passed in for the whole propagation
+  std::pair<double, double> get_space_weather(
+      const double input_evaluation_time) {
+    if ((environment_ != nullptr) && environment_->has_space_weather()) {
+      return environment_->get_space_weather(input_evaluation_time);
+    }
+    return {F_10_, A_p_};
+  }
+
+ private:
+  double magnetic_field_time_ = {NAN};
+  std::array<double, 3> magnetic_field_position_ = {0, 0, 0};
+  std::array<double, 3> magnetic_field_ECI_ = {0, 0, 0};
+};
+
+inline void add_to_acceleration(std::array<double, 3>& acceleration_vec,
+                                const std::array<double, 3> input_term_vec) {
+  for (size_t ind = 0; ind < 3; ind++) {
+    acceleration_vec.at(ind) += input_term_vec.at(ind);
+  }
+}
+
+class CentralBodyGravity {
+ public:
+  static constexpr ForceTerm force_term = ForceTerm::central_body;
+  static void add_acceleration(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& /*input_velocity_vec*/,
+      const double /*input_evaluation_time*/,
+      ForceModelContext& /*input_context*/,
+      std::array<double, 3>& acceleration_vec) {
+    add_to_acceleration(acceleration_vec,
+                        calculate_central_body_acceleration(input_r_vec));
+  }
+};
+
+class ThrustAcceleration {
+ public:
+  static constexpr ForceTerm force_term = ForceTerm::thrust;
+
+  // Thrust cuts out once the mass drops to the dry mass
+  static bool propellant_exhausted(const ForceModelContext& input_context) {
+    return ((input_context.dry_mass_ > 0) &&
+            (input_context.spacecraft_mass_ <= input_context.dry_mass_));
+  }
+
+  // Time derivative of the satellite's mass due to propellant consumption
+  static double calculate_mass_derivative(const double input_evaluation_time,
+                                          ForceModelContext& input_context) {
+    if (propellant_exhausted(input_context)) {
+      return 0;
+    }
+    double mass_flow_rate = input_context.thrust_schedule_LVLH_
+                                ->get_value(input_evaluation_time)
+                                .at(3);
+    if (input_context.thrust_curve_list_ != nullptr) {
+      for (ThrustCurveLVLH& thrust_curve : *input_context.thrust_curve_list_) {
+        mass_flow_rate +=
+            thrust_curve.get_mass_flow_rate(input_evaluation_time);
+      }
+    }
+    return -mass_flow_rate;
+  }
+
+  static void add_acceleration(const std::array<double, 3>& input_r_vec,
+                               const std::array<double, 3>& input_velocity_vec,
+                               const double input_evaluation_time,
+                               ForceModelContext& input_context,
+                               std::array<double, 3>& acceleration_vec) {
+    if (propellant_exhausted(input_context)) {
+      return;
+    }
+    // The thrust schedule already sums the LVLH forces of all profiles active
+    // at this time, so only one frame conversion is needed
+    const std::array<double, 4>& LVLH_force_and_mass_flow_rate =
+        input_context.thrust_schedule_LVLH_->get_value(input_evaluation_time);
+    std::array<double, 3> LVLH_force_vec = {
+        LVLH_force_and_mass_flow_rate.at(0),
+        LVLH_force_and_mass_flow_rate.at(1),
+        LVLH_force_and_mass_flow_rate.at(2)};
+    if (input_context.thrust_curve_list_ != nullptr) {
+      for (ThrustCurveLVLH& thrust_curve : *input_context.thrust_curve_list_) {
+        std::array<double, 3> curve_force_vec =
+            thrust_curve.get_LVLH_force(input_evaluation_time);
+        for (size_t ind = 0; ind < 3; ind++) {
+          LVLH_force_vec.at(ind) += curve_force_vec.at(ind);
+        }
+      }
+    }
+    if ((LVLH_force_vec.at(0) == 0) && (LVLH_force_vec.at(1) == 0) &&
+        (LVLH_force_vec.at(2) == 0)) {
+      return;
+    }
+    std::array<double, 3> external_force_vec_in_ECI =
+        convert_LVLH_to_ECI_manual(LVLH_force_vec, input_r_vec,
+                                   input_velocity_vec);
+    for (size_t ind = 0; ind < 3; ind++) {
+      acceleration_vec.at(ind) += (external_force_vec_in_ECI.at(ind) /
+                                   input_context.spacecraft_mass_);
+    }
+  }
+};
+
+class J2Perturbation {
+ public:
+  static constexpr ForceTerm force_term = ForceTerm::J2;
+  // Upper bound on the J2 acceleration at this distance (reached over the
+  // poles), used to decide whether the term can be dropped
+  static double estimate_acceleration_magnitude(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& /*input_velocity_vec*/,
+      const double /*input_evaluation_time*/,
+      ForceModelContext& /*input_context*/) {
+    double distance = sqrt(input_r_vec.at(0) * input_r_vec.at(0) +
+                           input_r_vec.at(1) * input_r_vec.at(1) +
+                           input_r_vec.at(2) * input_r_vec.at(2));
+    return 3 * G * mass_Earth * J2_Earth * radius_Earth * radius_Earth /
+           pow(distance, 4);
+  }
+  static void add_acceleration(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& /*input_velocity_vec*/,
+      const double /*input_evaluation_time*/,
+      ForceModelContext& input_context,
+      std::array<double, 3>& acceleration_vec) {
+    add_to_acceleration(
+        acceleration_vec,
+        calculate_J2_acceleration(input_r_vec, input_context.inclination_,
+                                  input_context.arg_of_periapsis_,
+                                  input_context.true_anomaly_));
+  }
+};
+
+class AtmosphericDrag {
+ public:
+  static constexpr ForceTerm force_term = ForceTerm::atmospheric_drag;
+  // The drag model is only nonzero between 140 and 400 km altitude, so this
+  // is zero outside of that band
+  static double estimate_acceleration_magnitude(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& input_velocity_vec,
+      const double input_evaluation_time, ForceModelContext& input_context) {
+    std::pair<double, double> space_weather =
+        input_context.get_space_weather(input_evaluation_time);
+    std::array<double, 3> drag_acceleration_vec =
+        calculate_atmospheric_drag_acceleration(
+            input_r_vec, input_velocity_vec, space_weather.first,
+            space_weather.second, input_context.A_s_,
+            input_context.spacecraft_mass_);
+    return sqrt(drag_acceleration_vec.at(0) * drag_acceleration_vec.at(0) +
+                drag_acceleration_vec.at(1) * drag_acceleration_vec.at(1) +
+                drag_acceleration_vec.at(2) * drag_acceleration_vec.at(2));
+  }
+  static void add_acceleration(const std::array<double, 3>& input_r_vec,
+                               const std::array<double, 3>& input_velocity_vec,
+                               const double input_evaluation_time,
+                               ForceModelContext& input_context,
+                               std::array<double, 3>& acceleration_vec) {
+    std::pair<double, double> space_weather =
+        input_context.get_space_weather(input_evaluation_time);
+    add_to_acceleration(
+        acceleration_vec,
+        calculate_atmospheric_drag_acceleration(
+            input_r_vec, input_velocity_vec, space_weather.first,
+            space_weather.second, input_context.A_s_,
+            input_context.spacecraft_mass_));
+  }
+};
+
+class ThirdBodyPerturbation {
+ public:
+  static constexpr ForceTerm force_term = ForceTerm::third_body;
+  // Upper bound on the Sun and Moon tidal accelerations at this distance from
+  // the Earth (reached when the satellite lies on the Earth-body line)
+  static double estimate_acceleration_magnitude(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& /*input_velocity_vec*/,
+      const double input_evaluation_time, ForceModelContext& input_context) {
+    double distance = sqrt(input_r_vec.at(0) * input_r_vec.at(0) +
+                           input_r_vec.at(1) * input_r_vec.at(1) +
+                           input_r_vec.at(2) * input_r_vec.at(2));
+    auto calculate_tidal_bound = [distance](
+                                     const std::array<double, 3>& body_position,
+                                     const double body_mu) {
+      double body_distance = sqrt(body_position.at(0) * body_position.at(0) +
+                                  body_position.at(1) * body_position.at(1) +
+                                  body_position.at(2) * body_position.at(2));
+      return body_mu * (1 / pow(body_distance - distance, 2) -
+                        1 / pow(body_distance, 2));
+    };
+    return calculate_tidal_bound(
+               input_context.get_sun_position_ECI(input_evaluation_time),
+               mu_Sun) +
+           calculate_tidal_bound(
+               input_context.get_moon_position_ECI(input_evaluation_time),
+               mu_Moon);
+  }
+  static void add_acceleration(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& /*input_velocity_vec*/,
+      const double input_evaluation_time,
+      ForceModelContext& input_context,
+      std::array<double, 3>& acceleration_vec) {
+    // Point-mass perturbations from the Sun and Moon
+    std::array<double, 3> sun_position =
+        input_context.get_sun_position_ECI(input_evaluation_time);
+    std::array<double, 3> moon_position =
+        input_context.get_moon_position_ECI(input_evaluation_time);
+    add_to_acceleration(
+        acceleration_vec,
+        calculate_third_body_acceleration(input_r_vec, sun_position, mu_Sun));
+    add_to_acceleration(acceleration_vec,
+                        calculate_third_body_acceleration(
+                            input_r_vec, moon_position, mu_Moon));
+  }
+};
+
+class SolarRadiationPressure {
+ public:
+  static constexpr ForceTerm force_term = ForceTerm::solar_radiation_pressure;
+  // Acceleration in full sunlight. Shadowing is left out so the term isn't
+  // dropped and restored at every eclipse
+  static double estimate_acceleration_magnitude(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& /*input_velocity_vec*/,
+      const double input_evaluation_time, ForceModelContext& input_context) {
+    std::array<double, 3> sun_position =
+        input_context.get_sun_position_ECI(input_evaluation_time);
+    double sun_to_satellite_distance =
+        sqrt(pow(input_r_vec.at(0) - sun_position.at(0), 2) +
+             pow(input_r_vec.at(1) - sun_position.at(1), 2) +
+             pow(input_r_vec.at(2) - sun_position.at(2), 2));
+    return solar_radiation_pressure_1AU * input_context.C_R_ *
+           input_context.A_srp_ / input_context.spacecraft_mass_ *
+           pow(astronomical_unit / sun_to_satellite_distance, 2);
+  }
+  static void add_acceleration(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& /*input_velocity_vec*/,
+      const double input_evaluation_time,
+      ForceModelContext& input_context,
+      std::array<double, 3>& acceleration_vec) {
+    add_to_acceleration(
+        acceleration_vec,
+        calculate_solar_radiation_pressure_acceleration(
+            input_r_vec,
+            input_context.get_sun_position_ECI(input_evaluation_time),
+            input_context.A_srp_, input_context.C_R_,
+            input_context.spacecraft_mass_));
+  }
+};
+
+template <typename... ForceTerms>
+class ForceModelPipeline {
+  // Compile-time composition of the given force term classes, summed in the
+  // order given
+ public:
+  static constexpr unsigned int force_term_mask =
+      (0u | ... | force_term_bit(ForceTerms::force_term));
+
+  static std::array<double, 3> calculate_acceleration(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& input_velocity_vec,
+      const double input_evaluation_time, ForceModelContext& input_context) {
+    std::array<double, 3> acceleration_vec = {0, 0, 0};
+    (ForceTerms::add_acceleration(input_r_vec, input_velocity_vec,
+                                  input_evaluation_time, input_context,
+                                  acceleration_vec),
+     ...);
+    return acceleration_vec;
+  }
+};
+
+template <typename Term>
+class RuntimeSelectedTerm {
+  // Wraps a force term so that it's only applied if enabled in the context's
+  // force term mask
+ public:
+  static constexpr ForceTerm force_term = Term::force_term;
+  static void add_acceleration(const std::array<double, 3>& input_r_vec,
+                               const std::array<double, 3>& input_velocity_vec,
+                               const double input_evaluation_time,
+                               ForceModelContext& input_context,
+                               std::array<double, 3>& acceleration_vec) {
+    if (input_context.force_term_mask_ & force_term_bit(Term::force_term)) {
+      Term::add_acceleration(input_r_vec, input_velocity_vec,
+                             input_evaluation_time, input_context,
+                             acceleration_vec);
+    }
+  }
+};
+
+// The common configurations, which get their own specialized time evolution.
+// Any other combination of terms falls back to RuntimeForceModel, which
+// branches on the context's force term mask at every evaluation
+using TwoBodyForceModel = ForceModelPipeline<CentralBodyGravity>;
+using TwoBodyThrustForceModel =
+    ForceModelPipeline<CentralBodyGravity, ThrustAcceleration>;
+using J2ForceModel = ForceModelPipeline<CentralBodyGravity, J2Perturbation>;
+using J2ThrustForceModel =
+    ForceModelPipeline<CentralBodyGravity, ThrustAcceleration, J2Perturbation>;
+using J2DragForceModel =
+    ForceModelPipeline<CentralBodyGravity, J2Perturbation, AtmosphericDrag>;
+using J2DragThrustForceModel =
+    ForceModelPipeline<CentralBodyGravity, ThrustAcceleration, J2Perturbation,
+                       AtmosphericDrag>;
+using J2SunMoonSRPForceModel =
+    ForceModelPipeline<CentralBodyGravity, J2Perturbation,
+                       ThirdBodyPerturbation, SolarRadiationPressure>;
+using RuntimeForceModel =
+    ForceModelPipeline<RuntimeSelectedTerm<CentralBodyGravity>,
+                       RuntimeSelectedTerm<ThrustAcceleration>,
+                       RuntimeSelectedTerm<J2Perturbation>,
+                       RuntimeSelectedTerm<AtmosphericDrag>,
+                       RuntimeSelectedTerm<ThirdBodyPerturbation>,
+                       RuntimeSelectedTerm<SolarRadiationPressure>>;
+
+// Torques which depend on the satellite's state, evaluated at each RK stage.
+// Each is a class with a static function
+//   Vector3d calculate_bodyframe_torque(r, v, LVLH_to_bodyframe, t, ...)
+// returning the torque in the body frame, where LVLH_to_bodyframe is the
+// rotation from the LVLH frame to the body frame at that stage
+
+class MagneticTorque {
+  // Torque m x B on the satellite's magnetic dipole (commanded magnetorquer
+  // dipole plus residual dipole), in the body frame
+ public:
+  static Vector3d calculate_bodyframe_torque(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& input_velocity_vec,
+      const Matrix3d& input_LVLH_to_bodyframe_transformation_matrix,
+      const double input_evaluation_time, ForceModelContext& input_context) {
+    std::array<double, 3> magnetic_dipole =
+        input_context.residual_magnetic_dipole_;
+    if (input_context.magnetorquer_dipole_schedule_ != nullptr) {
+      const std::array<double, 3>& commanded_dipole =
+          input_context.magnetorquer_dipole_schedule_->get_value(
+              input_evaluation_time);
+      for (size_t ind = 0; ind < 3; ind++) {
+        magnetic_dipole.at(ind) += commanded_dipole.at(ind);
+      }
+    }
+    std::array<double, 3> magnetic_field_LVLH = convert_ECI_to_LVLH_manual(
+        input_context.get_magnetic_field_ECI(input_r_vec,
+                                             input_evaluation_time),
+        input_r_vec, input_velocity_vec);
+    Vector3d magnetic_field_bodyframe =
+        input_LVLH_to_bodyframe_transformation_matrix *
+        Vector3d(magnetic_field_LVLH.at(0), magnetic_field_LVLH.at(1),
+                 magnetic_field_LVLH.at(2));
+    return Vector3d(magnetic_dipole.at(0), magnetic_dipole.at(1),
+                    magnetic_dipole.at(2))
+        .cross(magnetic_field_bodyframe);
+  }
+};
+
+class GravityGradientTorque {
+  // Torque from the variation of the Earth's (point-mass) gravity across the
+  // body, 3 mu / r^3 (n x J n) with n the nadir unit vector in the body
+  // frame. Ref: Wertz, Spacecraft Attitude Determination and Control, section
+  // 17.2, and
+  // https://ntrs.nasa.gov/api/citations/20240009554/downloads/Space%20Attitude%20Development%20Control.pdf
+ public:
+  static Vector3d calculate_bodyframe_torque(
+      const std::array<double, 3>& input_r_vec,
+      const Matrix3d& input_LVLH_to_bodyframe_transformation_matrix,
+      const InertiaTensor& input_inertia_tensor) {
+    double distance = sqrt(input_r_vec.at(0) * input_r_vec.at(0) +
+                           input_r_vec.at(1) * input_r_vec.at(1) +
+                           input_r_vec.at(2) * input_r_vec.at(2));
+    // The LVLH z-axis points to nadir, so the nadir direction in the body
+    // frame is the third column of the LVLH to body frame rotation
+    Vector3d nadir_bodyframe =
+        input_LVLH_to_bodyframe_transformation_matrix.col(2);
+    return (3 * G * mass_Earth / pow(distance, 3)) *
+           nadir_bodyframe.cross(
+               input_inertia_tensor.multiply(nadir_bodyframe));
+  }
+};
+
+class AerodynamicTorque {
+  // Torque from the drag force acting at the center of pressure, offset from
+  // the center of mass by center_of_pressure_offset_ (body frame)
+ public:
+  static Vector3d calculate_bodyframe_torque(
+      const std::array<double, 3>& input_r_vec,
+      const std::array<double, 3>& input_velocity_vec,
+      const Matrix3d& input_LVLH_to_bodyframe_transformation_matrix,
+      const double input_evaluation_time, ForceModelContext& input_context) {
+    std::pair<double, double> space_weather =
+        input_context.get_space_weather(input_evaluation_time);
+    std::array<double, 3> drag_acceleration_vec =
+        calculate_atmospheric_drag_acceleration(
+            input_r_vec, input_velocity_vec, space_weather.first,
+            space_weather.second, input_context.A_s_,
+            input_context.spacecraft_mass_);
+    if ((drag_acceleration_vec.at(0) == 0) &&
+        (drag_acceleration_vec.at(1) == 0) &&
+        (drag_acceleration_vec.at(2) == 0)) {
+      // Outside the atmosphere model's altitude range
+      return Vector3d::Zero();
+    }
+    std::array<double, 3> drag_acceleration_LVLH = convert_ECI_to_LVLH_manual(
+        drag_acceleration_vec, input_r_vec, input_velocity_vec);
+    Vector3d drag_force_bodyframe =
+        input_context.spacecraft_mass_ *
+        (input_LVLH_to_bodyframe_transformation_matrix *
+         Vector3d(drag_acceleration_LVLH.at(0), drag_acceleration_LVLH.at(1),
+                  drag_acceleration_LVLH.at(2)));
+    const std::array<double, 3>& offset =
+        input_context.center_of_pressure_offset_;
+    return Vector3d(offset.at(0), offset.at(1), offset.at(2))
+        .cross(drag_force_bodyframe);
+  }
+};
+
+template <typename OrbitalForceModel>
+class CombinedOrbitAttitudeDerivative {
+  // Time derivative of the combined state {ECI_position, ECI_velocity,
+  // bodyframe_rotation_vector, bodyframe_omega_wrt_LVLH, mass}, with the
+  // orbital acceleration given by OrbitalForceModel. Called as (y, t) by
+  // RK45_step.
+  //
+  // The attitude is integrated on the rotation group (a Runge-Kutta-Munthe-
+  // Kaas scheme): the state holds the rotation vector theta of the body frame
+  // relative to its orientation at the start of the step, so the attitude at
+  // any stage is step_start_quaternion_ * exp(theta), which has unit norm by
+  // construction. The gyroscopic and LVLH frame rotation terms are evaluated
+  // at each stage's attitude and angular velocity, so the error estimate
+  // reflects their variation over the step
+ public:
+  ForceModelContext& force_model_context_;
+  const InertiaTensor& inertia_tensor_;
+  PiecewiseConstantSchedule<3>& bodyframe_torque_schedule_;
+  // The orbit rate and angular acceleration are taken to be constant over
+  // the step
+  double orbital_rate_ = {0};
+  double orbital_angular_acceleration_ = {0};
+  std::array<double, 4> step_start_quaternion_ = {1, 0, 0, 0};
+
+  CombinedOrbitAttitudeDerivative(
+      ForceModelContext& input_force_model_context,
+      const InertiaTensor& input_inertia_tensor,
+      PiecewiseConstantSchedule<3>& input_bodyframe_torque_schedule,
+      const double input_orbital_rate,
+      const double input_orbital_angular_acceleration,
+      const std::array<double, 4> input_step_start_quaternion)
+      : force_model_context_(input_force_model_context),
+        inertia_tensor_(input_inertia_tensor),
+        bodyframe_torque_schedule_(input_bodyframe_torque_schedule),
+        orbital_rate_(input_orbital_rate),
+        orbital_angular_acceleration_(input_orbital_angular_acceleration),
+        step_start_quaternion_(input_step_start_quaternion) {}
+
+  std::array<double, 13> operator()(
+      const std::array<double, 13>& input_combined_array,
+      const double input_evaluation_time) {
+    std::array<double, 13> derivative_vec;
+    std::array<double, 3> position_array = {input_combined_array.at(0),
+                                            input_combined_array.at(1),
+                                            input_combined_array.at(2)};
+    std::array<double, 3> velocity_array = {input_combined_array.at(3),
+                                            input_combined_array.at(4),
+                                            input_combined_array.at(5)};
+    std::array<double, 6> combined_angular_array;
+    for (size_t ind = 0; ind < combined_angular_array.size(); ind++) {
+      combined_angular_array.at(ind) = input_combined_array.at(ind + 6);
+    }
+
+    // Thrust, drag and SRP accelerations use the mass at this stage
+    force_model_context_.spacecraft_mass_ = input_combined_array.at(12);
+    std::array<double, 3> orbital_acceleration =
+        OrbitalForceModel::calculate_acceleration(
+            position_array, velocity_array, input_evaluation_time,
+            force_model_context_);
+    // Attitude at this stage, and the attitude dynamics terms which depend on
+    // it
+    Matrix3d LVLH_to_bodyframe_transformation_matrix =
+        LVLH_to_body_transformation_matrix_from_quaternion(
+            apply_rotation_vector_to_quaternion(
+                step_start_quaternion_,
+                {combined_angular_array.at(0), combined_angular_array.at(1),
+                 combined_angular_array.at(2)}));
+    Vector3d omega_I = calculate_omega_I(
+        {combined_angular_array.at(3), combined_angular_array.at(4),
+         combined_angular_array.at(5)},
+        LVLH_to_bodyframe_transformation_matrix, orbital_rate_);
+    AttitudeStageTerms attitude_stage_terms = calculate_attitude_stage_terms(
+        inertia_tensor_, omega_I, orbital_angular_acceleration_,
+        LVLH_to_bodyframe_transformation_matrix, {0, -orbital_rate_, 0});
+    // Torques which depend on the state at this stage
+    Vector3d state_dependent_torque = Vector3d::Zero();
+    if (force_model_context_.magnetic_torque_enabled_ ||
+        force_model_context_.gravity_gradient_torque_enabled_ ||
+        force_model_context_.aerodynamic_torque_enabled_) {
+      if (force_model_context_.magnetic_torque_enabled_) {
+        state_dependent_torque += MagneticTorque::calculate_bodyframe_torque(
+            position_array, velocity_array,
+            LVLH_to_bodyframe_transformation_matrix, input_evaluation_time,
+            force_model_context_);
+      }
+      if (force_model_context_.gravity_gradient_torque_enabled_) {
+        state_dependent_torque +=
+            GravityGradientTorque::calculate_bodyframe_torque(
+                position_array, LVLH_to_bodyframe_transformation_matrix,
+                inertia_tensor_);
+      }
+      if (force_model_context_.aerodynamic_torque_enabled_) {
+        state_dependent_torque +=
+            AerodynamicTorque::calculate_bodyframe_torque(
+                position_array, velocity_array,
+                LVLH_to_bodyframe_transformation_matrix, input_evaluation_time,
+                force_model_context_);
+      }
+    }
+    std::array<double, 6> angular_derivative_array =
+        RK45_satellite_body_angular_deriv_function(
+            combined_angular_array, attitude_stage_terms,
+            bodyframe_torque_schedule_, input_evaluation_time,
+            state_dependent_torque);
+
+    for (size_t ind = 0; ind < 3; ind++) {
+      derivative_vec.at(ind) = velocity_array.at(ind);
+      derivative_vec.at(ind + 3) = orbital_acceleration.at(ind);
+    }
+    for (size_t ind = 0; ind < angular_derivative_array.size(); ind++) {
+      derivative_vec.at(ind + 6) = angular_derivative_array.at(ind);
+    }
+    derivative_vec.at(12) = 0;
+    if constexpr ((OrbitalForceModel::force_term_mask &
+                   force_term_bit(ForceTerm::thrust)) != 0) {
+      if (force_model_context_.force_term_mask_ &
+          force_term_bit(ForceTerm::thrust)) {
+        derivative_vec.at(12) = ThrustAcceleration::calculate_mass_derivative(
+            input_evaluation_time, force_model_context_);
+      }
+    }
+    return derivative_vec;
+  }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef GEOMAGNETIC_FIELD_HEADER
+#define GEOMAGNETIC_FIELD_HEADER
+
+#include <Eigen/Dense>
+#include <array>
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+// Define constants
+// Reference radius of the IGRF spherical harmonic expansion
+const double geomagnetic_reference_radius =
+    6371200.0;  // https://www.ngdc.noaa.gov/IAGA/vmod/igrf.html
+
+class GeomagneticField {
+  // Spherical harmonic model of the Earth's internal magnetic field, in the
+  // form used by the IGRF: Schmidt semi-normalized Gauss coefficients g_n^m
+  // and h_n^m (in nT) up to a maximum degree. Degree 1 is the tilted dipole.
+  // The default coefficients are the IGRF-13 main field at epoch 2020.0,
+  // which are tabulated up to degree 4; secular variation is neglected.
+  //
+  // The Legendre function and longitude recursion buffers are allocated once
+  // at construction, so evaluating the field doesn't allocate
+ private:
+  int max_degree_ = {1};
+  // Coefficients and Legendre buffers are stored in triangular order, with
+  // (n, m) at index n*(n+1)/2 + m
+  std::vector<double> g_coefficients_ = {};
+  std::vector<double> h_coefficients_ = {};
+  std::vector<double> P_buffer_ = {};
+  std::vector<double> dP_buffer_ = {};
+  std::vector<double> cos_m_phi_buffer_ = {};
+  std::vector<double> sin_m_phi_buffer_ = {};
+  size_t num_field_evaluations_ = {0};
+
+  static size_t triangular_index(const int n, const int m) {
+    return n * (n + 1) / 2 + m;
+  }
+  void allocate_buffers();
+
+ public:
+  static constexpr int max_tabulated_degree = 4;
+
+  GeomagneticField(const int input_max_degree = max_tabulated_degree);
+  // User-supplied coefficients in nT, in triangular order (g_1^0, g_1^1,
+  // g_2^0, ...), starting from degree 1
+  GeomagneticField(const std::vector<double>& input_g_coefficients,
+                   const std::vector<double>& input_h_coefficients,
+                   const int input_max_degree);
+  // Restores a field model written by write_checkpoint
+  explicit GeomagneticField(std::istream& input_checkpoint_stream);
+  void write_checkpoint(std::ostream& output_stream) const;
+
+  // Field vector in T, in the Earth-fixed (ECEF) frame, at the given ECEF
+  // position in m
+  std::array<double, 3> calculate_field_ECEF(
+      const std::array<double, 3>& input_ECEF_position);
+
+  int get_max_degree() { return max_degree_; }
+  size_t get_num_field_evaluations() { return num_field_evaluations_; }
+};
+
+// Field vector in T in the ECI frame, at the given ECI position, using the
+// ECI to ECEF rotation at the evaluation time
+std::array<double, 3> calculate_geomagnetic_field_ECI(
+    GeomagneticField& input_geomagnetic_field,
+    const Eigen::Matrix3d& input_ECI_to_ECEF_matrix,
+    const std::array<double, 3>& input_ECI_position);
+
+#endif
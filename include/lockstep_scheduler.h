@@ -0,0 +1,56 @@
+#ifndef LOCKSTEP_SCHEDULER_HEADER
+#define LOCKSTEP_SCHEDULER_HEADER
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "epoch.h"
+#include "satellite_store.h"
+
+class LockstepScheduler {
+  // Brings the satellites of a store to common absolute synchronization
+  // epochs, for analyses which compare satellites at the same instant (e.g.,
+  // conjunction screening or coverage). Satellites can have different epochs
+  // and step histories: each one takes its own adaptive RK45 steps from
+  // wherever it is to the synchronization epoch, with the last step cut short
+  // to land exactly on it, and keeps its step size for the next
+  // synchronization. Satellites in SGP4 mode take analytic steps instead, as
+  // in Satellite::evolve_RK45.
+  //
+  // Time is only propagated forwards, so each satellite's epoch must be at or
+  // before the first synchronization epoch
+ private:
+  double epsilon_ = {0};
+  std::vector<ForceTerm> force_terms_ = {};
+  std::pair<double, double> drag_elements_ = {};
+  double initial_timestep_ = {1};
+  // Step size for each satellite's next step, by handle
+  std::vector<double> next_timesteps_ = {};
+
+ public:
+  LockstepScheduler(const double input_epsilon,
+                    const std::vector<ForceTerm>& input_force_terms,
+                    const std::pair<double, double> drag_elements = {},
+                    const double input_initial_timestep = 1);
+
+  // Propagates every satellite in the store to input_sync_epoch. Returns 0,
+  // or the first nonzero error code from a satellite's step, in which case
+  // that satellite stops where the error occurred
+  int synchronize(SatelliteStore& input_satellite_store,
+                  const AbsoluteEpoch& input_sync_epoch);
+  // Synchronizes at input_num_syncs epochs, input_sync_interval seconds apart
+  // starting from input_first_sync_epoch, calling input_callback with each
+  // epoch once every satellite has reached it. Stops at the first error
+  int run(SatelliteStore& input_satellite_store,
+          const AbsoluteEpoch& input_first_sync_epoch,
+          const double input_sync_interval, const size_t input_num_syncs,
+          const std::function<void(const AbsoluteEpoch&, SatelliteStore&)>&
+              input_callback);
+
+  double get_next_timestep(const SatelliteHandle input_handle) const {
+    return next_timesteps_.at(input_handle.index);
+  }
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SATELLITE_STORE_HEADER
+#define SATELLITE_STORE_HEADER
+
+#include <string>
+#include <vector>
+
+#include "Satellite.h"
+
+// Lightweight reference to a satellite in a SatelliteStore, which stays valid
+// as more satellites are added
+struct SatelliteHandle {
+  size_t index = {0};
+};
+
+class SatelliteStore {
+  // Owns the satellites simulated together, e.g. a constellation. The
+  // Satellite objects are kept whole, each with its own name and plotting
+  // color, in one contiguous array. Functions operating on the store refer
+  // to satellites by handle rather than copying them, which is what the
+  // store saves over passing satellite vectors by value.
+  //
+  // The integrated state isn't split out of the Satellite objects into
+  // per-field arrays, since every Satellite member function works on its
+  // own fields; propagating a satellite through the store still touches the
+  // whole object, including its profile lists and shared environment
+ private:
+  std::vector<Satellite> satellites_ = {};
+
+ public:
+  SatelliteStore() {}
+  explicit SatelliteStore(std::vector<Satellite> input_satellite_vector);
+  // Restores a store written by write_checkpoint
+  explicit SatelliteStore(std::istream& input_checkpoint_stream);
+  void write_checkpoint(std::ostream& output_stream) const;
+
+  SatelliteHandle add_satellite(Satellite input_satellite);
+  SatelliteHandle add_satellite(const std::string input_file_name) {
+    return add_satellite(Satellite(input_file_name));
+  }
+  void reserve(const size_t input_num_satellites);
+
+  size_t size() const { return satellites_.size(); }
+  std::vector<SatelliteHandle> get_handles() const;
+
+  Satellite& get_satellite(const SatelliteHandle input_handle) {
+    return satellites_.at(input_handle.index);
+  }
+  const std::string& get_name(const SatelliteHandle input_handle) const {
+    return satellites_.at(input_handle.index).get_name();
+  }
+  const std::string& get_plotting_color(
+      const SatelliteHandle input_handle) const {
+    return satellites_.at(input_handle.index).plotting_color_;
+  }
+  // For operations over all satellites at once, e.g. share_environment
+  std::vector<Satellite>& get_satellites() { return satellites_; }
+};
+
+#endif
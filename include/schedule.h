@@ -0,0 +1,113 @@
+#ifndef SCHEDULE_HEADER
+#define SCHEDULE_HEADER
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "binary_io.h"
+
+template <size_t N>
+class PiecewiseConstantSchedule {
+  // Sum of a set of constant vectors, each active over a closed time window
+  // [t_start, t_end], compiled into a sorted timeline. The breakpoints of the
+  // timeline are the window boundaries; the summed value is stored both at each
+  // breakpoint and on the open interval after it, so that the closed-window
+  // semantics are reproduced exactly. Lookups go through a cursor which is
+  // moved from the previous lookup time, so for the (nearly) monotonic
+  // evaluation times of a time evolution each lookup is O(1) amortized and
+  // doesn't allocate.
+ private:
+  struct Window {
+    double t_start;
+    double t_end;
+    std::array<double, N> vec;
+  };
+  std::vector<Window> window_list_ = {};
+  bool needs_compile_ = {false};
+
+  std::vector<double> breakpoints_ = {};
+  // Summed value at breakpoints_[i] exactly
+  std::vector<std::array<double, N>> value_at_breakpoint_ = {};
+  // Summed value on the open interval (breakpoints_[i], breakpoints_[i+1])
+  std::vector<std::array<double, N>> value_after_breakpoint_ = {};
+  // Number of breakpoints at or before the most recent lookup time
+  size_t cursor_ = {0};
+  std::array<double, N> zero_vec_ = {};
+
+  void compile() {
+    breakpoints_.clear();
+    for (const Window& window : window_list_) {
+      breakpoints_.push_back(window.t_start);
+      breakpoints_.push_back(window.t_end);
+    }
+    std::sort(breakpoints_.begin(), breakpoints_.end());
+    breakpoints_.erase(std::unique(breakpoints_.begin(), breakpoints_.end()),
+                       breakpoints_.end());
+
+    value_at_breakpoint_.assign(breakpoints_.size(), zero_vec_);
+    value_after_breakpoint_.assign(breakpoints_.size(), zero_vec_);
+    for (const Window& window : window_list_) {
+      size_t start_ind =
+          std::lower_bound(breakpoints_.begin(), breakpoints_.end(),
+                           window.t_start) -
+          breakpoints_.begin();
+      size_t end_ind = std::lower_bound(breakpoints_.begin(),
+                                        breakpoints_.end(), window.t_end) -
+                       breakpoints_.begin();
+      for (size_t ind = start_ind; ind <= end_ind; ind++) {
+        for (size_t comp = 0; comp < N; comp++) {
+          value_at_breakpoint_[ind][comp] += window.vec[comp];
+          if (ind < end_ind) {
+            value_after_breakpoint_[ind][comp] += window.vec[comp];
+          }
+        }
+      }
+    }
+    cursor_ = 0;
+    needs_compile_ = false;
+  }
+
+ public:
+  PiecewiseConstantSchedule() {}
+  // Restores a schedule written by write_checkpoint. Only the windows are
+  // stored, the timeline is recompiled on the first lookup
+  explicit PiecewiseConstantSchedule(std::istream& input_checkpoint_stream) {
+    window_list_ = read_binary_vector<Window>(input_checkpoint_stream);
+    needs_compile_ = true;
+  }
+  void write_checkpoint(std::ostream& output_stream) const {
+    write_binary_vector(output_stream, window_list_);
+  }
+
+  void add_window(const double input_t_start, const double input_t_end,
+                  const std::array<double, N> input_vec) {
+    window_list_.push_back({input_t_start, input_t_end, input_vec});
+    needs_compile_ = true;
+  }
+
+  // Returns the sum of the vectors of all windows containing input_time
+  const std::array<double, N>& get_value(const double input_time) {
+    if (needs_compile_) {
+      compile();
+    }
+    while ((cursor_ < breakpoints_.size()) &&
+           (breakpoints_[cursor_] <= input_time)) {
+      cursor_++;
+    }
+    while ((cursor_ > 0) && (breakpoints_[cursor_ - 1] > input_time)) {
+      cursor_--;
+    }
+    if (cursor_ == 0) {
+      return zero_vec_;
+    }
+    if (breakpoints_[cursor_ - 1] == input_time) {
+      return value_at_breakpoint_[cursor_ - 1];
+    }
+    return value_after_breakpoint_[cursor_ - 1];
+  }
+
+  size_t get_num_windows() const { return window_list_.size(); }
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef SGP4_HEADER
+#define SGP4_HEADER
+
+#include <array>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "earth_orientation.h"
+#include "epoch.h"
+
+// Mean elements of one two-line element set (TLE), in the units used by the
+// TLE format. Ref: https://celestrak.org/columns/v04n03/
+struct TwoLineElementSet {
+  std::string name = "";
+  int catalog_number = {0};
+  AbsoluteEpoch epoch;
+  double bstar = {0};         // Drag term, in 1/(Earth radii)
+  double inclination = {0};   // deg
+  double raan = {0};          // deg
+  double eccentricity = {0};
+  double arg_of_perigee = {0};  // deg
+  double mean_anomaly = {0};    // deg
+  double mean_motion = {0};     // rev/day
+
+  TwoLineElementSet() {}
+  // Restores an element set written by write_checkpoint
+  explicit TwoLineElementSet(std::istream& input_checkpoint_stream);
+  void write_checkpoint(std::ostream& output_stream) const;
+};
+
+// Parses one element set from its two lines, checking the line numbers,
+// that both lines refer to the same satellite and the checksums
+TwoLineElementSet parse_TLE(const std::string& input_line_1,
+                            const std::string& input_line_2,
+                            const std::string input_name = "");
+// Reads every element set in a file, in either the two-line format or the
+// three-line format (with a name line before each element set)
+std::vector<TwoLineElementSet> load_TLE_file(
+    const std::string input_file_name);
+
+// Rotation from the true equator, mean equinox (TEME) frame SGP4 works in to
+// the J2000 ECI frame at the given Julian date, using the same precession and
+// nutation models as EarthOrientation. Ref: Vallado et al., Revisiting
+// Spacetrack Report #3, AIAA 2006-6753, appendix C
+Matrix3d calculate_TEME_to_ECI_matrix(const double input_julian_date);
+
+class SGP4Propagator {
+  // Analytic SGP4 propagation of TLEs, following Vallado et al., Revisiting
+  // Spacetrack Report #3, AIAA 2006-6753, with the WGS-72 constants the TLEs
+  // are generated with. Only the near-Earth model is implemented: element
+  // sets with periods of 225 minutes or more (which need the lunar-solar
+  // terms of the deep-space model) are rejected.
+  //
+  // The constants set up from each element set are stored as one array per
+  // constant, indexed by element set, and propagation has no early exits
+  // (the Kepler equation is solved with a fixed number of iterations, and
+  // near-Earth sets with low perigees have their extra drag terms zeroed
+  // rather than skipped). Propagating a batch of element sets is then a
+  // single loop over element sets with the same operations for each, which
+  // the compiler can vectorize
+ private:
+  std::vector<TwoLineElementSet> element_sets_ = {};
+
+  // Constants from the element sets, named as in the reference
+  std::vector<double> inclo_ = {};
+  std::vector<double> nodeo_ = {};
+  std::vector<double> argpo_ = {};
+  std::vector<double> mo_ = {};
+  std::vector<double> ecco_ = {};
+  std::vector<double> bstar_ = {};
+  std::vector<double> no_unkozai_ = {};
+  std::vector<double> mdot_ = {};
+  std::vector<double> argpdot_ = {};
+  std::vector<double> nodedot_ = {};
+  std::vector<double> nodecf_ = {};
+  std::vector<double> cc1_ = {};
+  std::vector<double> cc4_ = {};
+  std::vector<double> cc5_ = {};
+  std::vector<double> t2cof_ = {};
+  std::vector<double> t3cof_ = {};
+  std::vector<double> t4cof_ = {};
+  std::vector<double> t5cof_ = {};
+  std::vector<double> d2_ = {};
+  std::vector<double> d3_ = {};
+  std::vector<double> d4_ = {};
+  std::vector<double> omgcof_ = {};
+  std::vector<double> xmcof_ = {};
+  std::vector<double> eta_ = {};
+  std::vector<double> delmo_ = {};
+  std::vector<double> sinmao_ = {};
+  std::vector<double> aycof_ = {};
+  std::vector<double> xlcof_ = {};
+  std::vector<double> con41_ = {};
+  std::vector<double> x1mth2_ = {};
+  std::vector<double> x7thm1_ = {};
+
+  void propagate_range(const size_t input_begin, const size_t input_end,
+                       const double* input_times,
+                       std::array<double, 3>* output_TEME_positions,
+                       std::array<double, 3>* output_TEME_velocities,
+                       int* output_error_codes) const;
+
+ public:
+  explicit SGP4Propagator(
+      const std::vector<TwoLineElementSet>& input_element_sets);
+
+  size_t get_num_element_sets() const { return element_sets_.size(); }
+  const TwoLineElementSet& get_element_set(const size_t input_index) const {
+    return element_sets_.at(input_index);
+  }
+
+  // Position (in m) and velocity (in m/s) in the TEME frame at input_time (in
+  // s since the element set's epoch). Returns 0 on success, otherwise the
+  // error code from the reference: 1 if the eccentricity has left [0, 1), 4
+  // if the semi-latus rectum is negative, or 6 if the satellite has decayed
+  // (is below the Earth's surface)
+  int propagate_element_set(const size_t input_index, const double input_time,
+                            std::array<double, 3>& output_TEME_position,
+                            std::array<double, 3>& output_TEME_velocity) const;
+  // Every element set at once, each to its own time since epoch (in s, one
+  // entry per element set), with error codes as in propagate_element_set.
+  // The output vectors are resized if needed
+  void propagate(const std::vector<double>& input_times,
+                 std::vector<std::array<double, 3>>& output_TEME_positions,
+                 std::vector<std::array<double, 3>>& output_TEME_velocities,
+                 std::vector<int>& output_error_codes) const;
+};
+
+#endif
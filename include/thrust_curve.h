@@ -0,0 +1,70 @@
+#ifndef THRUST_CURVE_HEADER
+#define THRUST_CURVE_HEADER
+
+#include <array>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ThrustCurveLVLH {
+  // Thrust whose magnitude and LVLH direction vary over time, defined by knots
+  // (time, magnitude, direction). Between knots, magnitude and direction are
+  // either linearly interpolated ("Linear") or interpolated with a monotone
+  // cubic Hermite spline ("Cubic"), which gives smooth ramp-up/ramp-down
+  // without overshooting the tabulated values (so e.g. the thrust never goes
+  // negative). Either way, the curve is stored as one cubic polynomial per
+  // segment and component, and lookups go through a cursor moved from the
+  // previous lookup time, as in PiecewiseConstantSchedule. The thrust is zero
+  // outside of [first knot time, last knot time]
+ private:
+  struct CubicSegment {
+    double t_start;
+    double t_end;
+    // Polynomial coefficients in (t - t_start), lowest order first, for the
+    // magnitude followed by the x, y, z direction components
+    std::array<std::array<double, 4>, 4> coefficients;
+  };
+  std::vector<CubicSegment> segment_list_ = {};
+  size_t cursor_ = {0};
+  double Isp_ = {0};
+
+  void build_segments(const std::vector<double>& input_times,
+                      const std::vector<std::array<double, 4>>& input_values,
+                      const std::string input_interpolation);
+  // Magnitude and (unnormalized) direction at the given time
+  std::array<double, 4> evaluate(const double input_time);
+
+ public:
+  ThrustCurveLVLH(const std::vector<double>& input_times,
+                  const std::vector<double>& input_thrust_magnitudes,
+                  const std::vector<std::array<double, 3>>& input_directions,
+                  const std::string input_interpolation = "Cubic",
+                  const double input_Isp = 0);
+  // Restores a curve written by write_checkpoint
+  explicit ThrustCurveLVLH(std::istream& input_checkpoint_stream);
+  void write_checkpoint(std::ostream& output_stream) const;
+
+  // LVLH thrust force at the given time, in N
+  std::array<double, 3> get_LVLH_force(const double input_time);
+  // Propellant mass flow rate at the given time, in kg/s (0 if no Isp)
+  double get_mass_flow_rate(const double input_time);
+
+  double get_t_start() const { return segment_list_.front().t_start; }
+  double get_t_end() const { return segment_list_.back().t_end; }
+  double get_Isp() const { return Isp_; }
+  size_t get_num_segments() const { return segment_list_.size(); }
+};
+
+// Load a thrust curve from a JSON file with fields "Time" (s), "Thrust" (N),
+// "Direction" (a single LVLH direction, or one per knot) and optionally
+// "Interpolation" ("Linear" or "Cubic", default "Cubic") and "Isp" (s)
+ThrustCurveLVLH load_thrust_curve_JSON(const std::string input_file_name);
+// Load a thrust curve from a CSV file with columns time, thrust, direction_x,
+// direction_y, direction_z. A header row is skipped if present
+ThrustCurveLVLH load_thrust_curve_CSV(
+    const std::string input_file_name,
+    const std::string input_interpolation = "Cubic",
+    const double input_Isp = 0);
+
+#endif
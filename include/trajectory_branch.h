@@ -0,0 +1,123 @@
+#ifndef TRAJECTORY_BRANCH_HEADER
+#define TRAJECTORY_BRANCH_HEADER
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Satellite.h"
+
+// State of a satellite at one accepted time step
+struct TrajectorySample {
+  double t = {0};
+  std::array<double, 3> ECI_position = {0, 0, 0};
+  std::array<double, 3> ECI_velocity = {0, 0, 0};
+  std::array<double, 4> quaternion = {1, 0, 0, 0};
+  double mass = {0};
+};
+
+class TrajectoryBranch {
+  // A satellite together with the trajectory it has followed, for what-if
+  // studies where several variants (e.g., different maneuver plans) start
+  // from the same state. fork() splits a branch into branches which share the
+  // trajectory recorded so far, and each branch then only records the samples
+  // after the fork. The shared samples are never modified, so sharing them
+  // is safe (copy-on-write: the part of the trajectory which differs between
+  // branches is the part each branch records itself).
+  //
+  // The trajectory is stored as a chain of segments: the read-only segments
+  // inherited from the branch's ancestors, followed by the samples this
+  // branch has recorded since it was last forked.
+  //
+  // A copy of the satellite is also kept every checkpoint_interval_ samples.
+  // When the maneuver plan is edited, every step before the earliest time the
+  // edit affects is still valid, so the branch rewinds to the last checkpoint
+  // before that time and only re-propagates from there. Like the samples,
+  // checkpoints are read-only once taken, so forked branches share the ones
+  // taken before the fork, and an edit replaces a checkpoint with an edited
+  // copy rather than modifying it
+ private:
+  struct BranchCheckpoint {
+    size_t num_samples;
+    double next_timestep;
+    std::shared_ptr<const Satellite> satellite;
+  };
+
+  Satellite satellite_;
+  std::vector<std::shared_ptr<const std::vector<TrajectorySample>>>
+      shared_segments_ = {};
+  std::vector<TrajectorySample> own_samples_ = {};
+  size_t num_shared_samples_ = {0};
+  // Step size suggested by the most recent accepted step
+  double next_timestep_ = {1};
+
+  std::vector<BranchCheckpoint> checkpoints_ = {};
+  size_t checkpoint_interval_ = {100};
+  // Settings of the most recent propagate call, reused to re-propagate after
+  // an edit to the plan
+  double epsilon_ = {0};
+  std::vector<ForceTerm> force_terms_ = {};
+  std::pair<double, double> drag_elements_ = {};
+
+  void record_sample();
+  void truncate_samples(const size_t input_num_samples);
+  void rewind_before(const double input_time);
+
+ public:
+  TrajectoryBranch(const Satellite& input_satellite,
+                   const double input_initial_timestep = 1);
+
+  // Propagates the satellite up to exactly input_t_end, recording a sample at
+  // every accepted step. Returns the error code of the first failed step, or
+  // 0
+  int propagate(const double input_t_end, const double input_epsilon,
+                const std::vector<ForceTerm>& input_force_terms,
+                const std::pair<double, double> drag_elements = {});
+
+  // Returns input_num_branches branches continuing from the current state.
+  // This branch's recorded samples and its checkpoints so far become shared
+  // with them, and it can keep being propagated as well. Each new branch gets
+  // its own copy of the satellite, with caches detached (see
+  // Satellite::detach_shared_caches), so that branches can be propagated in
+  // parallel
+  std::vector<TrajectoryBranch> fork(const size_t input_num_branches);
+
+  // Applies input_edit to the satellite (e.g., adding or changing thrust or
+  // torque profiles, or maneuvers), where input_earliest_affected_time is the
+  // earliest time at which the edit changes the dynamics. The branch rewinds
+  // to the last checkpoint before that time and re-propagates back to the
+  // time it had reached, with the settings of the most recent propagate call.
+  // Returns the error code of the re-propagation
+  int edit_plan(const double input_earliest_affected_time,
+                const std::function<void(Satellite&)>& input_edit);
+  // Edits to the LVLH thrust profiles, which work out the earliest affected
+  // time themselves
+  int add_LVLH_thrust_profile(const ThrustProfileLVLH input_thrust_profile);
+  int set_LVLH_thrust_profiles(
+      const std::vector<ThrustProfileLVLH>& input_thrust_profiles);
+  // Number of samples between checkpoints. Only affects checkpoints taken
+  // from then on
+  void set_checkpoint_interval(const size_t input_checkpoint_interval);
+  size_t get_num_checkpoints() const { return checkpoints_.size(); }
+
+  // The satellite, e.g. for adding thrust or torque profiles to a branch
+  Satellite& get_satellite() { return satellite_; }
+  size_t get_num_samples() const {
+    return num_shared_samples_ + own_samples_.size();
+  }
+  const TrajectorySample& get_sample(const size_t input_index) const;
+  std::vector<TrajectorySample> get_trajectory() const;
+};
+
+// Propagates each branch up to input_t_end, spreading the branches over
+// input_num_threads threads. Returns each branch's error code
+std::vector<int> propagate_branches(
+    std::vector<TrajectoryBranch>& input_branches, const double input_t_end,
+    const double input_epsilon,
+    const std::vector<ForceTerm>& input_force_terms,
+    const std::pair<double, double> drag_elements = {},
+    const size_t input_num_threads = 1);
+
+#endif
@@ -6,6 +6,8 @@
 #include <iostream>
 
 #include "Satellite.h"
+#include "satellite_store.h"
+#include "schedule.h"
 
 using Eigen::Matrix3d;
 using Eigen::MatrixXd;
@@ -16,16 +18,43 @@ std::array<double, 3> calculate_orbital_acceleration(
     const std::array<double, 3> input_r_vec, const double input_spacecraft_mass,
     const std::vector<std::array<double, 3>> input_vec_of_force_vectors_in_ECI =
         {});
-std::array<double, 3> calculate_orbital_acceleration(
-    const std::array<double, 3> input_r_vec, const double input_spacecraft_mass,
-    const std::vector<ThrustProfileLVLH> input_list_of_thrust_profiles_LVLH,
-    const double input_evaluation_time,
-    const std::array<double, 3> input_velocity_vec,
-    const double input_inclination, const double input_arg_of_periapsis,
-    const double input_true_anomaly, const double input_F_10,
+std::array<double, 3> calculate_central_body_acceleration(
+    const std::array<double, 3> input_r_vec);
+std::array<double, 3> calculate_J2_acceleration(
+    const std::array<double, 3> input_r_vec, const double input_inclination,
+    const double input_arg_of_periapsis, const double input_true_anomaly);
+std::array<double, 3> calculate_atmospheric_drag_acceleration(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_velocity_vec, const double input_F_10,
     const double input_A_p, const double input_A_s,
-    const double input_satellite_mass, const bool perturbation,
-    const bool atmospheric_drag);
+    const double input_satellite_mass);
+std::array<double, 3> calculate_third_body_acceleration(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_third_body_position_vec,
+    const double input_third_body_mu);
+double calculate_shadow_function(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_sun_position_vec);
+std::array<double, 3> calculate_solar_radiation_pressure_acceleration(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_sun_position_vec,
+    const double input_A_srp, const double input_C_R,
+    const double input_satellite_mass);
+std::vector<ForceTerm> force_terms_from_flags(
+    const bool perturbation, const bool atmospheric_drag, const bool third_body,
+    const bool solar_radiation_pressure);
+void share_environment(std::vector<Satellite>& input_satellite_vector);
+// Points the satellites set up from TLEs at one SGP4 propagator holding all
+// of their element sets, in satellite order, rather than one each (as they
+// have after being restored from a checkpoint, which only stores each
+// satellite's own element set)
+void share_SGP4_propagator(std::vector<Satellite>& input_satellite_vector);
+// Calls input_task for each index in [0, input_num_tasks), spread over
+// input_num_threads threads (including the calling one). If any calls throw,
+// the exception from the lowest index is rethrown once all threads finish
+void run_in_parallel(const size_t input_num_tasks,
+                     const size_t input_num_threads,
+                     const std::function<void(const size_t)>& input_task);
 
 std::array<double, 6> RK4_deriv_function_orbit_position_and_velocity(
     const std::array<double, 6> input_position_and_velocity,
@@ -96,11 +125,21 @@ std::array<double, T> RK4_step(
   return y_nplus1;
 }
 
+// The drivers propagate the satellites in the store in place, leaving them at
+// the end of the simulation. The overloads taking a vector of satellites
+// propagate a store built from it and leave the caller's satellites unchanged
+void sim_and_draw_orbit_gnuplot(
+    SatelliteStore& input_satellite_store, const double input_timestep,
+    const double input_total_sim_time, const double input_epsilon,
+    const bool perturbation = true, const bool atmospheric_drag = false,
+    const std::pair<double, double> drag_elements = {},
+    const bool third_body = false, const bool solar_radiation_pressure = false);
 void sim_and_draw_orbit_gnuplot(
     std::vector<Satellite> input_satellite_vector, const double input_timestep,
     const double input_total_sim_time, const double input_epsilon,
     const bool perturbation = true, const bool atmospheric_drag = false,
-    const std::pair<double, double> drag_elements = {});
+    const std::pair<double, double> drag_elements = {},
+    const bool third_body = false, const bool solar_radiation_pressure = false);
 
 template <int T>
 std::pair<std::array<double, T>, std::pair<double, double>> RK45_step(
@@ -153,9 +192,9 @@ std::pair<std::array<double, T>, std::pair<double, double>> RK45_step(
     std::array<double, T> k_vec_at_this_s;
     for (size_t s_ind = 0; s_ind < k_ind; s_ind++) {
       for (size_t y_val_ind = 0; y_val_ind < y_n.size(); y_val_ind++) {
-        y_n_evaluated_value.at(y_val_ind) += input_step_size *
-                                             RK_matrix(k_ind, s_ind) *
-                                             k_vec_vec.at(s_ind).at(y_val_ind);
+        // k_vec_vec already includes the factor of the step size
+        y_n_evaluated_value.at(y_val_ind) +=
+            RK_matrix(k_ind, s_ind) * k_vec_vec.at(s_ind).at(y_val_ind);
       }
     }
     std::array<double, 6> derivative_function_output =
@@ -228,31 +267,38 @@ std::array<double, 3> convert_ECI_to_LVLH_manual(
     const std::array<double, 3> input_ECI_vec,
     const std::array<double, 3> input_position_vec,
     const std::array<double, 3> input_velocity_vec);
-std::array<double, 6> RK45_deriv_function_orbit_position_and_velocity(
-    const std::array<double, 6> input_position_and_velocity,
-    const double input_spacecraft_mass,
-    const std::vector<ThrustProfileLVLH> input_list_of_thrust_profiles_LVLH,
-    const double input_evaluation_time, const double input_inclination,
-    const double input_arg_of_periapsis, const double input_true_anomaly,
-    const double input_F_10, const double input_A_p, const double input_A_s,
-    const double input_satellite_mass, const bool perturbation,
-    const bool atmospheric_drag);
 
 std::array<double, 3> convert_cylindrical_to_cartesian(
     const double input_r_comp, const double input_theta_comp,
     const double input_z_comp, const double input_theta);
+void sim_and_plot_orbital_elem_gnuplot(
+    SatelliteStore& input_satellite_store, const double input_timestep,
+    const double input_total_sim_time, const double input_epsilon,
+    const std::string input_orbital_element_name,
+    const bool perturbation = true, const bool atmospheric_drag = false,
+    const std::pair<double, double> drag_elements = {},
+    const bool third_body = false, const bool solar_radiation_pressure = false);
 void sim_and_plot_orbital_elem_gnuplot(
     std::vector<Satellite> input_satellite_vector, const double input_timestep,
     const double input_total_sim_time, const double input_epsilon,
     const std::string input_orbital_element_name,
     const bool perturbation = true, const bool atmospheric_drag = false,
-    const std::pair<double, double> drag_elements = {});
+    const std::pair<double, double> drag_elements = {},
+    const bool third_body = false, const bool solar_radiation_pressure = false);
+void sim_and_plot_attitude_evolution_gnuplot(
+    SatelliteStore& input_satellite_store, const double input_timestep,
+    const double input_total_sim_time, const double input_epsilon,
+    const std::string input_plotted_val_name, const bool perturbation = true,
+    const bool atmospheric_drag = false,
+    const std::pair<double, double> drag_elements = {},
+    const bool third_body = false, const bool solar_radiation_pressure = false);
 void sim_and_plot_attitude_evolution_gnuplot(
     std::vector<Satellite> input_satellite_vector, const double input_timestep,
     const double input_total_sim_time, const double input_epsilon,
     const std::string input_plotted_val_name, const bool perturbation = true,
     const bool atmospheric_drag = false,
-    const std::pair<double, double> drag_elements = {});
+    const std::pair<double, double> drag_elements = {},
+    const bool third_body = false, const bool solar_radiation_pressure = false);
 
 Matrix3d rollyawpitch_bodyframe_to_LVLH(
     const std::array<double, 3> input_bodyframe_vec, const double input_roll,
@@ -269,62 +315,77 @@ Vector4d quaternion_multiplication(const Vector4d quaternion_1,
 Vector4d quaternion_kinematics_equation(
     const Vector4d quaternion_of_bodyframe_relative_to_ref_frame,
     const Vector3d angular_velocity_vec_wrt_ref_frame_in_body_frame);
-std::array<double, 7> RK45_satellite_body_angular_deriv_function(
-    const std::array<double, 7> combined_bodyframe_angular_array,
-    const Matrix3d J_matrix,
-    const std::vector<BodyframeTorqueProfile>
-        input_bodyframe_torque_profile_list,
-    const Vector3d input_omega_I,
+// Terms of the attitude dynamics which depend on the bodyframe angular
+// velocity w.r.t. the inertial frame and on the attitude relative to the LVLH
+// frame, computed at each RK stage. The inertia tensor's inverse, which is
+// the same at every stage, is cached in the InertiaTensor itself
+struct AttitudeStageTerms {
+  const InertiaTensor* inertia_tensor = nullptr;
+  // -omega_I x (J omega_I)
+  Vector3d gyroscopic_torque;
+  Vector3d omega_LVLH_wrt_inertial_in_body_frame;
+  // Contribution of the LVLH frame's angular acceleration to the bodyframe
+  // angular acceleration w.r.t. the LVLH frame
+  Vector3d LVLH_angular_acceleration_term;
+};
+AttitudeStageTerms calculate_attitude_stage_terms(
+    const InertiaTensor& input_inertia_tensor, const Vector3d input_omega_I,
     const double input_orbital_angular_acceleration,
     const Matrix3d input_LVLH_to_bodyframe_transformation_matrix,
-    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH,
-    const double input_evaluation_time);
-std::array<double, 13>
-RK45_combined_orbit_position_velocity_attitude_deriv_function(
-    const std::array<double, 13>
-        combined_position_velocity_bodyframe_angular_array,
-    const Matrix3d J_matrix,
-    const std::vector<BodyframeTorqueProfile>
-        input_bodyframe_torque_profile_list,
-    const Vector3d input_omega_I, double input_orbital_angular_acceleration,
-    const Matrix3d input_LVLH_to_bodyframe_transformation_matrix,
-    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH,
-    const double input_spacecraft_mass,
-    const std::vector<ThrustProfileLVLH> input_list_of_thrust_profiles_LVLH,
-    const double input_evaluation_time, const double input_inclination,
-    const double input_arg_of_periapsis, const double input_true_anomaly,
-    const double input_F_10, const double input_A_p, const double input_A_s,
-    const bool perturbation, const bool atmospheric_drag);
-
-template <int T>
+    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH);
+Vector3d rotation_vector_kinematics_equation(
+    const Vector3d input_rotation_vector,
+    const Vector3d angular_velocity_vec_wrt_ref_frame_in_body_frame);
+std::array<double, 4> apply_rotation_vector_to_quaternion(
+    const std::array<double, 4> input_quaternion,
+    const Vector3d input_rotation_vector);
+std::array<double, 6> RK45_satellite_body_angular_deriv_function(
+    const std::array<double, 6> combined_bodyframe_angular_array,
+    const AttitudeStageTerms& input_stage_terms,
+    PiecewiseConstantSchedule<3>& input_bodyframe_torque_schedule,
+    const double input_evaluation_time,
+    const Vector3d input_state_dependent_bodyframe_torque = Vector3d::Zero());
+// Objective: add input_increment to input_output_value with compensated
+// summation. input_output_compensation holds the part of the earlier
+// increments lost to rounding, which is added back in here, and is replaced
+// by the rounding error of this addition, so that input_output_value stays
+// the accumulated sum rounded to a double and the error doesn't grow with
+// the number of increments. The rounding error is found as in Neumaier's
+// variant of Kahan summation, which also holds when the increment is the
+// larger of the two. Ref: Neumaier, Rundungsfehleranalyse einiger Verfahren
+// zur Summation endlicher Summen, ZAMM 54 (1974)
+inline void add_compensated(double& input_output_value,
+                            double& input_output_compensation,
+                            const double input_increment) {
+  double corrected_increment = input_increment + input_output_compensation;
+  double sum = input_output_value + corrected_increment;
+  if (fabs(input_output_value) >= fabs(corrected_increment)) {
+    input_output_compensation =
+        (input_output_value - sum) + corrected_increment;
+  } else {
+    input_output_compensation =
+        (corrected_increment - sum) + input_output_value;
+  }
+  input_output_value = sum;
+}
+template <int T, typename DerivativeFunction>
 std::pair<std::array<double, T>, std::pair<double, double>> RK45_step(
     const std::array<double, T> y_n, const double input_step_size,
-    std::function<std::array<double, T>(
-        const std::array<double, T>, const Matrix3d,
-        const std::vector<BodyframeTorqueProfile>, const Vector3d, const double,
-        const Matrix3d, const Vector3d, const double,
-        const std::vector<ThrustProfileLVLH>, const double, const double,
-        const double, const double, const double, const double, const double,
-        const bool, const bool)>
-        input_combined_derivative_function,
-    const Matrix3d J_matrix,
-    const std::vector<BodyframeTorqueProfile>
-        input_bodyframe_torque_profile_list,
-    const Vector3d input_omega_I, double input_orbital_angular_acceleration,
-    const Matrix3d input_LVLH_to_bodyframe_transformation_matrix,
-    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH,
-    const double input_spacecraft_mass,
-    const std::vector<ThrustProfileLVLH> input_list_of_thrust_profiles_LVLH,
-    const double input_inclination, const double input_arg_of_periapsis,
-    const double input_true_anomaly, const double input_F_10,
-    const double input_A_p, const double input_A_s, const bool perturbation,
-    const double atmospheric_drag, const double input_t_n,
-    const double input_epsilon) {
-  // Version for combined satellite orbital motion and attitude time evolution
+    DerivativeFunction& input_derivative_function, const double input_t_n,
+    const double input_epsilon,
+    std::array<double, T>* input_output_compensation = nullptr) {
+  // Version for combined satellite orbital motion and attitude time evolution.
+  // input_derivative_function is called as input_derivative_function(y, t)
+  // and is a template parameter rather than a std::function so that the
+  // derivative (and the force model inside it) can be inlined into the stages
   // Implementing RK4(5) method for its adaptive step size
   // Refs:https://en.wikipedia.org/wiki/Runge%E2%80%93Kutta%E2%80%93Fehlberg_method
   // ,
   // https://en.wikipedia.org/wiki/Runge%E2%80%93Kutta_methods#The_Runge%E2%80%93Kutta_method
+  // If input_output_compensation is given, the increment over the step is
+  // added to y_n with add_compensated, with one compensation term per
+  // component carried over from step to step (it's only updated by a step
+  // which is accepted)
 
   std::array<double, 6> nodes = {0.0, 1.0 / 4, 3.0 / 8, 12.0 / 13,
                                  1.0, 1.0 / 2};  // c coefficients
@@ -360,20 +421,13 @@ std::pair<std::array<double, T>, std::pair<double, double>> RK45_step(
     std::array<double, T> k_vec_at_this_s;
     for (size_t s_ind = 0; s_ind < k_ind; s_ind++) {
       for (size_t y_val_ind = 0; y_val_ind < y_n.size(); y_val_ind++) {
-        y_n_evaluated_value.at(y_val_ind) += input_step_size *
-                                             RK_matrix(k_ind, s_ind) *
-                                             k_vec_vec.at(s_ind).at(y_val_ind);
+        // k_vec_vec already includes the factor of the step size
+        y_n_evaluated_value.at(y_val_ind) +=
+            RK_matrix(k_ind, s_ind) * k_vec_vec.at(s_ind).at(y_val_ind);
       }
     }
     std::array<double, T> derivative_function_output =
-        input_combined_derivative_function(
-            y_n_evaluated_value, J_matrix, input_bodyframe_torque_profile_list,
-            input_omega_I, input_orbital_angular_acceleration,
-            input_LVLH_to_bodyframe_transformation_matrix,
-            input_omega_LVLH_wrt_inertial_in_LVLH, input_spacecraft_mass,
-            input_list_of_thrust_profiles_LVLH, evaluation_time,
-            input_inclination, input_arg_of_periapsis, input_true_anomaly,
-            input_F_10, input_A_p, input_A_s, perturbation, atmospheric_drag);
+        input_derivative_function(y_n_evaluated_value, evaluation_time);
     for (size_t y_val_ind = 0; y_val_ind < y_n.size(); y_val_ind++) {
       k_vec_at_this_s.at(y_val_ind) =
           input_step_size * derivative_function_output.at(y_val_ind);
@@ -383,11 +437,16 @@ std::pair<std::array<double, T>, std::pair<double, double>> RK45_step(
   }
 
   std::array<double, T> y_nplusone = y_n;
+  std::array<double, T> y_increment = {0};
 
   for (size_t s_ind = 0; s_ind < s; s_ind++) {
     for (size_t y_ind = 0; y_ind < y_n.size(); y_ind++) {
       double tmp = CH_vec.at(s_ind) * k_vec_vec.at(s_ind).at(y_ind);
-      y_nplusone.at(y_ind) += tmp;
+      if (input_output_compensation == nullptr) {
+        y_nplusone.at(y_ind) += tmp;
+      } else {
+        y_increment.at(y_ind) += tmp;
+      }
     }
   }
 
@@ -411,7 +470,16 @@ std::pair<std::array<double, T>, std::pair<double, double>> RK45_step(
 
   double h_new = 0.9 * input_step_size * std::pow(epsilon_ratio, 1.0 / 5);
 
-  if (max_TE <= input_epsilon) {
+  // A non-finite error estimate can't be reduced by shortening the step, so
+  // the step is returned as is and the caller's state check reports it
+  if ((max_TE <= input_epsilon) || !std::isfinite(max_TE)) {
+    if (input_output_compensation != nullptr) {
+      for (size_t y_ind = 0; y_ind < y_n.size(); y_ind++) {
+        add_compensated(y_nplusone.at(y_ind),
+                        input_output_compensation->at(y_ind),
+                        y_increment.at(y_ind));
+      }
+    }
     std::pair<double, double> output_timestep_pair;
     output_timestep_pair.first =
         input_step_size;  // First timestep size in this pair is the one
@@ -424,15 +492,8 @@ std::pair<std::array<double, T>, std::pair<double, double>> RK45_step(
     output_pair.second = output_timestep_pair;
     return output_pair;
   } else {
-    return RK45_step<T>(
-        y_n, h_new, input_combined_derivative_function, J_matrix,
-        input_bodyframe_torque_profile_list, input_omega_I,
-        input_orbital_angular_acceleration,
-        input_LVLH_to_bodyframe_transformation_matrix,
-        input_omega_LVLH_wrt_inertial_in_LVLH, input_spacecraft_mass,
-        input_list_of_thrust_profiles_LVLH, input_inclination,
-        input_arg_of_periapsis, input_true_anomaly, input_F_10, input_A_p,
-        input_A_s, perturbation, atmospheric_drag, input_t_n, input_epsilon);
+    return RK45_step<T>(y_n, h_new, input_derivative_function, input_t_n,
+                        input_epsilon, input_output_compensation);
   }
 }
 Vector3d calculate_omega_I(
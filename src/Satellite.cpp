@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <iostream>
 #define _USE_MATH_DEFINES
 #include <Eigen/Dense>
@@ -6,6 +7,8 @@
 #include <cmath>
 
 #include "Satellite.h"
+#include "binary_io.h"
+#include "force_model.h"
 #include "utils.h"
 using Eigen::Matrix3d;
 using Eigen::MatrixXd;
@@ -17,6 +20,7 @@ using Eigen::Vector3d;
 // Objective: given the semimajor axis of an orbit, calculate its orbital period
 double Satellite::calculate_orbital_period() {
   // https://en.wikipedia.org/wiki/Orbital_period
+  refresh_orbital_elements();
   double T = 2 * M_PI * sqrt(pow(a_, 3) / (G * mass_Earth));
   return T;
 }
@@ -43,6 +47,7 @@ std::pair<double, double> Satellite::calculate_eccentric_anomaly(
 // Objective: calculate the perifocal position of the satellite
 std::array<double, 3> Satellite::calculate_perifocal_position() {
   // Using approach from Fundamentals of Astrodynamics
+  refresh_orbital_elements();
   std::array<double, 3> calculated_perifocal_position;
   double mu = G * mass_Earth;
 
@@ -64,6 +69,7 @@ std::array<double, 3> Satellite::calculate_perifocal_position() {
 // Objective: calculate the perifocal velocity of the satellite
 std::array<double, 3> Satellite::calculate_perifocal_velocity() {
   // Using approach from Fundamentals of Astrodynamics
+  refresh_orbital_elements();
   std::array<double, 3> calculated_perifocal_velocity;
   double mu = G * mass_Earth;
   double p =
@@ -79,103 +85,152 @@ std::array<double, 3> Satellite::calculate_perifocal_velocity() {
   return calculated_perifocal_velocity;
 }
 
-// Objective: convert a vector from perifocal frame to ECI coordinates
-std::array<double, 3> Satellite::convert_perifocal_to_ECI(
-    const std::array<double, 3> input_perifocal_vec) {
+// Objective: return the rotation matrix from the perifocal frame to ECI
+// coordinates, rebuilding it only if RAAN, inclination or argument of
+// periapsis have changed since it was last built
+const Matrix3d& Satellite::get_perifocal_to_ECI_matrix() {
   // Method from Fundamentals of Astrodynamics
   // Sounds like what they describe as their "Geocentric-Equatorial" coordinate
   // system is ECI
-  Matrix3d R_tilde_matrix;
-
-  R_tilde_matrix(0, 0) =
-      cos(raan_) * cos(arg_of_periapsis_) -
-      sin(raan_) * sin(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(0, 1) =
-      -cos(raan_) * sin(arg_of_periapsis_) -
-      sin(raan_) * cos(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(0, 2) = sin(raan_) * sin(inclination_);
-
-  R_tilde_matrix(1, 0) =
-      sin(raan_) * cos(arg_of_periapsis_) +
-      cos(raan_) * sin(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(1, 1) =
-      -sin(raan_) * sin(arg_of_periapsis_) +
-      cos(raan_) * cos(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(1, 2) = -cos(raan_) * sin(inclination_);
-
-  R_tilde_matrix(2, 0) = sin(arg_of_periapsis_) * sin(inclination_);
-
-  R_tilde_matrix(2, 1) = cos(arg_of_periapsis_) * sin(inclination_);
-
-  R_tilde_matrix(2, 2) = cos(inclination_);
-
-  // convert to Eigen vectors just to make sure matrix-vector multiplication is
-  // done correctly
-  Vector3d vector_ijk(0, 0, 0);
-  Vector3d vector_pqw(0, 0, 0);
-
-  vector_pqw(0) = input_perifocal_vec.at(0);
-  vector_pqw(1) = input_perifocal_vec.at(1);
-  vector_pqw(2) = input_perifocal_vec.at(2);
-
-  vector_ijk = R_tilde_matrix * vector_pqw;
-  std::array<double, 3> output_vector_ijk = {vector_ijk(0), vector_ijk(1),
-                                             vector_ijk(2)};
+  refresh_orbital_elements();
+  if ((raan_ == perifocal_to_ECI_angles_.at(0)) &&
+      (inclination_ == perifocal_to_ECI_angles_.at(1)) &&
+      (arg_of_periapsis_ == perifocal_to_ECI_angles_.at(2))) {
+    return perifocal_to_ECI_matrix_;
+  }
+  const double cos_raan = cos(raan_);
+  const double sin_raan = sin(raan_);
+  const double cos_inclination = cos(inclination_);
+  const double sin_inclination = sin(inclination_);
+  const double cos_arg_of_periapsis = cos(arg_of_periapsis_);
+  const double sin_arg_of_periapsis = sin(arg_of_periapsis_);
+
+  perifocal_to_ECI_matrix_(0, 0) =
+      cos_raan * cos_arg_of_periapsis -
+      sin_raan * sin_arg_of_periapsis * cos_inclination;
+  perifocal_to_ECI_matrix_(0, 1) =
+      -cos_raan * sin_arg_of_periapsis -
+      sin_raan * cos_arg_of_periapsis * cos_inclination;
+  perifocal_to_ECI_matrix_(0, 2) = sin_raan * sin_inclination;
+
+  perifocal_to_ECI_matrix_(1, 0) =
+      sin_raan * cos_arg_of_periapsis +
+      cos_raan * sin_arg_of_periapsis * cos_inclination;
+  perifocal_to_ECI_matrix_(1, 1) =
+      -sin_raan * sin_arg_of_periapsis +
+      cos_raan * cos_arg_of_periapsis * cos_inclination;
+  perifocal_to_ECI_matrix_(1, 2) = -cos_raan * sin_inclination;
+
+  perifocal_to_ECI_matrix_(2, 0) = sin_arg_of_periapsis * sin_inclination;
+  perifocal_to_ECI_matrix_(2, 1) = cos_arg_of_periapsis * sin_inclination;
+  perifocal_to_ECI_matrix_(2, 2) = cos_inclination;
+
+  perifocal_to_ECI_angles_ = {raan_, inclination_, arg_of_periapsis_};
+  return perifocal_to_ECI_matrix_;
+}
 
-  return output_vector_ijk;
+// Objective: convert a vector from perifocal frame to ECI coordinates
+std::array<double, 3> Satellite::convert_perifocal_to_ECI(
+    const std::array<double, 3> input_perifocal_vec) {
+  Vector3d vector_ijk =
+      get_perifocal_to_ECI_matrix() *
+      Vector3d(input_perifocal_vec.at(0), input_perifocal_vec.at(1),
+               input_perifocal_vec.at(2));
+  return {vector_ijk(0), vector_ijk(1), vector_ijk(2)};
 }
 
 // Objective: convert vector from ECI frame to perifocal frame
 std::array<double, 3> Satellite::convert_ECI_to_perifocal(
     const std::array<double, 3> input_ECI_vec) {
-  // Method from Fundamentals of Astrodynamics, and using
-  // https://en.wikipedia.org/wiki/Perifocal_coordinate_system Sounds like what
-  // they describe as their "Geocentric-Equatorial" coordinate system is ECI
-  Matrix3d R_tilde_matrix;
-
-  R_tilde_matrix(0, 0) =
-      cos(raan_) * cos(arg_of_periapsis_) -
-      sin(raan_) * sin(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(0, 1) =
-      -cos(raan_) * sin(arg_of_periapsis_) -
-      sin(raan_) * cos(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(0, 2) = sin(raan_) * sin(inclination_);
-
-  R_tilde_matrix(1, 0) =
-      sin(raan_) * cos(arg_of_periapsis_) +
-      cos(raan_) * sin(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(1, 1) =
-      -sin(raan_) * sin(arg_of_periapsis_) +
-      cos(raan_) * cos(arg_of_periapsis_) * cos(inclination_);
-
-  R_tilde_matrix(1, 2) = -cos(raan_) * sin(inclination_);
+  // Ref: https://en.wikipedia.org/wiki/Perifocal_coordinate_system
+  // Rotation matrix, so the inverse is the transpose
+  Vector3d vector_pqw =
+      get_perifocal_to_ECI_matrix().transpose() *
+      Vector3d(input_ECI_vec.at(0), input_ECI_vec.at(1), input_ECI_vec.at(2));
+  return {vector_pqw(0), vector_pqw(1), vector_pqw(2)};
+}
 
-  R_tilde_matrix(2, 0) = sin(arg_of_periapsis_) * sin(inclination_);
+// Objective: write back the satellite's ECI position and velocity after they
+// change, e.g., over a time step or at an impulsive maneuver. Quantities
+// derived from them are recomputed when next read
+void Satellite::update_ECI_state(const std::array<double, 3>& input_position,
+                                 const std::array<double, 3>& input_velocity) {
+  ECI_position_ = input_position;
+  ECI_velocity_ = input_velocity;
+  mark_orbital_state_changed();
+}
 
-  R_tilde_matrix(2, 1) = cos(arg_of_periapsis_) * sin(inclination_);
+// Objective: advance the time by one step, see compensated_summation_enabled_
+// and split_time_enabled_
+void Satellite::advance_time(const double input_timestep) {
+  if (split_time_enabled_) {
+    if (compensated_summation_enabled_) {
+      add_compensated(t_fraction_, t_compensation_, input_timestep);
+    } else {
+      t_fraction_ += input_timestep;
+    }
+    // Moving the whole seconds out of the fraction is exact
+    double whole_seconds = floor(t_fraction_);
+    t_whole_seconds_ += static_cast<int64_t>(whole_seconds);
+    t_fraction_ -= whole_seconds;
+    t_ = t_whole_seconds_ + (t_fraction_ + t_compensation_);
+  } else if (compensated_summation_enabled_) {
+    add_compensated(t_, t_compensation_, input_timestep);
+  } else {
+    t_ += input_timestep;
+  }
+}
 
-  R_tilde_matrix(2, 2) = cos(inclination_);
+// Objective: set the time to exactly input_time, discarding the accumulated
+// rounding error
+void Satellite::set_time(const double input_time) {
+  t_ = input_time;
+  t_compensation_ = 0;
+  if (split_time_enabled_) {
+    double whole_seconds = floor(input_time);
+    t_whole_seconds_ = static_cast<int64_t>(whole_seconds);
+    t_fraction_ = input_time - whole_seconds;
+  }
+}
 
-  // convert to Eigen vectors just to make sure matrix-vector multiplication is
-  // done correctly
-  Vector3d vector_ijk(0, 0, 0);
-  Vector3d vector_pqw(0, 0, 0);
-  vector_ijk(0) = input_ECI_vec.at(0);
-  vector_ijk(1) = input_ECI_vec.at(1);
-  vector_ijk(2) = input_ECI_vec.at(2);
+AbsoluteEpoch Satellite::get_current_epoch() {
+  if (split_time_enabled_) {
+    return epoch_.add_seconds(static_cast<double>(t_whole_seconds_))
+        .add_seconds(t_fraction_ + t_compensation_);
+  }
+  return epoch_.add_seconds(t_);
+}
 
-  vector_pqw = (R_tilde_matrix.inverse()) * vector_ijk;
-  std::array<double, 3> output_vector_pqw = {vector_pqw(0), vector_pqw(1),
-                                             vector_pqw(2)};
+void Satellite::set_compensated_summation(const bool input_enabled) {
+  compensated_summation_enabled_ = input_enabled;
+  if (!input_enabled) {
+    // Plain accumulation continues from the current rounded values
+    if (split_time_enabled_) {
+      t_fraction_ += t_compensation_;
+    }
+    t_compensation_ = 0;
+    state_compensation_.fill(0);
+  }
+}
 
-  return output_vector_pqw;
+void Satellite::set_split_time(const bool input_enabled) {
+  if (input_enabled && !split_time_enabled_) {
+    // t_compensation_ applies to the fraction just as it did to t_
+    double whole_seconds = floor(t_);
+    t_whole_seconds_ = static_cast<int64_t>(whole_seconds);
+    t_fraction_ = t_ - whole_seconds;
+  } else if (!input_enabled && split_time_enabled_) {
+    // t_ is already the rounded time, so only what it lost to rounding needs
+    // to be kept
+    t_compensation_ =
+        ((t_whole_seconds_ - t_) + t_fraction_) + t_compensation_;
+    if (!compensated_summation_enabled_) {
+      t_compensation_ = 0;
+    }
+    t_whole_seconds_ = 0;
+    t_fraction_ = 0;
+  }
+  split_time_enabled_ = input_enabled;
 }
 
 // Objective: evolve position and velocity (combined into one vector) one
@@ -239,32 +294,85 @@ void Satellite::evolve_RK4(const double input_step_size) {
   // std::array<double,6> output_combined_angular_array=
   // RK4_step<6>(combined_initial_angular_array,input_step_size,RK4_deriv_function_angular,I_,list_of_body_frame_torques_at_this_time_,list_of_body_frame_torques_at_half_timestep_past,list_of_body_frame_torques_at_one_timestep_past);
 
-  for (size_t ind = 0; ind < 3; ind++) {
-    ECI_position_.at(ind) = output_combined_position_and_velocity_array.at(ind);
-    ECI_velocity_.at(ind) =
-        output_combined_position_and_velocity_array.at(ind + 3);
-    // also update the perifocal versions
-    perifocal_position_ = convert_ECI_to_perifocal(ECI_position_);
-    perifocal_velocity_ = convert_ECI_to_perifocal(ECI_velocity_);
-  }
-  t_ += input_step_size;
+  update_ECI_state({output_combined_position_and_velocity_array.at(0),
+                    output_combined_position_and_velocity_array.at(1),
+                    output_combined_position_and_velocity_array.at(2)},
+                   {output_combined_position_and_velocity_array.at(3),
+                    output_combined_position_and_velocity_array.at(4),
+                    output_combined_position_and_velocity_array.at(5)});
+  advance_time(input_step_size);
 
   list_of_LVLH_forces_at_this_time_ = list_of_LVLH_forces_at_one_timestep_past;
   list_of_ECI_forces_at_this_time_ = list_of_ECI_forces_at_one_timestep_past;
 
-  // Update orbital parameters
-  update_orbital_elements_from_position_and_velocity();
-
   return;
 }
 
+// Objective: store a thrust profile and add it to the thrust schedule, along
+// with the propellant mass flow rate it causes
+// Objective: check that propellant-consuming thrust with the given Isp can be
+// added, i.e., that there is a dry mass at which the thrust cuts out. Without
+// one, the mass would be driven towards 0 and the step would fail
+void Satellite::check_dry_mass_for_Isp(const double input_Isp) const {
+  if ((input_Isp > 0) && (dry_mass_ <= 0)) {
+    throw std::invalid_argument(
+        "Thrust with a specific impulse needs a positive \"Dry Mass\"");
+  }
+}
+
+void Satellite::add_thrust_profile_to_schedule(
+    const ThrustProfileLVLH input_thrust_profile) {
+  check_dry_mass_for_Isp(input_thrust_profile.Isp_);
+  thrust_profile_list_.push_back(input_thrust_profile);
+  std::array<double, 4> force_and_mass_flow_rate = {
+      input_thrust_profile.LVLH_force_vec_.at(0),
+      input_thrust_profile.LVLH_force_vec_.at(1),
+      input_thrust_profile.LVLH_force_vec_.at(2),
+      input_thrust_profile.calculate_mass_flow_rate()};
+  thrust_schedule_LVLH_.add_window(input_thrust_profile.t_start_,
+                                   input_thrust_profile.t_end_,
+                                   force_and_mass_flow_rate);
+}
+
+void Satellite::set_LVLH_thrust_profiles(
+    const std::vector<ThrustProfileLVLH>& input_thrust_profiles) {
+  // Checked up front, so that the existing profiles are kept on failure
+  for (const ThrustProfileLVLH& thrust_profile : input_thrust_profiles) {
+    check_dry_mass_for_Isp(thrust_profile.Isp_);
+  }
+  thrust_profile_list_.clear();
+  thrust_schedule_LVLH_ = PiecewiseConstantSchedule<4>();
+  for (const ThrustProfileLVLH& thrust_profile : input_thrust_profiles) {
+    add_thrust_profile_to_schedule(thrust_profile);
+  }
+}
+
+// Objective: add a LVLH frame thrust curve to the satellite from a file, read
+// as CSV if it has a .csv extension and as JSON otherwise
+void Satellite::add_LVLH_thrust_curve(const std::string input_file_name) {
+  const std::string csv_extension = ".csv";
+  if ((input_file_name.size() >= csv_extension.size()) &&
+      (input_file_name.compare(input_file_name.size() - csv_extension.size(),
+                               csv_extension.size(), csv_extension) == 0)) {
+    add_LVLH_thrust_curve(load_thrust_curve_CSV(input_file_name));
+  } else {
+    add_LVLH_thrust_curve(load_thrust_curve_JSON(input_file_name));
+  }
+}
+
+void Satellite::add_LVLH_thrust_curve(
+    const ThrustCurveLVLH input_thrust_curve) {
+  check_dry_mass_for_Isp(input_thrust_curve.get_Isp());
+  thrust_curve_list_.push_back(input_thrust_curve);
+}
+
 // Objective: add a LVLH frame thrust profile to the satellite
 void Satellite::add_LVLH_thrust_profile(
     const std::array<double, 3> input_LVLH_thrust_vector,
     const double input_thrust_start_time, const double input_thrust_end_time) {
   ThrustProfileLVLH new_thrust_profile(
       input_thrust_start_time, input_thrust_end_time, input_LVLH_thrust_vector);
-  thrust_profile_list_.push_back(new_thrust_profile);
+  add_thrust_profile_to_schedule(new_thrust_profile);
   if (input_thrust_start_time == 0) {
     list_of_LVLH_forces_at_this_time_.push_back(input_LVLH_thrust_vector);
     std::array<double, 3> ECI_thrust_vector = convert_LVLH_to_ECI_manual(
@@ -277,11 +385,13 @@ void Satellite::add_LVLH_thrust_profile(
 void Satellite::add_LVLH_thrust_profile(
     const std::array<double, 3> input_LVLH_normalized_thrust_direction,
     const double input_LVLH_thrust_magnitude,
-    const double input_thrust_start_time, const double input_thrust_end_time) {
+    const double input_thrust_start_time, const double input_thrust_end_time,
+    const double input_Isp) {
   ThrustProfileLVLH new_thrust_profile(
       input_thrust_start_time, input_thrust_end_time,
-      input_LVLH_normalized_thrust_direction, input_LVLH_thrust_magnitude);
-  thrust_profile_list_.push_back(new_thrust_profile);
+      input_LVLH_normalized_thrust_direction, input_LVLH_thrust_magnitude,
+      input_Isp);
+  add_thrust_profile_to_schedule(new_thrust_profile);
 
   std::array<double, 3> LVLH_thrust_vec = {0, 0, 0};
 
@@ -298,6 +408,142 @@ void Satellite::add_LVLH_thrust_profile(
   }
 }
 
+InertiaTensor::InertiaTensor(const Matrix3d input_J_matrix) {
+  const double symmetry_tolerance =
+      pow(10.0, -12) * input_J_matrix.cwiseAbs().maxCoeff();
+  if ((input_J_matrix - input_J_matrix.transpose()).cwiseAbs().maxCoeff() >
+      symmetry_tolerance) {
+    throw std::invalid_argument("Inertia tensor must be symmetric");
+  }
+  J_matrix_ = 0.5 * (input_J_matrix + input_J_matrix.transpose());
+  // Cholesky factorization only succeeds for positive definite matrices
+  Eigen::LLT<Matrix3d> J_factorization(J_matrix_);
+  if (J_factorization.info() != Eigen::Success) {
+    throw std::invalid_argument("Inertia tensor must be positive definite");
+  }
+  inverse_J_matrix_ = J_factorization.solve(Matrix3d::Identity());
+  is_diagonal_ = (J_matrix_(0, 1) == 0) && (J_matrix_(0, 2) == 0) &&
+                 (J_matrix_(1, 2) == 0);
+}
+
+// Objective: update which optional force terms are dropped, based on their
+// estimated accelerations at the given state, and return the requested terms
+// which are left
+unsigned int ForceModelFidelitySwitch::select_force_terms(
+    const unsigned int input_force_term_mask,
+    const std::array<double, 3>& input_r_vec,
+    const std::array<double, 3>& input_velocity_vec,
+    const double input_evaluation_time, ForceModelContext& input_context) {
+  auto update_force_term = [&](const ForceTerm input_force_term,
+                               auto estimate_acceleration_magnitude) {
+    const unsigned int term_bit = force_term_bit(input_force_term);
+    if ((input_force_term_mask & term_bit) == 0) {
+      // Not requested, so no need to estimate it
+      return;
+    }
+    double estimated_acceleration = estimate_acceleration_magnitude(
+        input_r_vec, input_velocity_vec, input_evaluation_time, input_context);
+    if (disabled_force_term_mask_ & term_bit) {
+      if (estimated_acceleration >= error_budget_) {
+        disabled_force_term_mask_ &= ~term_bit;
+      }
+    } else if (estimated_acceleration < hysteresis_ratio_ * error_budget_) {
+      disabled_force_term_mask_ |= term_bit;
+    }
+  };
+  update_force_term(ForceTerm::J2,
+                    J2Perturbation::estimate_acceleration_magnitude);
+  update_force_term(ForceTerm::atmospheric_drag,
+                    AtmosphericDrag::estimate_acceleration_magnitude);
+  update_force_term(ForceTerm::third_body,
+                    ThirdBodyPerturbation::estimate_acceleration_magnitude);
+  update_force_term(ForceTerm::solar_radiation_pressure,
+                    SolarRadiationPressure::estimate_acceleration_magnitude);
+  return input_force_term_mask & ~disabled_force_term_mask_;
+}
+
+void Satellite::set_force_model_error_budget(
+    const double input_error_budget, const double input_hysteresis_ratio) {
+  if (input_error_budget < 0) {
+    throw std::invalid_argument("Force model error budget must be nonnegative");
+  }
+  if ((input_hysteresis_ratio <= 0) || (input_hysteresis_ratio > 1)) {
+    throw std::invalid_argument(
+        "Force model hysteresis ratio must be in (0, 1]");
+  }
+  force_model_fidelity_switch_.error_budget_ = input_error_budget;
+  force_model_fidelity_switch_.hysteresis_ratio_ = input_hysteresis_ratio;
+  force_model_fidelity_switch_.disabled_force_term_mask_ = 0;
+}
+
+// Objective: schedule an impulsive maneuver, keeping the list of maneuvers
+// sorted by time
+void Satellite::add_impulsive_maneuver(
+    const std::array<double, 3> input_delta_v_vec,
+    const double input_maneuver_time, const ManeuverFrame input_frame,
+    const double input_Isp) {
+  if (input_maneuver_time < t_) {
+    throw std::invalid_argument(
+        "Impulsive maneuvers can't be scheduled before the current time");
+  }
+  ImpulsiveManeuver new_maneuver(input_maneuver_time, input_delta_v_vec,
+                                 input_frame, input_Isp);
+  // Insert after any maneuvers at the same time, so they're applied in the
+  // order they were added
+  auto insertion_iterator = std::upper_bound(
+      impulsive_maneuver_list_.begin() + next_impulsive_maneuver_index_,
+      impulsive_maneuver_list_.end(), input_maneuver_time,
+      [](const double input_time, const ImpulsiveManeuver& input_maneuver) {
+        return input_time < input_maneuver.t_maneuver_;
+      });
+  impulsive_maneuver_list_.insert(insertion_iterator, new_maneuver);
+}
+
+// Objective: apply an impulsive maneuver's delta-v to the satellite's
+// velocity, then update the orbital elements to match
+void Satellite::apply_impulsive_maneuver(
+    const ImpulsiveManeuver input_maneuver) {
+  double final_mass = input_maneuver.calculate_final_mass(m_);
+  if ((dry_mass_ > 0) && (final_mass < dry_mass_)) {
+    // Not enough propellant, so the maneuver is skipped
+    skipped_impulsive_maneuver_times_.push_back(input_maneuver.t_maneuver_);
+    return;
+  }
+  std::array<double, 3> ECI_delta_v_vec = input_maneuver.delta_v_vec_;
+  if (input_maneuver.frame_ == ManeuverFrame::LVLH) {
+    ECI_delta_v_vec = convert_LVLH_to_ECI_manual(
+        input_maneuver.delta_v_vec_, ECI_position_, ECI_velocity_);
+  }
+  update_ECI_state(ECI_position_,
+                   {ECI_velocity_.at(0) + ECI_delta_v_vec.at(0),
+                    ECI_velocity_.at(1) + ECI_delta_v_vec.at(1),
+                    ECI_velocity_.at(2) + ECI_delta_v_vec.at(2)});
+  m_ = final_mass;
+}
+
+// Objective: check that the state reached by a time step can be evolved
+// further, i.e., that the position, velocity and attitude quaternion are
+// finite and the satellite isn't at the center of the Earth. Returns 0 if
+// so, otherwise 2
+int Satellite::check_state_validity() {
+  for (size_t ind = 0; ind < 3; ind++) {
+    if (!std::isfinite(ECI_position_.at(ind)) ||
+        !std::isfinite(ECI_velocity_.at(ind))) {
+      return 2;
+    }
+  }
+  for (const double quaternion_component :
+       quaternion_satellite_bodyframe_wrt_LVLH_) {
+    if (!std::isfinite(quaternion_component)) {
+      return 2;
+    }
+  }
+  if (!(get_radius_ECI() > 0)) {
+    return 2;
+  }
+  return 0;
+}
+
 int Satellite::update_orbital_elements_from_position_and_velocity() {
   // Anytime the orbit is changed via external forces, need to update the
   // orbital parameters of the satellite. True anomaly should change over time
@@ -316,8 +562,10 @@ int Satellite::update_orbital_elements_from_position_and_velocity() {
   Vector3d n_vector = {-h_vector(1), h_vector(0), 0};
   double n = n_vector.norm();
 
-  double v_magnitude = get_speed();
-  double r_magnitude = get_radius();
+  // The perifocal frame is defined by the elements being computed here, so
+  // use the ECI magnitudes
+  double v_magnitude = get_speed_ECI();
+  double r_magnitude = get_radius_ECI();
 
   Vector3d e_vec_component_1 =
       (1.0 / mu) * (v_magnitude * v_magnitude - (mu / r_magnitude)) *
@@ -402,10 +650,17 @@ int Satellite::update_orbital_elements_from_position_and_velocity() {
   arg_of_periapsis_ = calculated_arg_of_periapsis;
   true_anomaly_ = calculated_true_anomaly;
 
+  orbital_elements_stale_ = false;
+  // The elements define the perifocal frame, so the perifocal position and
+  // velocity change along with them
+  perifocal_position_ = convert_ECI_to_perifocal(ECI_position_);
+  perifocal_velocity_ = convert_ECI_to_perifocal(ECI_velocity_);
+
   return error_code;
 }
 
 std::array<double, 6> Satellite::get_orbital_elements() {
+  refresh_orbital_elements();
   std::array<double, 6> orbit_elems_array;
   orbit_elems_array.at(0) = a_;
   orbit_elems_array.at(1) = eccentricity_;
@@ -416,137 +671,268 @@ std::array<double, 6> Satellite::get_orbital_elements() {
   return orbit_elems_array;
 }
 
-std::pair<double, int> Satellite::evolve_RK45(
+template <typename OrbitalForceModel>
+std::pair<double, int> Satellite::evolve_RK45_with_force_model(
     const double input_epsilon, const double input_step_size,
-    const bool perturbation, const bool atmospheric_drag,
-    const std::pair<double, double> drag_elements) {
-  // perturbation is a flag which, when set to true, currently accounts for J2
-  // perturbation.
-
+    ForceModelContext& input_force_model_context) {
   // Let's do a single RK45_step call with y_n combined between orbital motion
   // and attitude variables,
   //  y_n = {ECI_position_x, ECI_position_y, ECI_position_z, ECI_velocity_x,
-  //  ECI_velocity_y, ECI_velocity_z, q_0, q_1, q_2, q_3, omega_x, omega_y,
-  //  omega_z} Where the quaternion represents the attitude of the spacecraft
-  //  body frame with respect to the LVLH frame, and omega_i is the angular
-  //  velocity around the ith axis of the body frame with respect to the LVLH
-  //  frame, represented in the body frame
-
-  // The tuple drag_elements contains the F_10 value and the A_p value used for
-  // atmospheric drag calculations, if applicable
-  // F_10 is the first element, A_p is the second element
-  double input_F_10 = drag_elements.first;
-  double input_A_p = drag_elements.second;
-
-  std::array<double, 13>
-      combined_initial_position_velocity_quaternion_angular_velocity_array = {};
+  //  ECI_velocity_y, ECI_velocity_z, theta_x, theta_y, theta_z, omega_x,
+  //  omega_y, omega_z, m} Where theta is the rotation vector of the
+  //  spacecraft body frame relative to its orientation at the start of the
+  //  step (so it starts at zero, and the attitude with respect to the LVLH
+  //  frame at the end of the step is q_n * exp(theta)), omega_i is the
+  //  angular velocity around the ith axis of the body frame with respect to
+  //  the LVLH frame, represented in the body frame, and m is the satellite's
+  //  mass (which changes while propellant-consuming thrust profiles are
+  //  active). Integrating theta rather than the four quaternion components
+  //  keeps the quaternion at unit norm by construction, so the step size
+  //  control isn't affected by norm drift
+
+  std::array<double, 13> combined_initial_state_array = {};
   std::pair<std::array<double, 3>, std::array<double, 3>>
       output_position_velocity_pair = {};
 
   for (size_t ind = 0; ind < 3; ind++) {
-    combined_initial_position_velocity_quaternion_angular_velocity_array.at(
-        ind) = ECI_position_.at(ind);
+    combined_initial_state_array.at(ind) = ECI_position_.at(ind);
   }
   for (size_t ind = 3; ind < 6; ind++) {
-    combined_initial_position_velocity_quaternion_angular_velocity_array.at(
-        ind) = ECI_velocity_.at(ind - 3);
+    combined_initial_state_array.at(ind) = ECI_velocity_.at(ind - 3);
   }
-  for (size_t ind = 6; ind < 10; ind++) {
-    combined_initial_position_velocity_quaternion_angular_velocity_array.at(
-        ind) = quaternion_satellite_bodyframe_wrt_LVLH_.at(ind - 6);
+  for (size_t ind = 9; ind < 12; ind++) {
+    combined_initial_state_array.at(ind) =
+        body_angular_velocity_vec_wrt_LVLH_in_body_frame_.at(ind - 9);
   }
+  combined_initial_state_array.at(12) = m_;
 
-  for (size_t ind = 10; ind < 13; ind++) {
-    combined_initial_position_velocity_quaternion_angular_velocity_array.at(
-        ind) = body_angular_velocity_vec_wrt_LVLH_in_body_frame_.at(ind - 10);
-  }
+  refresh_orbit_rate();
 
-  Matrix3d LVLH_to_body_transformation_matrix =
-      LVLH_to_body_transformation_matrix_from_quaternion(
-          quaternion_satellite_bodyframe_wrt_LVLH_);
+  CombinedOrbitAttitudeDerivative<OrbitalForceModel> derivative_function(
+      input_force_model_context, inertia_tensor_, bodyframe_torque_schedule_,
+      orbital_rate_, orbital_angular_acceleration_,
+      quaternion_satellite_bodyframe_wrt_LVLH_);
 
-  Vector3d body_angular_velocity_vec_wrt_LVLH_in_body_frame_eigenform = {
-      body_angular_velocity_vec_wrt_LVLH_in_body_frame_.at(0),
-      body_angular_velocity_vec_wrt_LVLH_in_body_frame_.at(1),
-      body_angular_velocity_vec_wrt_LVLH_in_body_frame_.at(2)};
-
-  Vector3d omega_I = calculate_omega_I(
-      body_angular_velocity_vec_wrt_LVLH_in_body_frame_eigenform,
-      LVLH_to_body_transformation_matrix, orbital_rate_);
-
-  Vector3d omega_LVLH_wrt_inertial_in_LVLH = {0, -orbital_rate_, 0};
-
-  Matrix3d J_matrix = construct_J_matrix(J_11_, J_22_, J_33_);
+  std::array<double, 13>* state_compensation = nullptr;
+  if (compensated_summation_enabled_) {
+    // The rotation vector starts from zero at each step, so there's nothing
+    // to carry over for it
+    for (size_t ind = 6; ind < 9; ind++) {
+      state_compensation_.at(ind) = 0;
+    }
+    state_compensation = &state_compensation_;
+  }
 
   std::pair<std::array<double, 13>, std::pair<double, double>> output_pair =
-      RK45_step<13>(
-          combined_initial_position_velocity_quaternion_angular_velocity_array,
-          input_step_size,
-          RK45_combined_orbit_position_velocity_attitude_deriv_function,
-          J_matrix, bodyframe_torque_profile_list_, omega_I,
-          orbital_angular_acceleration_, LVLH_to_body_transformation_matrix,
-          omega_LVLH_wrt_inertial_in_LVLH, m_, thrust_profile_list_,
-          inclination_, arg_of_periapsis_, true_anomaly_, input_F_10, input_A_p,
-          A_s_, perturbation, atmospheric_drag, t_, input_epsilon);
-
-  std::array<double, 13>
-      output_combined_position_velocity_quaternion_angular_velocity_array =
-          output_pair.first;
+      RK45_step<13>(combined_initial_state_array, input_step_size,
+                    derivative_function, t_, input_epsilon,
+                    state_compensation);
+
+  std::array<double, 13> output_combined_state_array = output_pair.first;
   double step_size_successfully_used_here = output_pair.second.first;
   double new_step_size = output_pair.second.second;
 
-  for (size_t ind = 0; ind < 3; ind++) {
-    ECI_position_.at(ind) =
-        output_combined_position_velocity_quaternion_angular_velocity_array.at(
-            ind);
-    ECI_velocity_.at(ind) =
-        output_combined_position_velocity_quaternion_angular_velocity_array.at(
-            ind + 3);
-    // Also update the perifocal versions
-    perifocal_position_ = convert_ECI_to_perifocal(ECI_position_);
-    perifocal_velocity_ = convert_ECI_to_perifocal(ECI_velocity_);
-  }
-  t_ += step_size_successfully_used_here;
-
-  for (size_t ind = 0; ind < quaternion_satellite_bodyframe_wrt_LVLH_.size();
-       ind++) {
-    quaternion_satellite_bodyframe_wrt_LVLH_.at(ind) =
-        output_combined_position_velocity_quaternion_angular_velocity_array.at(
-            ind + 6);
-  }
+  update_ECI_state(
+      {output_combined_state_array.at(0), output_combined_state_array.at(1),
+       output_combined_state_array.at(2)},
+      {output_combined_state_array.at(3), output_combined_state_array.at(4),
+       output_combined_state_array.at(5)});
+  advance_time(step_size_successfully_used_here);
+
+  quaternion_satellite_bodyframe_wrt_LVLH_ =
+      apply_rotation_vector_to_quaternion(
+          quaternion_satellite_bodyframe_wrt_LVLH_,
+          {output_combined_state_array.at(6), output_combined_state_array.at(7),
+           output_combined_state_array.at(8)});
+  // The update above preserves the norm exactly, up to rounding error, which
+  // would otherwise accumulate over many steps
   quaternion_satellite_bodyframe_wrt_LVLH_ =
       normalize_quaternion(quaternion_satellite_bodyframe_wrt_LVLH_);
-  std::array<double, 3> updated_roll_yaw_pitch =
-      convert_quaternion_to_roll_yaw_pitch_angles(
-          quaternion_satellite_bodyframe_wrt_LVLH_);
-
-  roll_angle_ = updated_roll_yaw_pitch.at(0);
-  yaw_angle_ = updated_roll_yaw_pitch.at(1);
-  pitch_angle_ = updated_roll_yaw_pitch.at(2);
+  attitude_angles_stale_ = true;
 
   for (size_t ind = 0;
        ind < body_angular_velocity_vec_wrt_LVLH_in_body_frame_.size(); ind++) {
     body_angular_velocity_vec_wrt_LVLH_in_body_frame_.at(ind) =
-        output_combined_position_velocity_quaternion_angular_velocity_array.at(
-            ind + 10);
+        output_combined_state_array.at(ind + 9);
   }
-
-  // Update orbital parameters
-  int orbit_elems_error_code =
-      update_orbital_elements_from_position_and_velocity();
-  orbital_rate_ = calculate_instantaneous_orbit_rate();
-  orbital_angular_acceleration_ =
-      calculate_instantaneous_orbit_angular_acceleration();
+  m_ = output_combined_state_array.at(12);
   std::pair<double, int> evolve_RK45_output_pair;
 
   evolve_RK45_output_pair.first = new_step_size;
-  evolve_RK45_output_pair.second = orbit_elems_error_code;
+  evolve_RK45_output_pair.second = check_state_validity();
+
+  return evolve_RK45_output_pair;
+}
+
+// Objective: evolve the satellite's orbit and attitude by one RK45 step,
+// with the force model made up of the given force terms. Common combinations
+// of terms are dispatched to force models specialized at compile time, the
+// rest to a force model which checks which terms are enabled at each
+// evaluation
+std::pair<double, int> Satellite::evolve_RK45_with_force_terms(
+    const double input_epsilon, const double input_step_size,
+    const std::vector<ForceTerm>& input_force_terms,
+    const std::pair<double, double> drag_elements) {
+  // The tuple drag_elements contains the F_10 value and the A_p value used for
+  // atmospheric drag calculations, if applicable
+  // F_10 is the first element, A_p is the second element
+  ForceModelContext force_model_context;
+  force_model_context.spacecraft_mass_ = m_;
+  force_model_context.dry_mass_ = dry_mass_;
+  force_model_context.F_10_ = drag_elements.first;
+  force_model_context.A_p_ = drag_elements.second;
+  force_model_context.A_s_ = A_s_;
+  force_model_context.A_srp_ = A_srp_;
+  force_model_context.C_R_ = C_R_;
+  force_model_context.thrust_schedule_LVLH_ = &thrust_schedule_LVLH_;
+  force_model_context.thrust_curve_list_ = &thrust_curve_list_;
+  force_model_context.environment_ = environment_.get();
+  force_model_context.geomagnetic_field_ = geomagnetic_field_.get();
+  force_model_context.magnetorquer_dipole_schedule_ =
+      &magnetorquer_dipole_schedule_;
+  force_model_context.residual_magnetic_dipole_ = residual_magnetic_dipole_;
+  force_model_context.magnetic_torque_enabled_ =
+      (magnetorquer_dipole_schedule_.get_num_windows() > 0) ||
+      (residual_magnetic_dipole_ != std::array<double, 3>{0, 0, 0});
+
+  unsigned int force_term_mask = calculate_force_term_mask(input_force_terms);
+  if ((thrust_schedule_LVLH_.get_num_windows() == 0) &&
+      (thrust_curve_list_.size() == 0)) {
+    // No thrust profiles, so the thrust term would only ever add zero
+    force_term_mask &= ~force_term_bit(ForceTerm::thrust);
+  }
+  if (force_model_fidelity_switch_.error_budget_ > 0) {
+    force_term_mask = force_model_fidelity_switch_.select_force_terms(
+        force_term_mask, ECI_position_, ECI_velocity_, t_,
+        force_model_context);
+  }
+  force_model_context.force_term_mask_ = force_term_mask;
+  if (force_term_mask & force_term_bit(ForceTerm::J2)) {
+    // The J2 acceleration uses the orbital elements at the start of the step
+    refresh_orbital_elements();
+    force_model_context.inclination_ = inclination_;
+    force_model_context.arg_of_periapsis_ = arg_of_periapsis_;
+    force_model_context.true_anomaly_ = true_anomaly_;
+  }
+  force_model_context.gravity_gradient_torque_enabled_ =
+      gravity_gradient_torque_enabled_;
+  // The aerodynamic torque comes from the same drag force as the drag term,
+  // so it's only included along with it
+  force_model_context.center_of_pressure_offset_ = center_of_pressure_offset_;
+  force_model_context.aerodynamic_torque_enabled_ =
+      (force_term_mask & force_term_bit(ForceTerm::atmospheric_drag)) &&
+      (center_of_pressure_offset_ != std::array<double, 3>{0, 0, 0});
+
+  if (force_term_mask == TwoBodyForceModel::force_term_mask) {
+    return evolve_RK45_with_force_model<TwoBodyForceModel>(
+        input_epsilon, input_step_size, force_model_context);
+  } else if (force_term_mask == TwoBodyThrustForceModel::force_term_mask) {
+    return evolve_RK45_with_force_model<TwoBodyThrustForceModel>(
+        input_epsilon, input_step_size, force_model_context);
+  } else if (force_term_mask == J2ForceModel::force_term_mask) {
+    return evolve_RK45_with_force_model<J2ForceModel>(
+        input_epsilon, input_step_size, force_model_context);
+  } else if (force_term_mask == J2ThrustForceModel::force_term_mask) {
+    return evolve_RK45_with_force_model<J2ThrustForceModel>(
+        input_epsilon, input_step_size, force_model_context);
+  } else if (force_term_mask == J2DragForceModel::force_term_mask) {
+    return evolve_RK45_with_force_model<J2DragForceModel>(
+        input_epsilon, input_step_size, force_model_context);
+  } else if (force_term_mask == J2DragThrustForceModel::force_term_mask) {
+    return evolve_RK45_with_force_model<J2DragThrustForceModel>(
+        input_epsilon, input_step_size, force_model_context);
+  } else if (force_term_mask == J2SunMoonSRPForceModel::force_term_mask) {
+    return evolve_RK45_with_force_model<J2SunMoonSRPForceModel>(
+        input_epsilon, input_step_size, force_model_context);
+  }
+  return evolve_RK45_with_force_model<RuntimeForceModel>(
+      input_epsilon, input_step_size, force_model_context);
+}
 
+// Objective: evolve the satellite's orbit and attitude by one RK45 step,
+// stopping early if an impulsive maneuver is due during the step. The
+// maneuver is then applied at exactly its scheduled time, and the input step
+// size is returned as the next step size, so the step size doesn't need to
+// recover from the shortened step
+std::pair<double, int> Satellite::evolve_RK45(
+    const double input_epsilon, const double input_step_size,
+    const std::vector<ForceTerm>& input_force_terms,
+    const std::pair<double, double> drag_elements) {
+  if (SGP4_propagation_enabled_) {
+    return evolve_SGP4(input_step_size);
+  }
+  // Tolerance used to decide whether the satellite has reached a maneuver
+  // time, to absorb roundoff in the accumulated time
+  auto calculate_maneuver_time_tolerance = [](const double input_time) {
+    return pow(10.0, -9) * std::max(1.0, fabs(input_time));
+  };
+  auto apply_due_maneuvers = [&]() {
+    while (
+        (next_impulsive_maneuver_index_ < impulsive_maneuver_list_.size()) &&
+        (impulsive_maneuver_list_.at(next_impulsive_maneuver_index_)
+             .t_maneuver_ <= t_ + calculate_maneuver_time_tolerance(t_))) {
+      apply_impulsive_maneuver(
+          impulsive_maneuver_list_.at(next_impulsive_maneuver_index_));
+      next_impulsive_maneuver_index_++;
+    }
+  };
+
+  // Maneuvers scheduled at the current time (e.g., at t=0)
+  apply_due_maneuvers();
+
+  double step_size_to_use = input_step_size;
+  bool step_ends_at_maneuver = false;
+  double maneuver_time = 0;
+  if (next_impulsive_maneuver_index_ < impulsive_maneuver_list_.size()) {
+    maneuver_time =
+        impulsive_maneuver_list_.at(next_impulsive_maneuver_index_).t_maneuver_;
+    if (t_ + input_step_size >= maneuver_time) {
+      step_size_to_use = maneuver_time - t_;
+      step_ends_at_maneuver = true;
+    }
+  }
+
+  std::pair<double, int> evolve_RK45_output_pair = evolve_RK45_with_force_terms(
+      input_epsilon, step_size_to_use, input_force_terms, drag_elements);
+
+  if (step_ends_at_maneuver &&
+      (fabs(t_ - maneuver_time) <=
+       calculate_maneuver_time_tolerance(maneuver_time))) {
+    // The adaptive step could have been shortened further by the error
+    // control, in which case the maneuver is left for a later step
+    set_time(maneuver_time);
+    apply_due_maneuvers();
+    evolve_RK45_output_pair.first = input_step_size;
+  }
   return evolve_RK45_output_pair;
 }
 
+std::pair<double, int> Satellite::evolve_RK45(
+    const double input_epsilon, const double input_step_size,
+    const bool perturbation, const bool atmospheric_drag,
+    const std::pair<double, double> drag_elements, const bool third_body,
+    const bool solar_radiation_pressure) {
+  // perturbation is a flag which, when set to true, currently accounts for J2
+  // perturbation.
+  // third_body is a flag which, when set to true, accounts for point-mass
+  // gravitational perturbations from the Sun and Moon
+  // solar_radiation_pressure is a flag which, when set to true, accounts for
+  // solar radiation pressure (including shadowing by the Earth)
+  return evolve_RK45(input_epsilon, input_step_size,
+                     force_terms_from_flags(perturbation, atmospheric_drag,
+                                            third_body,
+                                            solar_radiation_pressure),
+                     drag_elements);
+}
+
 // Returns a specific orbital element
 double Satellite::get_orbital_element(const std::string orbital_element_name) {
+  if ((orbital_element_name == "Orbital Rate") ||
+      (orbital_element_name == "Orbital Angular Acceleration")) {
+    refresh_orbit_rate();
+  } else {
+    refresh_orbital_elements();
+  }
   if (orbital_element_name == "Semimajor Axis") {
     return a_;
   } else if (orbital_element_name == "Eccentricity") {
@@ -579,6 +965,9 @@ void Satellite::add_bodyframe_torque_profile(
                                             input_torque_end_time,
                                             input_bodyframe_torque_vector);
   bodyframe_torque_profile_list_.push_back(new_torque_profile);
+  bodyframe_torque_schedule_.add_window(
+      input_torque_start_time, input_torque_end_time,
+      new_torque_profile.bodyframe_torque_list);
   if (input_torque_start_time == 0) {
     list_of_body_frame_torques_at_this_time_.push_back(
         input_bodyframe_torque_vector);
@@ -600,12 +989,44 @@ void Satellite::add_bodyframe_torque_profile(
                                             input_torque_end_time,
                                             input_bodyframe_torque_vector);
   bodyframe_torque_profile_list_.push_back(new_torque_profile);
+  bodyframe_torque_schedule_.add_window(
+      input_torque_start_time, input_torque_end_time,
+      new_torque_profile.bodyframe_torque_list);
   if (input_torque_start_time == 0) {
     list_of_body_frame_torques_at_this_time_.push_back(
         input_bodyframe_torque_vector);
   }
 }
 
+// Objective: add a magnetorquer dipole command to the satellite. The torque
+// it produces depends on the geomagnetic field along the orbit, so it's
+// computed during time evolution rather than being a torque profile
+void Satellite::add_magnetorquer_dipole_profile(
+    const std::array<double, 3> input_bodyframe_dipole_vector,
+    const double input_dipole_start_time, const double input_dipole_end_time) {
+  magnetorquer_dipole_schedule_.add_window(input_dipole_start_time,
+                                           input_dipole_end_time,
+                                           input_bodyframe_dipole_vector);
+}
+
+std::array<double, 3> Satellite::get_magnetic_field_ECI() {
+  return calculate_geomagnetic_field_ECI(
+      *geomagnetic_field_, environment_->get_ECI_to_ECEF_matrix(t_),
+      ECI_position_);
+}
+
+std::array<double, 3> Satellite::get_magnetic_field_bodyframe() {
+  std::array<double, 3> magnetic_field_LVLH = convert_ECI_to_LVLH_manual(
+      get_magnetic_field_ECI(), ECI_position_, ECI_velocity_);
+  Vector3d magnetic_field_bodyframe =
+      LVLH_to_body_transformation_matrix_from_quaternion(
+          quaternion_satellite_bodyframe_wrt_LVLH_) *
+      Vector3d(magnetic_field_LVLH.at(0), magnetic_field_LVLH.at(1),
+               magnetic_field_LVLH.at(2));
+  return {magnetic_field_bodyframe(0), magnetic_field_bodyframe(1),
+          magnetic_field_bodyframe(2)};
+}
+
 double Satellite::calculate_instantaneous_orbit_rate() {
   // Need to figure out how to calculate the equivalent of w_0 in section 4.3.1
   // of
@@ -613,15 +1034,15 @@ double Satellite::calculate_instantaneous_orbit_rate() {
   // but for general elliptical orbits Is this proportional to the rate of
   // change of the true anomaly? Proof sketched out here:
   // https://space.stackexchange.com/questions/21615/how-to-calculate-the-complete-true-anomaly-motion-in-an-elliptical-orbit
-  Vector3d position_vector = {perifocal_position_.at(0),
-                              perifocal_position_.at(1),
-                              perifocal_position_.at(2)};
-  Vector3d velocity_vector = {perifocal_velocity_.at(0),
-                              perifocal_velocity_.at(1),
-                              perifocal_velocity_.at(2)};
+  // Frame-independent, so the ECI vectors are used directly rather than
+  // waiting on the perifocal ones
+  Vector3d position_vector = {ECI_position_.at(0), ECI_position_.at(1),
+                              ECI_position_.at(2)};
+  Vector3d velocity_vector = {ECI_velocity_.at(0), ECI_velocity_.at(1),
+                              ECI_velocity_.at(2)};
   Vector3d h_vector = position_vector.cross(velocity_vector);
   double h = h_vector.norm();
-  double r = get_radius();
+  double r = position_vector.norm();
   double orbit_rate = h / (r * r);
   return orbit_rate;
 }
@@ -633,15 +1054,15 @@ double Satellite::calculate_instantaneous_orbit_angular_acceleration() {
   // but for general elliptical orbits Proof sketched out here:
   // https://space.stackexchange.com/questions/21615/how-to-calculate-the-complete-true-anomaly-motion-in-an-elliptical-orbit
   // This assumes angular momentum is constant
-  Vector3d position_vector = {perifocal_position_.at(0),
-                              perifocal_position_.at(1),
-                              perifocal_position_.at(2)};
-  Vector3d velocity_vector = {perifocal_velocity_.at(0),
-                              perifocal_velocity_.at(1),
-                              perifocal_velocity_.at(2)};
+  // Frame-independent, so the ECI vectors are used directly rather than
+  // waiting on the perifocal ones
+  Vector3d position_vector = {ECI_position_.at(0), ECI_position_.at(1),
+                              ECI_position_.at(2)};
+  Vector3d velocity_vector = {ECI_velocity_.at(0), ECI_velocity_.at(1),
+                              ECI_velocity_.at(2)};
   Vector3d h_vector = position_vector.cross(velocity_vector);
   double h = h_vector.norm();
-  double r = get_radius();
+  double r = position_vector.norm();
   Vector3d unit_position_vector = position_vector;
   unit_position_vector.normalize();
   double orbit_angular_acceleration =
@@ -652,6 +1073,27 @@ double Satellite::calculate_instantaneous_orbit_angular_acceleration() {
   return orbit_angular_acceleration;
 }
 
+void Satellite::refresh_orbit_rate() {
+  if (orbit_rate_stale_) {
+    orbital_rate_ = calculate_instantaneous_orbit_rate();
+    orbital_angular_acceleration_ =
+        calculate_instantaneous_orbit_angular_acceleration();
+    orbit_rate_stale_ = false;
+  }
+}
+
+void Satellite::refresh_attitude_angles() {
+  if (attitude_angles_stale_) {
+    std::array<double, 3> updated_roll_yaw_pitch =
+        convert_quaternion_to_roll_yaw_pitch_angles(
+            quaternion_satellite_bodyframe_wrt_LVLH_);
+    roll_angle_ = updated_roll_yaw_pitch.at(0);
+    yaw_angle_ = updated_roll_yaw_pitch.at(1);
+    pitch_angle_ = updated_roll_yaw_pitch.at(2);
+    attitude_angles_stale_ = false;
+  }
+}
+
 void Satellite::initialize_and_normalize_body_quaternion(
     const double roll_angle, const double pitch_angle, const double yaw_angle) {
   std::array<double, 4> quaternion =
@@ -664,6 +1106,7 @@ void Satellite::initialize_and_normalize_body_quaternion(
 
 // Return a specific attitude-related value
 double Satellite::get_attitude_val(std::string input_attitude_val_name) {
+  refresh_attitude_angles();
   if (input_attitude_val_name == "Roll") {
     return roll_angle_;
   } else if (input_attitude_val_name == "Pitch") {
@@ -699,4 +1142,317 @@ void Satellite::initialize_body_angular_velocity_vec_wrt_LVLH_in_body_frame() {
           initial_body_angular_velocity_in_LVLH_frame, roll_angle_, yaw_angle_,
           pitch_angle_);  // Because LVLH is always rotating around y axis to
                           // keep z pointed towards Earth
-}
\ No newline at end of file
+}
+
+void Satellite::detach_shared_caches() {
+  std::shared_ptr<EnvironmentCache> detached_environment =
+      std::make_shared<EnvironmentCache>(*environment_);
+  detached_environment->set_sun_moon_ephemeris(
+      std::make_shared<SunMoonEphemeris>(
+          *environment_->get_sun_moon_ephemeris()));
+  detached_environment->set_earth_orientation(
+      std::make_shared<EarthOrientation>(
+          *environment_->get_earth_orientation()));
+  environment_ = detached_environment;
+  geomagnetic_field_ = std::make_shared<GeomagneticField>(*geomagnetic_field_);
+}
+
+Satellite Satellite::from_TLE(
+    std::shared_ptr<const SGP4Propagator> input_SGP4_propagator,
+    const size_t input_element_set_index) {
+  const TwoLineElementSet& element_set =
+      input_SGP4_propagator->get_element_set(input_element_set_index);
+  // The mean elements only stand in for the orbital state until it's replaced
+  // by the SGP4 state below. Mean anomaly is used as the true anomaly, and
+  // the semimajor axis follows from the mean motion
+  double mean_motion = element_set.mean_motion * 2 * M_PI / seconds_per_day;
+  SatelliteElements elements;
+  elements.name = element_set.name;
+  elements.epoch = element_set.epoch;
+  elements.inclination = element_set.inclination;
+  elements.raan = element_set.raan;
+  elements.arg_of_periapsis = element_set.arg_of_perigee;
+  elements.eccentricity = element_set.eccentricity;
+  elements.semimajor_axis =
+      cbrt(G * mass_Earth / (mean_motion * mean_motion)) / 1000.0;
+  elements.true_anomaly = element_set.mean_anomaly;
+  Satellite new_satellite(elements);
+  new_satellite.SGP4_propagator_ = input_SGP4_propagator;
+  new_satellite.SGP4_element_set_index_ = input_element_set_index;
+  new_satellite.SGP4_propagation_enabled_ = true;
+
+  std::array<double, 3> ECI_position = {0, 0, 0};
+  std::array<double, 3> ECI_velocity = {0, 0, 0};
+  if (new_satellite.calculate_SGP4_ECI_state(0, ECI_position, ECI_velocity) !=
+      0) {
+    throw std::invalid_argument("SGP4 failed at the epoch of the TLE for " +
+                                std::to_string(element_set.catalog_number));
+  }
+  new_satellite.update_ECI_state(ECI_position, ECI_velocity);
+  new_satellite.orbital_period_ = new_satellite.calculate_orbital_period();
+  new_satellite.refresh_orbit_rate();
+  new_satellite.initialize_body_angular_velocity_vec_wrt_LVLH_in_body_frame();
+  return new_satellite;
+}
+
+int Satellite::calculate_SGP4_ECI_state(
+    const double input_time, std::array<double, 3>& output_ECI_position,
+    std::array<double, 3>& output_ECI_velocity) {
+  std::array<double, 3> TEME_position = {0, 0, 0};
+  std::array<double, 3> TEME_velocity = {0, 0, 0};
+  int error_code = SGP4_propagator_->propagate_element_set(
+      SGP4_element_set_index_, input_time, TEME_position, TEME_velocity);
+  output_ECI_position = TEME_position;
+  output_ECI_velocity = TEME_velocity;
+  // Without precession and nutation, the ECI to Earth-fixed rotation is the
+  // same GMST rotation SGP4 uses for TEME, so TEME serves as the ECI frame.
+  // Otherwise the state is rotated into J2000
+  std::shared_ptr<EarthOrientation> earth_orientation =
+      environment_->get_earth_orientation();
+  if (earth_orientation->get_include_precession_nutation()) {
+    Matrix3d TEME_to_ECI_matrix = calculate_TEME_to_ECI_matrix(
+        earth_orientation->get_epoch_julian_date() +
+        input_time / seconds_per_day);
+    Vector3d ECI_position =
+        TEME_to_ECI_matrix *
+        Vector3d(TEME_position.at(0), TEME_position.at(1), TEME_position.at(2));
+    Vector3d ECI_velocity =
+        TEME_to_ECI_matrix * Vector3d(TEME_velocity.at(0), TEME_velocity.at(1),
+                                      TEME_velocity.at(2));
+    output_ECI_position = {ECI_position(0), ECI_position(1), ECI_position(2)};
+    output_ECI_velocity = {ECI_velocity(0), ECI_velocity(1), ECI_velocity(2)};
+  }
+  return error_code;
+}
+
+std::pair<double, int> Satellite::evolve_SGP4(const double input_timestep) {
+  if (!SGP4_propagator_) {
+    throw std::invalid_argument(
+        "SGP4 propagation needs a satellite set up from a TLE");
+  }
+  std::array<double, 3> ECI_position = {0, 0, 0};
+  std::array<double, 3> ECI_velocity = {0, 0, 0};
+  int error_code =
+      calculate_SGP4_ECI_state(t_ + input_timestep, ECI_position, ECI_velocity);
+  if (error_code != 0) {
+    return {input_timestep, error_code};
+  }
+  advance_time(input_timestep);
+  update_ECI_state(ECI_position, ECI_velocity);
+  // The state is set directly rather than accumulated
+  state_compensation_.fill(0);
+  return {input_timestep, 0};
+}
+
+void Satellite::set_SGP4_propagator(
+    std::shared_ptr<const SGP4Propagator> input_SGP4_propagator,
+    const size_t input_element_set_index) {
+  if (!SGP4_propagator_) {
+    throw std::invalid_argument(
+        "Only satellites set up from a TLE have an SGP4 propagator");
+  }
+  const TwoLineElementSet& current_element_set =
+      SGP4_propagator_->get_element_set(SGP4_element_set_index_);
+  const TwoLineElementSet& new_element_set =
+      input_SGP4_propagator->get_element_set(input_element_set_index);
+  if ((new_element_set.catalog_number != current_element_set.catalog_number) ||
+      !(new_element_set.epoch == current_element_set.epoch)) {
+    throw std::invalid_argument(
+        "The new SGP4 propagator doesn't hold the satellite's element set");
+  }
+  SGP4_propagator_ = input_SGP4_propagator;
+  SGP4_element_set_index_ = input_element_set_index;
+}
+
+void Satellite::set_SGP4_propagation(const bool input_enabled) {
+  if (input_enabled && !SGP4_propagator_) {
+    throw std::invalid_argument(
+        "SGP4 propagation needs a satellite set up from a TLE");
+  }
+  SGP4_propagation_enabled_ = input_enabled;
+}
+
+// Objective: write the satellite's full state to a binary stream, in the
+// order read back by the checkpoint constructor. Derived quantities which are
+// rebuilt on demand (the perifocal to ECI matrix, compiled schedules and the
+// environment's cached values) aren't written
+void Satellite::write_checkpoint(std::ostream& output_stream) const {
+  write_binary_value(output_stream, inclination_);
+  write_binary_value(output_stream, raan_);
+  write_binary_value(output_stream, arg_of_periapsis_);
+  write_binary_value(output_stream, eccentricity_);
+  write_binary_value(output_stream, a_);
+  write_binary_value(output_stream, true_anomaly_);
+  write_binary_value(output_stream, orbital_period_);
+  write_binary_value(output_stream, m_);
+  write_binary_value(output_stream, dry_mass_);
+  write_binary_value(output_stream, t_);
+  write_binary_value(output_stream, epoch_);
+  write_binary_value(output_stream, compensated_summation_enabled_);
+  write_binary_value(output_stream, t_compensation_);
+  write_binary_value(output_stream, state_compensation_);
+  write_binary_value(output_stream, split_time_enabled_);
+  write_binary_value(output_stream, t_whole_seconds_);
+  write_binary_value(output_stream, t_fraction_);
+  write_binary_value(output_stream, orbital_rate_);
+  write_binary_value(output_stream, orbital_angular_acceleration_);
+  write_binary_value(output_stream, pitch_angle_);
+  write_binary_value(output_stream, roll_angle_);
+  write_binary_value(output_stream, yaw_angle_);
+  write_binary_value(output_stream, A_s_);
+  write_binary_value(output_stream, A_srp_);
+  write_binary_value(output_stream, C_R_);
+  write_binary_value(output_stream, drag_surface_area);
+  write_binary_value(output_stream, orbital_elements_stale_);
+  write_binary_value(output_stream, orbit_rate_stale_);
+  write_binary_value(output_stream, attitude_angles_stale_);
+  write_binary_value(output_stream, gravity_gradient_torque_enabled_);
+  write_binary_value(output_stream,
+                     body_angular_velocity_vec_wrt_LVLH_in_body_frame_);
+  write_binary_value(output_stream, perifocal_position_);
+  write_binary_value(output_stream, perifocal_velocity_);
+  write_binary_value(output_stream, ECI_position_);
+  write_binary_value(output_stream, ECI_velocity_);
+  write_binary_value(output_stream, residual_magnetic_dipole_);
+  write_binary_value(output_stream, center_of_pressure_offset_);
+  write_binary_value(output_stream, quaternion_satellite_bodyframe_wrt_LVLH_);
+  std::array<double, 9> J_components = {};
+  Eigen::Map<Matrix3d>(J_components.data()) = inertia_tensor_.J_matrix_;
+  write_binary_value(output_stream, J_components);
+  write_binary_value(output_stream, force_model_fidelity_switch_.error_budget_);
+  write_binary_value(output_stream,
+                     force_model_fidelity_switch_.hysteresis_ratio_);
+  write_binary_value(output_stream,
+                     force_model_fidelity_switch_.disabled_force_term_mask_);
+  write_binary_string(output_stream, name_);
+  write_binary_string(output_stream, plotting_color_);
+
+  write_binary_vector(output_stream, thrust_profile_list_);
+  write_binary_vector(output_stream, bodyframe_torque_profile_list_);
+  write_binary_vector(output_stream, impulsive_maneuver_list_);
+  write_binary_value<uint64_t>(output_stream, next_impulsive_maneuver_index_);
+  write_binary_vector(output_stream, skipped_impulsive_maneuver_times_);
+  write_binary_vector(output_stream, list_of_LVLH_forces_at_this_time_);
+  write_binary_vector(output_stream, list_of_ECI_forces_at_this_time_);
+  write_binary_vector(output_stream, list_of_body_frame_torques_at_this_time_);
+  thrust_schedule_LVLH_.write_checkpoint(output_stream);
+  bodyframe_torque_schedule_.write_checkpoint(output_stream);
+  magnetorquer_dipole_schedule_.write_checkpoint(output_stream);
+  write_binary_value<uint64_t>(output_stream, thrust_curve_list_.size());
+  for (const ThrustCurveLVLH& thrust_curve : thrust_curve_list_) {
+    thrust_curve.write_checkpoint(output_stream);
+  }
+
+  geomagnetic_field_->write_checkpoint(output_stream);
+  environment_->write_checkpoint(output_stream);
+  // Only the satellite's own element set is written, rather than every
+  // element set of a shared propagator
+  write_binary_value(output_stream, SGP4_propagation_enabled_);
+  write_binary_value(output_stream, static_cast<bool>(SGP4_propagator_));
+  if (SGP4_propagator_) {
+    SGP4_propagator_->get_element_set(SGP4_element_set_index_)
+        .write_checkpoint(output_stream);
+  }
+}
+
+Satellite::Satellite(std::istream& input_checkpoint_stream) {
+  inclination_ = read_binary_value<double>(input_checkpoint_stream);
+  raan_ = read_binary_value<double>(input_checkpoint_stream);
+  arg_of_periapsis_ = read_binary_value<double>(input_checkpoint_stream);
+  eccentricity_ = read_binary_value<double>(input_checkpoint_stream);
+  a_ = read_binary_value<double>(input_checkpoint_stream);
+  true_anomaly_ = read_binary_value<double>(input_checkpoint_stream);
+  orbital_period_ = read_binary_value<double>(input_checkpoint_stream);
+  m_ = read_binary_value<double>(input_checkpoint_stream);
+  dry_mass_ = read_binary_value<double>(input_checkpoint_stream);
+  t_ = read_binary_value<double>(input_checkpoint_stream);
+  epoch_ = read_binary_value<AbsoluteEpoch>(input_checkpoint_stream);
+  compensated_summation_enabled_ =
+      read_binary_value<bool>(input_checkpoint_stream);
+  t_compensation_ = read_binary_value<double>(input_checkpoint_stream);
+  state_compensation_ =
+      read_binary_value<std::array<double, 13>>(input_checkpoint_stream);
+  split_time_enabled_ = read_binary_value<bool>(input_checkpoint_stream);
+  t_whole_seconds_ = read_binary_value<int64_t>(input_checkpoint_stream);
+  t_fraction_ = read_binary_value<double>(input_checkpoint_stream);
+  orbital_rate_ = read_binary_value<double>(input_checkpoint_stream);
+  orbital_angular_acceleration_ =
+      read_binary_value<double>(input_checkpoint_stream);
+  pitch_angle_ = read_binary_value<double>(input_checkpoint_stream);
+  roll_angle_ = read_binary_value<double>(input_checkpoint_stream);
+  yaw_angle_ = read_binary_value<double>(input_checkpoint_stream);
+  A_s_ = read_binary_value<double>(input_checkpoint_stream);
+  A_srp_ = read_binary_value<double>(input_checkpoint_stream);
+  C_R_ = read_binary_value<double>(input_checkpoint_stream);
+  drag_surface_area = read_binary_value<double>(input_checkpoint_stream);
+  orbital_elements_stale_ = read_binary_value<bool>(input_checkpoint_stream);
+  orbit_rate_stale_ = read_binary_value<bool>(input_checkpoint_stream);
+  attitude_angles_stale_ = read_binary_value<bool>(input_checkpoint_stream);
+  gravity_gradient_torque_enabled_ =
+      read_binary_value<bool>(input_checkpoint_stream);
+  body_angular_velocity_vec_wrt_LVLH_in_body_frame_ =
+      read_binary_value<std::array<double, 3>>(input_checkpoint_stream);
+  perifocal_position_ =
+      read_binary_value<std::array<double, 3>>(input_checkpoint_stream);
+  perifocal_velocity_ =
+      read_binary_value<std::array<double, 3>>(input_checkpoint_stream);
+  ECI_position_ =
+      read_binary_value<std::array<double, 3>>(input_checkpoint_stream);
+  ECI_velocity_ =
+      read_binary_value<std::array<double, 3>>(input_checkpoint_stream);
+  residual_magnetic_dipole_ =
+      read_binary_value<std::array<double, 3>>(input_checkpoint_stream);
+  center_of_pressure_offset_ =
+      read_binary_value<std::array<double, 3>>(input_checkpoint_stream);
+  quaternion_satellite_bodyframe_wrt_LVLH_ =
+      read_binary_value<std::array<double, 4>>(input_checkpoint_stream);
+  std::array<double, 9> J_components =
+      read_binary_value<std::array<double, 9>>(input_checkpoint_stream);
+  inertia_tensor_ = InertiaTensor(Eigen::Map<Matrix3d>(J_components.data()));
+  force_model_fidelity_switch_.error_budget_ =
+      read_binary_value<double>(input_checkpoint_stream);
+  force_model_fidelity_switch_.hysteresis_ratio_ =
+      read_binary_value<double>(input_checkpoint_stream);
+  force_model_fidelity_switch_.disabled_force_term_mask_ =
+      read_binary_value<unsigned int>(input_checkpoint_stream);
+  name_ = read_binary_string(input_checkpoint_stream);
+  plotting_color_ = read_binary_string(input_checkpoint_stream);
+
+  thrust_profile_list_ =
+      read_binary_vector<ThrustProfileLVLH>(input_checkpoint_stream);
+  bodyframe_torque_profile_list_ =
+      read_binary_vector<BodyframeTorqueProfile>(input_checkpoint_stream);
+  impulsive_maneuver_list_ =
+      read_binary_vector<ImpulsiveManeuver>(input_checkpoint_stream);
+  next_impulsive_maneuver_index_ =
+      read_binary_value<uint64_t>(input_checkpoint_stream);
+  skipped_impulsive_maneuver_times_ =
+      read_binary_vector<double>(input_checkpoint_stream);
+  list_of_LVLH_forces_at_this_time_ =
+      read_binary_vector<std::array<double, 3>>(input_checkpoint_stream);
+  list_of_ECI_forces_at_this_time_ =
+      read_binary_vector<std::array<double, 3>>(input_checkpoint_stream);
+  list_of_body_frame_torques_at_this_time_ =
+      read_binary_vector<std::array<double, 3>>(input_checkpoint_stream);
+  thrust_schedule_LVLH_ =
+      PiecewiseConstantSchedule<4>(input_checkpoint_stream);
+  bodyframe_torque_schedule_ =
+      PiecewiseConstantSchedule<3>(input_checkpoint_stream);
+  magnetorquer_dipole_schedule_ =
+      PiecewiseConstantSchedule<3>(input_checkpoint_stream);
+  uint64_t num_thrust_curves =
+      read_binary_value<uint64_t>(input_checkpoint_stream);
+  for (uint64_t ind = 0; ind < num_thrust_curves; ind++) {
+    thrust_curve_list_.push_back(ThrustCurveLVLH(input_checkpoint_stream));
+  }
+
+  geomagnetic_field_ =
+      std::make_shared<GeomagneticField>(input_checkpoint_stream);
+  environment_ = std::make_shared<EnvironmentCache>(input_checkpoint_stream);
+  SGP4_propagation_enabled_ = read_binary_value<bool>(input_checkpoint_stream);
+  if (read_binary_value<bool>(input_checkpoint_stream)) {
+    SGP4_propagator_ = std::make_shared<const SGP4Propagator>(
+        std::vector<TwoLineElementSet>{
+            TwoLineElementSet(input_checkpoint_stream)});
+  }
+}
@@ -0,0 +1,206 @@
+#include "catalog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "binary_io.h"
+#include "checkpoint.h"
+#include "utils.h"
+
+const std::array<char, 8> catalog_cache_file_identifier = {'S', 'A', 'T', 'C',
+                                                           'A', 'C', 'H', 'E'};
+// CSV fields read as text rather than numbers
+const std::array<std::string, 2> catalog_text_fields = {"Name",
+                                                        "Plotting Color"};
+
+// Objective: split a line of a CSV file at its commas, trimming whitespace
+// around each cell
+std::vector<std::string> split_CSV_line(const std::string& input_line) {
+  std::vector<std::string> cells = {};
+  std::stringstream line_stream(input_line);
+  std::string cell;
+  while (std::getline(line_stream, cell, ',')) {
+    size_t first = cell.find_first_not_of(" \t\r");
+    size_t last = cell.find_last_not_of(" \t\r");
+    cells.push_back((first == std::string::npos)
+                        ? ""
+                        : cell.substr(first, last - first + 1));
+  }
+  return cells;
+}
+
+// Objective: convert a row of a CSV catalog into the fields of a satellite
+// input file
+json CSV_row_to_JSON(const std::vector<std::string>& input_field_names,
+                     const std::string& input_line) {
+  std::vector<std::string> cells = split_CSV_line(input_line);
+  if (cells.size() > input_field_names.size()) {
+    throw std::invalid_argument("Catalog row has more cells than the header: " +
+                                input_line);
+  }
+  json satellite_data = json::object();
+  for (size_t ind = 0; ind < cells.size(); ind++) {
+    const std::string& field_name = input_field_names.at(ind);
+    const std::string& cell = cells.at(ind);
+    if (cell.size() == 0) {
+      continue;
+    }
+    if (std::find(catalog_text_fields.begin(), catalog_text_fields.end(),
+                  field_name) != catalog_text_fields.end()) {
+      satellite_data[field_name] = cell;
+    } else if ((cell == "true") || (cell == "false")) {
+      satellite_data[field_name] = (cell == "true");
+    } else {
+      size_t num_characters_read = 0;
+      double value = {0};
+      try {
+        value = std::stod(cell, &num_characters_read);
+      } catch (const std::exception&) {
+        num_characters_read = 0;
+      }
+      if (num_characters_read != cell.size()) {
+        throw std::invalid_argument("Couldn't read catalog value " + cell +
+                                    " for field " + field_name);
+      }
+      satellite_data[field_name] = value;
+    }
+  }
+  return satellite_data;
+}
+
+// Objective: set up satellites in parallel, and collect them into a store in
+// the original order
+SatelliteStore build_catalog_store(
+    const size_t input_num_satellites, const size_t input_num_threads,
+    const std::function<Satellite(const size_t)>& input_build_satellite) {
+  std::vector<std::unique_ptr<Satellite>> satellites(input_num_satellites);
+  run_in_parallel(input_num_satellites, input_num_threads,
+                  [&](const size_t input_satellite_index) {
+                    satellites.at(input_satellite_index) =
+                        std::make_unique<Satellite>(
+                            input_build_satellite(input_satellite_index));
+                  });
+  SatelliteStore catalog_store;
+  catalog_store.reserve(input_num_satellites);
+  for (std::unique_ptr<Satellite>& satellite : satellites) {
+    catalog_store.add_satellite(std::move(*satellite));
+  }
+  share_environment(catalog_store.get_satellites());
+  return catalog_store;
+}
+
+SatelliteStore load_catalog(const std::string input_file_name,
+                            const size_t input_num_threads) {
+  std::ifstream input_filestream(input_file_name);
+  if (!input_filestream) {
+    throw std::invalid_argument("Failed to open catalog file " +
+                                input_file_name);
+  }
+  auto has_extension = [&](const std::string input_extension) {
+    return (input_file_name.size() >= input_extension.size()) &&
+           (input_file_name.compare(
+                input_file_name.size() - input_extension.size(),
+                input_extension.size(), input_extension) == 0);
+  };
+  if (has_extension(".tle")) {
+    // One propagator for the whole file, shared by its satellites
+    std::shared_ptr<const SGP4Propagator> SGP4_propagator =
+        std::make_shared<const SGP4Propagator>(
+            load_TLE_file(input_file_name));
+    return build_catalog_store(
+        SGP4_propagator->get_num_element_sets(), input_num_threads,
+        [&](const size_t input_element_set_index) {
+          return Satellite::from_TLE(SGP4_propagator, input_element_set_index);
+        });
+  }
+  if (has_extension(".csv")) {
+    std::string header_line;
+    std::getline(input_filestream, header_line);
+    std::vector<std::string> field_names = split_CSV_line(header_line);
+    std::vector<std::string> rows = {};
+    std::string line;
+    while (std::getline(input_filestream, line)) {
+      if (line.find_first_not_of(" \t\r") != std::string::npos) {
+        rows.push_back(line);
+      }
+    }
+    return build_catalog_store(rows.size(), input_num_threads,
+                               [&](const size_t input_row_index) {
+                                 return Satellite::from_JSON(CSV_row_to_JSON(
+                                     field_names, rows.at(input_row_index)));
+                               });
+  }
+  json catalog_data = json::parse(input_filestream);
+  if (!catalog_data.is_array()) {
+    throw std::invalid_argument(
+        "JSON catalogs must be an array of satellite entries");
+  }
+  return build_catalog_store(catalog_data.size(), input_num_threads,
+                             [&](const size_t input_entry_index) {
+                               return Satellite::from_JSON(
+                                   catalog_data.at(input_entry_index));
+                             });
+}
+
+// Objective: identify the current version of a catalog file by its size and
+// modification time
+std::array<int64_t, 2> calculate_catalog_stamp(
+    const std::string input_file_name) {
+  return {static_cast<int64_t>(std::filesystem::file_size(input_file_name)),
+          static_cast<int64_t>(std::filesystem::last_write_time(input_file_name)
+                                   .time_since_epoch()
+                                   .count())};
+}
+
+SatelliteStore load_catalog_cached(const std::string input_file_name,
+                                   const std::string input_cache_file_name,
+                                   const size_t input_num_threads) {
+  std::array<int64_t, 2> catalog_stamp =
+      calculate_catalog_stamp(input_file_name);
+  std::ifstream cache_filestream(input_cache_file_name, std::ios::binary);
+  if (cache_filestream) {
+    // Reading the whole cache with a single read, then restoring from memory.
+    // The cache isn't memory-mapped, since restoring rebuilds every
+    // Satellite object (strings, profile lists, environments) from the
+    // records anyway, so mapping would only replace this one sequential read
+    std::stringstream cache_contents;
+    cache_contents << cache_filestream.rdbuf();
+    try {
+      if ((read_binary_value<std::array<char, 8>>(cache_contents) ==
+           catalog_cache_file_identifier) &&
+          (read_binary_value<uint32_t>(cache_contents) ==
+           checkpoint_format_version) &&
+          (read_binary_value<std::array<int64_t, 2>>(cache_contents) ==
+           catalog_stamp)) {
+        SatelliteStore cached_store(cache_contents);
+        share_environment(cached_store.get_satellites());
+        share_SGP4_propagator(cached_store.get_satellites());
+        return cached_store;
+      }
+    } catch (const std::exception&) {
+      // Truncated or corrupted cache (a garbled length can also give
+      // std::length_error or std::bad_alloc), so fall back to the catalog
+    }
+  }
+
+  SatelliteStore catalog_store =
+      load_catalog(input_file_name, input_num_threads);
+  const std::string temporary_file_name = input_cache_file_name + ".tmp";
+  std::ofstream output_filestream(temporary_file_name, std::ios::binary);
+  write_binary_value(output_filestream, catalog_cache_file_identifier);
+  write_binary_value(output_filestream, checkpoint_format_version);
+  write_binary_value(output_filestream, catalog_stamp);
+  catalog_store.write_checkpoint(output_filestream);
+  output_filestream.close();
+  // Failing to write the cache only costs the next run the catalog parse
+  if (output_filestream) {
+    std::rename(temporary_file_name.c_str(), input_cache_file_name.c_str());
+  }
+  return catalog_store;
+}
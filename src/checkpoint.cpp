@@ -0,0 +1,116 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "binary_io.h"
+#include "utils.h"
+
+// Identifies the file type, followed by the contents of the file
+const std::array<char, 8> checkpoint_file_identifier = {'S', 'A', 'T', 'C',
+                                                        'K', 'P', 'T', '\0'};
+enum class CheckpointContents : uint8_t { satellite, satellite_store };
+
+// Objective: write the checkpoint file header
+void write_checkpoint_header(std::ostream& output_stream,
+                             const CheckpointContents input_contents) {
+  write_binary_value(output_stream, checkpoint_file_identifier);
+  write_binary_value(output_stream, checkpoint_format_version);
+  write_binary_value(output_stream, input_contents);
+}
+
+// Objective: check the checkpoint file header, throwing if the file isn't a
+// checkpoint of the expected contents and format version
+void read_checkpoint_header(std::istream& input_stream,
+                            const CheckpointContents input_contents) {
+  if (read_binary_value<std::array<char, 8>>(input_stream) !=
+      checkpoint_file_identifier) {
+    throw std::invalid_argument("Not a checkpoint file");
+  }
+  if (read_binary_value<uint32_t>(input_stream) !=
+      checkpoint_format_version) {
+    throw std::invalid_argument("Unsupported checkpoint format version");
+  }
+  if (read_binary_value<CheckpointContents>(input_stream) != input_contents) {
+    throw std::invalid_argument(
+        "Checkpoint file holds a satellite where a store was expected, or "
+        "vice versa");
+  }
+}
+
+// Objective: move a fully written temporary file into place
+void finish_checkpoint_file(std::ofstream& output_filestream,
+                            const std::string temporary_file_name,
+                            const std::string output_file_name) {
+  output_filestream.close();
+  if (!output_filestream) {
+    throw std::runtime_error("Failed to write checkpoint file " +
+                             temporary_file_name);
+  }
+  if (std::rename(temporary_file_name.c_str(), output_file_name.c_str()) !=
+      0) {
+    throw std::runtime_error("Failed to move checkpoint file into place at " +
+                             output_file_name);
+  }
+}
+
+std::ifstream open_checkpoint_file(const std::string input_file_name) {
+  std::ifstream input_filestream(input_file_name, std::ios::binary);
+  if (!input_filestream) {
+    throw std::invalid_argument("Failed to open checkpoint file " +
+                                input_file_name);
+  }
+  return input_filestream;
+}
+
+void save_checkpoint(const std::string output_file_name,
+                     const Satellite& input_satellite,
+                     const double input_next_timestep) {
+  const std::string temporary_file_name = output_file_name + ".tmp";
+  std::ofstream output_filestream(temporary_file_name, std::ios::binary);
+  write_checkpoint_header(output_filestream, CheckpointContents::satellite);
+  input_satellite.write_checkpoint(output_filestream);
+  write_binary_value(output_filestream, input_next_timestep);
+  finish_checkpoint_file(output_filestream, temporary_file_name,
+                         output_file_name);
+}
+
+std::pair<Satellite, double> load_checkpoint(
+    const std::string input_file_name) {
+  std::ifstream input_filestream = open_checkpoint_file(input_file_name);
+  read_checkpoint_header(input_filestream, CheckpointContents::satellite);
+  Satellite restored_satellite(input_filestream);
+  double next_timestep = read_binary_value<double>(input_filestream);
+  return {restored_satellite, next_timestep};
+}
+
+void save_store_checkpoint(const std::string output_file_name,
+                           const SatelliteStore& input_satellite_store,
+                           const std::vector<double>& input_next_timesteps) {
+  if (input_next_timesteps.size() != input_satellite_store.size()) {
+    throw std::invalid_argument(
+        "Need one next timestep per satellite in the store");
+  }
+  const std::string temporary_file_name = output_file_name + ".tmp";
+  std::ofstream output_filestream(temporary_file_name, std::ios::binary);
+  write_checkpoint_header(output_filestream,
+                          CheckpointContents::satellite_store);
+  input_satellite_store.write_checkpoint(output_filestream);
+  write_binary_vector(output_filestream, input_next_timesteps);
+  finish_checkpoint_file(output_filestream, temporary_file_name,
+                         output_file_name);
+}
+
+std::pair<SatelliteStore, std::vector<double>> load_store_checkpoint(
+    const std::string input_file_name) {
+  std::ifstream input_filestream = open_checkpoint_file(input_file_name);
+  read_checkpoint_header(input_filestream,
+                         CheckpointContents::satellite_store);
+  SatelliteStore restored_store(input_filestream);
+  std::vector<double> next_timesteps =
+      read_binary_vector<double>(input_filestream);
+  share_environment(restored_store.get_satellites());
+  share_SGP4_propagator(restored_store.get_satellites());
+  return {std::move(restored_store), next_timesteps};
+}
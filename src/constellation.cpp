@@ -0,0 +1,50 @@
+#include "constellation.h"
+
+#include <stdexcept>
+
+#include "utils.h"
+
+SatelliteStore generate_walker_constellation(
+    const size_t input_num_planes, const size_t input_satellites_per_plane,
+    const size_t input_phasing, const double input_altitude,
+    const double input_inclination, const WalkerPattern input_pattern,
+    const SatelliteElements& input_template) {
+  if ((input_num_planes == 0) || (input_satellites_per_plane == 0)) {
+    throw std::invalid_argument(
+        "Walker constellations need at least one plane and one satellite per "
+        "plane");
+  }
+  if (input_phasing >= input_num_planes) {
+    throw std::invalid_argument(
+        "Walker phasing must be less than the number of planes");
+  }
+  const size_t num_satellites = input_num_planes * input_satellites_per_plane;
+  const double RAAN_spread = (input_pattern == WalkerPattern::star) ? 180 : 360;
+  const double plane_RAAN_spacing = RAAN_spread / input_num_planes;
+  const double in_plane_spacing = 360.0 / input_satellites_per_plane;
+  const double interplane_phase_offset = 360.0 * input_phasing / num_satellites;
+  const std::string name_prefix =
+      (input_template.name.size() > 0) ? input_template.name : "Walker";
+
+  SatelliteElements elements = input_template;
+  elements.semimajor_axis = radius_Earth / 1000.0 + input_altitude;
+  elements.eccentricity = 0;
+  elements.arg_of_periapsis = 0;
+  elements.inclination = input_inclination;
+  SatelliteStore constellation_store;
+  constellation_store.reserve(num_satellites);
+  for (size_t plane = 0; plane < input_num_planes; plane++) {
+    for (size_t slot = 0; slot < input_satellites_per_plane; slot++) {
+      // For circular orbits the true anomaly is the argument of latitude
+      elements.raan = input_template.raan + plane * plane_RAAN_spacing;
+      elements.true_anomaly = input_template.true_anomaly +
+                              slot * in_plane_spacing +
+                              plane * interplane_phase_offset;
+      elements.name = name_prefix + "_" + std::to_string(plane) + "_" +
+                      std::to_string(slot);
+      constellation_store.add_satellite(Satellite(elements));
+    }
+  }
+  share_environment(constellation_store.get_satellites());
+  return constellation_store;
+}
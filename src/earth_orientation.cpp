@@ -0,0 +1,195 @@
+#define _USE_MATH_DEFINES
+#include "earth_orientation.h"
+
+#include <cmath>
+
+using Eigen::Vector3d;
+
+// Objective: frame rotation matrices about the x and z axes, i.e., the matrices
+// which give a vector's components in a frame rotated by input_angle about
+// that axis
+Matrix3d frame_rotation_x(const double input_angle) {
+  Matrix3d rotation_matrix;
+  rotation_matrix << 1, 0, 0, 0, cos(input_angle), sin(input_angle), 0,
+      -sin(input_angle), cos(input_angle);
+  return rotation_matrix;
+}
+
+Matrix3d frame_rotation_y(const double input_angle) {
+  Matrix3d rotation_matrix;
+  rotation_matrix << cos(input_angle), 0, -sin(input_angle), 0, 1, 0,
+      sin(input_angle), 0, cos(input_angle);
+  return rotation_matrix;
+}
+
+Matrix3d frame_rotation_z(const double input_angle) {
+  Matrix3d rotation_matrix;
+  rotation_matrix << cos(input_angle), sin(input_angle), 0, -sin(input_angle),
+      cos(input_angle), 0, 0, 0, 1;
+  return rotation_matrix;
+}
+
+double calculate_GMST(const double input_julian_date) {
+  // Ref: Meeus, Astronomical Algorithms, eq. 12.4 (equivalent to the IAU 1982
+  // GMST expression)
+  double days_since_J2000 = input_julian_date - julian_date_J2000;
+  double T = days_since_J2000 / 36525.0;
+  double GMST_degrees = 280.46061837 + 360.98564736629 * days_since_J2000 +
+                        0.000387933 * T * T - T * T * T / 38710000.0;
+  double GMST = fmod(GMST_degrees, 360.0) * (M_PI / 180.0);
+  if (GMST < 0) {
+    GMST += 2 * M_PI;
+  }
+  return GMST;
+}
+
+Matrix3d calculate_precession_matrix(const double input_julian_date) {
+  // IAU 1976 precession angles, ref: Vallado, Fundamentals of Astrodynamics
+  // and Applications, eq. 3-88 and Montenbruck & Gill, Satellite Orbits,
+  // section 5.3.1
+  const double arcsec_to_rad = M_PI / (180.0 * 3600.0);
+  double T = (input_julian_date - julian_date_J2000) / 36525.0;
+  double zeta =
+      (2306.2181 * T + 0.30188 * T * T + 0.017998 * T * T * T) * arcsec_to_rad;
+  double theta =
+      (2004.3109 * T - 0.42665 * T * T - 0.041833 * T * T * T) * arcsec_to_rad;
+  double z =
+      (2306.2181 * T + 1.09468 * T * T + 0.018203 * T * T * T) * arcsec_to_rad;
+  return frame_rotation_z(-z) * frame_rotation_y(theta) *
+         frame_rotation_z(-zeta);
+}
+
+std::pair<Matrix3d, double> calculate_nutation_matrix(
+    const double input_julian_date) {
+  // Largest terms of the IAU 1980 nutation series (accurate to ~0.5 arcsec),
+  // ref: Meeus, Astronomical Algorithms, chapter 22
+  const double deg_to_rad = M_PI / 180.0;
+  const double arcsec_to_rad = deg_to_rad / 3600.0;
+  double T = (input_julian_date - julian_date_J2000) / 36525.0;
+  // Longitude of the Moon's ascending node, and mean longitudes of the Sun
+  // and Moon
+  double Omega = (125.04452 - 1934.136261 * T) * deg_to_rad;
+  double L_sun = (280.4665 + 36000.7698 * T) * deg_to_rad;
+  double L_moon = (218.3165 + 481267.8813 * T) * deg_to_rad;
+
+  double delta_psi = (-17.20 * sin(Omega) - 1.32 * sin(2 * L_sun) -
+                      0.23 * sin(2 * L_moon) + 0.21 * sin(2 * Omega)) *
+                     arcsec_to_rad;
+  double delta_epsilon = (9.20 * cos(Omega) + 0.57 * cos(2 * L_sun) +
+                          0.10 * cos(2 * L_moon) - 0.09 * cos(2 * Omega)) *
+                         arcsec_to_rad;
+  double mean_obliquity = (23.43929111 - (46.8150 * T + 0.00059 * T * T -
+                                          0.001813 * T * T * T) /
+                                             3600.0) *
+                          deg_to_rad;
+  double true_obliquity = mean_obliquity + delta_epsilon;
+
+  Matrix3d nutation_matrix = frame_rotation_x(-true_obliquity) *
+                             frame_rotation_z(-delta_psi) *
+                             frame_rotation_x(mean_obliquity);
+  double equation_of_equinoxes = delta_psi * cos(true_obliquity);
+  return {nutation_matrix, equation_of_equinoxes};
+}
+
+// Objective: return the precession-nutation matrix and equation of the
+// equinoxes at the given node, computing them on first use
+const std::pair<Matrix3d, double>&
+EarthOrientation::get_precession_nutation_node(const long input_node_index) {
+  auto node_iterator = precession_nutation_nodes_.find(input_node_index);
+  if (node_iterator != precession_nutation_nodes_.end()) {
+    return node_iterator->second;
+  }
+  double node_julian_date = epoch_julian_date_ + input_node_index *
+                                                     node_spacing_ /
+                                                     seconds_per_day;
+  std::pair<Matrix3d, double> nutation =
+      calculate_nutation_matrix(node_julian_date);
+  std::pair<Matrix3d, double> node_value = {
+      nutation.first * calculate_precession_matrix(node_julian_date),
+      nutation.second};
+  return precession_nutation_nodes_.emplace(input_node_index, node_value)
+      .first->second;
+}
+
+Matrix3d EarthOrientation::calculate_ECI_to_ECEF_matrix(
+    const double input_time) {
+  double julian_date = epoch_julian_date_ + input_time / seconds_per_day;
+  double sidereal_angle = calculate_GMST(julian_date);
+  if (!include_precession_nutation_) {
+    return frame_rotation_z(sidereal_angle);
+  }
+  // Linear interpolation between the bracketing nodes. The result is
+  // orthogonal to well within the accuracy of the nutation series for node
+  // spacings of hours
+  long node_index = floor(input_time / node_spacing_);
+  double fraction = input_time / node_spacing_ - node_index;
+  const std::pair<Matrix3d, double>& start_node =
+      get_precession_nutation_node(node_index);
+  const std::pair<Matrix3d, double>& end_node =
+      get_precession_nutation_node(node_index + 1);
+  Matrix3d precession_nutation_matrix =
+      (1 - fraction) * start_node.first + fraction * end_node.first;
+  double equation_of_equinoxes =
+      (1 - fraction) * start_node.second + fraction * end_node.second;
+  // Apparent sidereal time
+  sidereal_angle += equation_of_equinoxes;
+  return frame_rotation_z(sidereal_angle) * precession_nutation_matrix;
+}
+
+const Matrix3d& EarthOrientation::get_ECI_to_ECEF_matrix(
+    const double input_time) {
+  for (size_t ind = 0; ind < num_cached_matrices_; ind++) {
+    if (cached_times_[ind] == input_time) {
+      return cached_ECI_to_ECEF_matrices_[ind];
+    }
+  }
+  size_t cache_slot = next_cache_slot_;
+  next_cache_slot_ = (next_cache_slot_ + 1) % num_cached_matrices_;
+  cached_ECI_to_ECEF_matrices_[cache_slot] =
+      calculate_ECI_to_ECEF_matrix(input_time);
+  cached_times_[cache_slot] = input_time;
+  num_matrix_calculations_++;
+  return cached_ECI_to_ECEF_matrices_[cache_slot];
+}
+
+std::array<double, 3> EarthOrientation::convert_ECI_to_ECEF(
+    const std::array<double, 3> input_ECI_vec, const double input_time) {
+  Vector3d ECEF_vec =
+      get_ECI_to_ECEF_matrix(input_time) *
+      Vector3d(input_ECI_vec.at(0), input_ECI_vec.at(1), input_ECI_vec.at(2));
+  return {ECEF_vec(0), ECEF_vec(1), ECEF_vec(2)};
+}
+
+std::array<double, 3> EarthOrientation::convert_ECEF_to_ECI(
+    const std::array<double, 3> input_ECEF_vec, const double input_time) {
+  // Rotation matrix, so the inverse is the transpose
+  Vector3d ECI_vec = get_ECI_to_ECEF_matrix(input_time).transpose() *
+                     Vector3d(input_ECEF_vec.at(0), input_ECEF_vec.at(1),
+                              input_ECEF_vec.at(2));
+  return {ECI_vec(0), ECI_vec(1), ECI_vec(2)};
+}
+
+std::array<double, 3> EarthOrientation::convert_ECI_to_ECEF_velocity(
+    const std::array<double, 3> input_ECI_position,
+    const std::array<double, 3> input_ECI_velocity, const double input_time) {
+  // v_ECEF = R v_ECI - omega x r_ECEF, neglecting the (much slower) rotation
+  // due to precession and nutation
+  std::array<double, 3> ECEF_position =
+      convert_ECI_to_ECEF(input_ECI_position, input_time);
+  std::array<double, 3> ECEF_velocity =
+      convert_ECI_to_ECEF(input_ECI_velocity, input_time);
+  ECEF_velocity.at(0) += earth_rotation_rate * ECEF_position.at(1);
+  ECEF_velocity.at(1) -= earth_rotation_rate * ECEF_position.at(0);
+  return ECEF_velocity;
+}
+
+std::array<double, 3> EarthOrientation::convert_ECEF_to_ECI_velocity(
+    const std::array<double, 3> input_ECEF_position,
+    const std::array<double, 3> input_ECEF_velocity, const double input_time) {
+  std::array<double, 3> inertial_velocity_in_ECEF = input_ECEF_velocity;
+  inertial_velocity_in_ECEF.at(0) -=
+      earth_rotation_rate * input_ECEF_position.at(1);
+  inertial_velocity_in_ECEF.at(1) +=
+      earth_rotation_rate * input_ECEF_position.at(0);
+  return convert_ECEF_to_ECI(inertial_velocity_in_ECEF, input_time);
+}
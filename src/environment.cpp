@@ -0,0 +1,126 @@
+#include "environment.h"
+
+#include "binary_io.h"
+
+// Objective: return the snapshot for the given evaluation time, reusing the
+// oldest snapshot if there isn't one yet
+EnvironmentCache::EnvironmentSnapshot& EnvironmentCache::get_snapshot(
+    const double input_time) {
+  // Search from the most recent snapshot backwards, since lookups mostly
+  // repeat recent times
+  for (size_t offset = 0; offset < num_snapshots_; offset++) {
+    size_t ind = (most_recent_snapshot_ + num_snapshots_ - offset) %
+                 num_snapshots_;
+    if (snapshots_[ind].t == input_time) {
+      return snapshots_[ind];
+    }
+  }
+  most_recent_snapshot_ = (most_recent_snapshot_ + 1) % num_snapshots_;
+  EnvironmentSnapshot& snapshot = snapshots_[most_recent_snapshot_];
+  snapshot.t = input_time;
+  snapshot.sun_position_computed = false;
+  snapshot.moon_position_computed = false;
+  snapshot.ECI_to_ECEF_matrix_computed = false;
+  return snapshot;
+}
+
+const std::array<double, 3>& EnvironmentCache::get_sun_position_ECI(
+    const double input_time) {
+  EnvironmentSnapshot& snapshot = get_snapshot(input_time);
+  if (!snapshot.sun_position_computed) {
+    snapshot.sun_position_ECI =
+        sun_moon_ephemeris_->get_sun_position_ECI(input_time);
+    snapshot.sun_position_computed = true;
+    num_sun_moon_evaluations_++;
+  }
+  return snapshot.sun_position_ECI;
+}
+
+const std::array<double, 3>& EnvironmentCache::get_moon_position_ECI(
+    const double input_time) {
+  EnvironmentSnapshot& snapshot = get_snapshot(input_time);
+  if (!snapshot.moon_position_computed) {
+    snapshot.moon_position_ECI =
+        sun_moon_ephemeris_->get_moon_position_ECI(input_time);
+    snapshot.moon_position_computed = true;
+    num_sun_moon_evaluations_++;
+  }
+  return snapshot.moon_position_ECI;
+}
+
+const Matrix3d& EnvironmentCache::get_ECI_to_ECEF_matrix(
+    const double input_time) {
+  EnvironmentSnapshot& snapshot = get_snapshot(input_time);
+  if (!snapshot.ECI_to_ECEF_matrix_computed) {
+    snapshot.ECI_to_ECEF_matrix =
+        earth_orientation_->get_ECI_to_ECEF_matrix(input_time);
+    snapshot.ECI_to_ECEF_matrix_computed = true;
+  }
+  return snapshot.ECI_to_ECEF_matrix;
+}
+
+void EnvironmentCache::add_space_weather_window(const double input_t_start,
+                                                const double input_t_end,
+                                                const double input_F_10,
+                                                const double input_A_p) {
+  space_weather_schedule_.add_window(input_t_start, input_t_end,
+                                     {input_F_10, input_A_p});
+}
+
+std::pair<double, double> EnvironmentCache::get_space_weather(
+    const double input_time) {
+  const std::array<double, 2>& space_weather =
+      space_weather_schedule_.get_value(input_time);
+  return {space_weather.at(0), space_weather.at(1)};
+}
+
+void EnvironmentCache::set_sun_moon_ephemeris(
+    std::shared_ptr<SunMoonEphemeris> input_sun_moon_ephemeris) {
+  sun_moon_ephemeris_ = input_sun_moon_ephemeris;
+  for (EnvironmentSnapshot& snapshot : snapshots_) {
+    snapshot.t = NAN;
+  }
+}
+
+void EnvironmentCache::set_earth_orientation(
+    std::shared_ptr<EarthOrientation> input_earth_orientation) {
+  earth_orientation_ = input_earth_orientation;
+  for (EnvironmentSnapshot& snapshot : snapshots_) {
+    snapshot.t = NAN;
+  }
+}
+
+EnvironmentCache::EnvironmentCache(std::istream& input_checkpoint_stream) {
+  double ephemeris_epoch_julian_date =
+      read_binary_value<double>(input_checkpoint_stream);
+  double segment_duration = read_binary_value<double>(input_checkpoint_stream);
+  uint64_t num_coefficients =
+      read_binary_value<uint64_t>(input_checkpoint_stream);
+  double earth_orientation_epoch_julian_date =
+      read_binary_value<double>(input_checkpoint_stream);
+  bool include_precession_nutation =
+      read_binary_value<bool>(input_checkpoint_stream);
+  double node_spacing = read_binary_value<double>(input_checkpoint_stream);
+  sun_moon_ephemeris_ = std::make_shared<SunMoonEphemeris>(
+      ephemeris_epoch_julian_date, segment_duration, num_coefficients);
+  earth_orientation_ = std::make_shared<EarthOrientation>(
+      earth_orientation_epoch_julian_date, include_precession_nutation,
+      node_spacing);
+  space_weather_schedule_ =
+      PiecewiseConstantSchedule<2>(input_checkpoint_stream);
+}
+
+void EnvironmentCache::write_checkpoint(std::ostream& output_stream) {
+  write_binary_value(output_stream,
+                     sun_moon_ephemeris_->get_epoch_julian_date());
+  write_binary_value(output_stream,
+                     sun_moon_ephemeris_->get_segment_duration());
+  write_binary_value<uint64_t>(output_stream,
+                               sun_moon_ephemeris_->get_num_coefficients());
+  write_binary_value(output_stream,
+                     earth_orientation_->get_epoch_julian_date());
+  write_binary_value(output_stream,
+                     earth_orientation_->get_include_precession_nutation());
+  write_binary_value(output_stream, earth_orientation_->get_node_spacing());
+  space_weather_schedule_.write_checkpoint(output_stream);
+}
@@ -0,0 +1,239 @@
+#define _USE_MATH_DEFINES
+#include "ephemeris.h"
+
+#include <cmath>
+#include <iostream>
+
+// Objective: rotate a vector from ecliptic coordinates to equatorial (ECI)
+// coordinates
+std::array<double, 3> convert_ecliptic_to_equatorial(
+    const std::array<double, 3> input_ecliptic_vec) {
+  // Obliquity of the ecliptic at J2000, ref: Montenbruck & Gill, Satellite
+  // Orbits, section 3.3.2
+  const double obliquity = 23.43929111 * (M_PI / 180.0);
+  std::array<double, 3> output_equatorial_vec = {
+      input_ecliptic_vec.at(0),
+      cos(obliquity) * input_ecliptic_vec.at(1) -
+          sin(obliquity) * input_ecliptic_vec.at(2),
+      sin(obliquity) * input_ecliptic_vec.at(1) +
+          cos(obliquity) * input_ecliptic_vec.at(2)};
+  return output_equatorial_vec;
+}
+
+std::array<double, 3> calculate_sun_position_ECI_analytic(
+    const double input_julian_date) {
+  // Low-precision solar coordinates from Montenbruck & Gill, Satellite Orbits,
+  // section 3.3.2 (accurate to ~0.1% in distance and ~1 arcmin in direction,
+  // which is plenty for a perturbing acceleration)
+  const double deg_to_rad = M_PI / 180.0;
+  const double arcsec_to_rad = deg_to_rad / 3600.0;
+  double T = (input_julian_date - julian_date_J2000) / 36525.0;
+
+  double M = (357.5256 + 35999.049 * T) * deg_to_rad;  // mean anomaly
+  double omega_plus_Omega = 282.94 * deg_to_rad;
+  double ecliptic_longitude = omega_plus_Omega + M +
+                              (6892.0 * sin(M) + 72.0 * sin(2 * M)) *
+                                  arcsec_to_rad;
+  double distance =
+      (149.619 - 2.499 * cos(M) - 0.021 * cos(2 * M)) * pow(10, 9);  // m
+
+  std::array<double, 3> ecliptic_position = {
+      distance * cos(ecliptic_longitude), distance * sin(ecliptic_longitude),
+      0.0};
+  return convert_ecliptic_to_equatorial(ecliptic_position);
+}
+
+std::array<double, 3> calculate_moon_position_ECI_analytic(
+    const double input_julian_date) {
+  // Low-precision lunar coordinates from Montenbruck & Gill, Satellite Orbits,
+  // section 3.3.2 (a truncated version of Brown's lunar theory, accurate to a
+  // few arcmin in direction and ~500 km in distance)
+  const double deg_to_rad = M_PI / 180.0;
+  const double arcsec_to_rad = deg_to_rad / 3600.0;
+  double T = (input_julian_date - julian_date_J2000) / 36525.0;
+
+  // Mean longitude, referred to the J2000 equinox
+  double L_0 = (218.31617 + 481267.88088 * T - 1.3972 * T) * deg_to_rad;
+  // Mean anomaly of the Moon
+  double l = (134.96292 + 477198.86753 * T) * deg_to_rad;
+  // Mean anomaly of the Sun
+  double l_p = (357.52543 + 35999.04944 * T) * deg_to_rad;
+  // Mean distance of the Moon from its ascending node
+  double F = (93.27283 + 483202.01873 * T) * deg_to_rad;
+  // Difference between the mean longitudes of the Sun and Moon
+  double D = (297.85027 + 445267.11135 * T) * deg_to_rad;
+
+  double ecliptic_longitude =
+      L_0 + (22640 * sin(l) + 769 * sin(2 * l) - 4586 * sin(l - 2 * D) +
+             2370 * sin(2 * D) - 668 * sin(l_p) - 412 * sin(2 * F) -
+             212 * sin(2 * l - 2 * D) - 206 * sin(l + l_p - 2 * D) +
+             192 * sin(l + 2 * D) - 165 * sin(l_p - 2 * D) +
+             148 * sin(l - l_p) - 125 * sin(D) - 110 * sin(l + l_p) -
+             55 * sin(2 * F - 2 * D)) *
+                arcsec_to_rad;
+
+  double ecliptic_latitude =
+      (18520 * sin(F + ecliptic_longitude - L_0 +
+                   (412 * sin(2 * F) + 541 * sin(l_p)) * arcsec_to_rad) -
+       526 * sin(F - 2 * D) + 44 * sin(l + F - 2 * D) -
+       31 * sin(-l + F - 2 * D) - 25 * sin(-2 * l + F) -
+       23 * sin(l_p + F - 2 * D) + 21 * sin(-l + F) +
+       11 * sin(-l_p + F - 2 * D)) *
+      arcsec_to_rad;
+
+  double distance =
+      (385000 - 20905 * cos(l) - 3699 * cos(2 * D - l) - 2956 * cos(2 * D) -
+       570 * cos(2 * l) + 246 * cos(2 * l - 2 * D) - 205 * cos(l_p - 2 * D) -
+       171 * cos(l + 2 * D) - 152 * cos(l + l_p - 2 * D)) *
+      1000.0;  // m
+
+  std::array<double, 3> ecliptic_position = {
+      distance * cos(ecliptic_longitude) * cos(ecliptic_latitude),
+      distance * sin(ecliptic_longitude) * cos(ecliptic_latitude),
+      distance * sin(ecliptic_latitude)};
+  return convert_ecliptic_to_equatorial(ecliptic_position);
+}
+
+std::array<double, 3> evaluate_chebyshev_series_3d(
+    const std::vector<double>& input_coefficients, const size_t input_offset,
+    const size_t input_num_coefficients, const double tau) {
+  // Clenshaw recurrence, ref:
+  // https://en.wikipedia.org/wiki/Clenshaw_algorithm#Special_case_for_Chebyshev_series
+  std::array<double, 3> output_vec = {0, 0, 0};
+  for (size_t comp = 0; comp < 3; comp++) {
+    size_t comp_offset = input_offset + comp * input_num_coefficients;
+    double b_kplus1 = 0;
+    double b_kplus2 = 0;
+    for (size_t j = input_num_coefficients - 1; j >= 1; j--) {
+      double b_k = 2 * tau * b_kplus1 - b_kplus2 +
+                   input_coefficients[comp_offset + j];
+      b_kplus2 = b_kplus1;
+      b_kplus1 = b_k;
+    }
+    output_vec[comp] =
+        tau * b_kplus1 - b_kplus2 + input_coefficients[comp_offset];
+  }
+  return output_vec;
+}
+
+// Objective: fit Chebyshev coefficients of the Sun and Moon positions over one
+// segment, and store them at the given storage index
+void SunMoonEphemeris::fit_segment(const size_t input_storage_index,
+                                   const long input_segment_index) {
+  // Interpolation at the Chebyshev nodes, ref:
+  // https://en.wikipedia.org/wiki/Chebyshev_nodes and Numerical Recipes
+  // section 5.8
+  const size_t N = num_coefficients_;
+  double segment_start_time = input_segment_index * segment_duration_;
+  size_t storage_offset = input_storage_index * 6 * N;
+
+  std::vector<std::array<double, 3>> sun_samples(N);
+  std::vector<std::array<double, 3>> moon_samples(N);
+  std::vector<double> node_angles(N);
+  for (size_t k = 0; k < N; k++) {
+    node_angles.at(k) = M_PI * (k + 0.5) / N;
+    double tau = cos(node_angles.at(k));
+    double sample_time =
+        segment_start_time + (tau + 1) * 0.5 * segment_duration_;
+    double sample_julian_date =
+        epoch_julian_date_ + sample_time / seconds_per_day;
+    sun_samples.at(k) = calculate_sun_position_ECI_analytic(sample_julian_date);
+    moon_samples.at(k) =
+        calculate_moon_position_ECI_analytic(sample_julian_date);
+  }
+
+  for (size_t j = 0; j < N; j++) {
+    std::array<double, 3> sun_coefficient = {0, 0, 0};
+    std::array<double, 3> moon_coefficient = {0, 0, 0};
+    for (size_t k = 0; k < N; k++) {
+      double T_j = cos(j * node_angles.at(k));
+      for (size_t comp = 0; comp < 3; comp++) {
+        sun_coefficient.at(comp) += sun_samples.at(k).at(comp) * T_j;
+        moon_coefficient.at(comp) += moon_samples.at(k).at(comp) * T_j;
+      }
+    }
+    // The zeroth coefficient carries half the weight of the others
+    double normalization = (j == 0) ? (1.0 / N) : (2.0 / N);
+    for (size_t comp = 0; comp < 3; comp++) {
+      coefficients_.at(storage_offset + comp * N + j) =
+          normalization * sun_coefficient.at(comp);
+      coefficients_.at(storage_offset + (3 + comp) * N + j) =
+          normalization * moon_coefficient.at(comp);
+    }
+  }
+  segment_fitted_.at(input_storage_index) = true;
+}
+
+// Objective: make sure the segment with the given index has been fitted,
+// growing the storage if needed, and return its storage index
+size_t SunMoonEphemeris::ensure_segment_fitted(const long input_segment_index) {
+  const size_t values_per_segment = 6 * num_coefficients_;
+  if (segment_fitted_.size() == 0) {
+    first_segment_index_ = input_segment_index;
+  }
+  if (input_segment_index < first_segment_index_) {
+    // Grow storage towards earlier times
+    size_t num_new_segments = first_segment_index_ - input_segment_index;
+    segment_fitted_.insert(segment_fitted_.begin(), num_new_segments, false);
+    coefficients_.insert(coefficients_.begin(),
+                         num_new_segments * values_per_segment, 0.0);
+    first_segment_index_ = input_segment_index;
+  }
+  size_t storage_index = input_segment_index - first_segment_index_;
+  if (storage_index >= segment_fitted_.size()) {
+    segment_fitted_.resize(storage_index + 1, false);
+    coefficients_.resize((storage_index + 1) * values_per_segment, 0.0);
+  }
+  if (!segment_fitted_[storage_index]) {
+    fit_segment(storage_index, input_segment_index);
+  }
+  return storage_index;
+}
+
+// Objective: fit all segments covering the given simulation time span up front,
+// so that no fitting happens during time evolution
+void SunMoonEphemeris::prefit(const double input_t_start,
+                              const double input_t_end) {
+  long first_index = floor(input_t_start / segment_duration_);
+  long last_index = floor(input_t_end / segment_duration_);
+  // Fit the last segment first so storage is only grown once
+  ensure_segment_fitted(last_index);
+  for (long segment_index = first_index; segment_index <= last_index;
+       segment_index++) {
+    ensure_segment_fitted(segment_index);
+  }
+}
+
+std::array<double, 3> SunMoonEphemeris::get_sun_position_ECI(
+    const double input_time) {
+  long segment_index = floor(input_time / segment_duration_);
+  size_t storage_index = ensure_segment_fitted(segment_index);
+  double tau = 2 * (input_time - segment_index * segment_duration_) /
+                   segment_duration_ -
+               1;
+  return evaluate_chebyshev_series_3d(coefficients_,
+                                      storage_index * 6 * num_coefficients_,
+                                      num_coefficients_, tau);
+}
+
+std::array<double, 3> SunMoonEphemeris::get_moon_position_ECI(
+    const double input_time) {
+  long segment_index = floor(input_time / segment_duration_);
+  size_t storage_index = ensure_segment_fitted(segment_index);
+  double tau = 2 * (input_time - segment_index * segment_duration_) /
+                   segment_duration_ -
+               1;
+  return evaluate_chebyshev_series_3d(
+      coefficients_, (storage_index * 6 + 3) * num_coefficients_,
+      num_coefficients_, tau);
+}
+
+size_t SunMoonEphemeris::get_num_fitted_segments() {
+  size_t num_fitted_segments = 0;
+  for (size_t ind = 0; ind < segment_fitted_.size(); ind++) {
+    if (segment_fitted_[ind]) {
+      num_fitted_segments++;
+    }
+  }
+  return num_fitted_segments;
+}
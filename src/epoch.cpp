@@ -0,0 +1,25 @@
+#include "epoch.h"
+
+#include <cmath>
+
+AbsoluteEpoch::AbsoluteEpoch(const int64_t input_day,
+                             const double input_seconds) {
+  // Carrying whole days from the seconds into the day number
+  double whole_days = floor(input_seconds / seconds_per_day);
+  day = input_day + static_cast<int64_t>(whole_days);
+  seconds = input_seconds - whole_days * seconds_per_day;
+  // Roundoff can leave seconds just outside [0, 86400)
+  if (seconds >= seconds_per_day) {
+    seconds -= seconds_per_day;
+    day++;
+  } else if (seconds < 0) {
+    seconds += seconds_per_day;
+    day--;
+  }
+}
+
+AbsoluteEpoch AbsoluteEpoch::from_julian_date(const double input_julian_date) {
+  double whole_days = floor(input_julian_date);
+  return AbsoluteEpoch(static_cast<int64_t>(whole_days),
+                       (input_julian_date - whole_days) * seconds_per_day);
+}
@@ -0,0 +1,200 @@
+#include "geomagnetic_field.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "binary_io.h"
+
+// IGRF-13 main field coefficients at epoch 2020.0 in nT, degrees 1 to 4 in
+// triangular order. Ref: Alken et al., International Geomagnetic Reference
+// Field: the thirteenth generation, Earth Planets Space 73, 49 (2021)
+const std::vector<double> IGRF_2020_g_coefficients = {
+    -29404.8, -1450.9,                      // n = 1
+    -2499.6,  2982.0,  1677.0,              // n = 2
+    1363.2,   -2381.2, 1236.2, 525.7,       // n = 3
+    903.0,    809.5,   86.3,   -309.4, 48.0};  // n = 4
+const std::vector<double> IGRF_2020_h_coefficients = {
+    0.0, 4652.5,                          // n = 1
+    0.0, -2991.6, -734.6,                 // n = 2
+    0.0, -82.1,   241.9,  -543.4,         // n = 3
+    0.0, 281.9,   -158.4, 199.7,  -349.7};  // n = 4
+
+void GeomagneticField::allocate_buffers() {
+  size_t num_terms = triangular_index(max_degree_, max_degree_) + 1;
+  P_buffer_.assign(num_terms, 0.0);
+  dP_buffer_.assign(num_terms, 0.0);
+  cos_m_phi_buffer_.assign(max_degree_ + 1, 0.0);
+  sin_m_phi_buffer_.assign(max_degree_ + 1, 0.0);
+}
+
+GeomagneticField::GeomagneticField(const int input_max_degree)
+    : GeomagneticField(IGRF_2020_g_coefficients, IGRF_2020_h_coefficients,
+                       max_tabulated_degree) {
+  if ((input_max_degree < 1) || (input_max_degree > max_tabulated_degree)) {
+    throw std::invalid_argument(
+        "Geomagnetic field degree must be between 1 and 4 for the built-in "
+        "IGRF coefficients");
+  }
+  // Truncating the tabulated expansion
+  max_degree_ = input_max_degree;
+  size_t num_terms = triangular_index(max_degree_, max_degree_) + 1;
+  g_coefficients_.resize(num_terms);
+  h_coefficients_.resize(num_terms);
+  allocate_buffers();
+}
+
+GeomagneticField::GeomagneticField(
+    const std::vector<double>& input_g_coefficients,
+    const std::vector<double>& input_h_coefficients,
+    const int input_max_degree) {
+  if (input_max_degree < 1) {
+    throw std::invalid_argument("Geomagnetic field degree must be at least 1");
+  }
+  max_degree_ = input_max_degree;
+  size_t num_terms = triangular_index(max_degree_, max_degree_) + 1;
+  // The input coefficients start from degree 1, so skip the (0, 0) entry
+  if ((input_g_coefficients.size() != num_terms - 1) ||
+      (input_h_coefficients.size() != num_terms - 1)) {
+    throw std::invalid_argument(
+        "Number of geomagnetic field coefficients doesn't match the degree");
+  }
+  g_coefficients_.assign(num_terms, 0.0);
+  h_coefficients_.assign(num_terms, 0.0);
+  for (size_t ind = 1; ind < num_terms; ind++) {
+    g_coefficients_.at(ind) = input_g_coefficients.at(ind - 1);
+    h_coefficients_.at(ind) = input_h_coefficients.at(ind - 1);
+  }
+  allocate_buffers();
+}
+
+GeomagneticField::GeomagneticField(std::istream& input_checkpoint_stream) {
+  max_degree_ = read_binary_value<int>(input_checkpoint_stream);
+  g_coefficients_ = read_binary_vector<double>(input_checkpoint_stream);
+  h_coefficients_ = read_binary_vector<double>(input_checkpoint_stream);
+  size_t num_terms = triangular_index(max_degree_, max_degree_) + 1;
+  if ((max_degree_ < 1) || (g_coefficients_.size() != num_terms) ||
+      (h_coefficients_.size() != num_terms)) {
+    throw std::invalid_argument(
+        "Checkpointed geomagnetic field coefficients don't match the degree");
+  }
+  allocate_buffers();
+}
+
+void GeomagneticField::write_checkpoint(std::ostream& output_stream) const {
+  write_binary_value(output_stream, max_degree_);
+  write_binary_vector(output_stream, g_coefficients_);
+  write_binary_vector(output_stream, h_coefficients_);
+}
+
+std::array<double, 3> GeomagneticField::calculate_field_ECEF(
+    const std::array<double, 3>& input_ECEF_position) {
+  // Gradient of the scalar potential
+  //   V = a sum_n (a/r)^(n+1) sum_m (g_n^m cos(m phi) + h_n^m sin(m phi))
+  //       P_n^m(cos(theta))
+  // in geocentric spherical coordinates (colatitude theta, longitude phi),
+  // ref: Montenbruck & Gill, Satellite Orbits, section 3.2 and the IGRF
+  // documentation at https://www.ngdc.noaa.gov/IAGA/vmod/igrf.html
+  num_field_evaluations_++;
+  const double x = input_ECEF_position.at(0);
+  const double y = input_ECEF_position.at(1);
+  const double z = input_ECEF_position.at(2);
+  const double r = sqrt(x * x + y * y + z * z);
+  const double rho = sqrt(x * x + y * y);
+  const double cos_theta = z / r;
+  // Keeping away from the poles, where the longitude is undefined
+  const double sin_theta = std::max(rho / r, 1e-12);
+  const double cos_phi = (rho > 0) ? x / rho : 1.0;
+  const double sin_phi = (rho > 0) ? y / rho : 0.0;
+
+  // cos(m phi) and sin(m phi) by the angle addition recurrence
+  cos_m_phi_buffer_[0] = 1;
+  sin_m_phi_buffer_[0] = 0;
+  for (int m = 1; m <= max_degree_; m++) {
+    cos_m_phi_buffer_[m] =
+        cos_m_phi_buffer_[m - 1] * cos_phi - sin_m_phi_buffer_[m - 1] * sin_phi;
+    sin_m_phi_buffer_[m] =
+        sin_m_phi_buffer_[m - 1] * cos_phi + cos_m_phi_buffer_[m - 1] * sin_phi;
+  }
+
+  // Schmidt semi-normalized associated Legendre functions of cos(theta) and
+  // their theta derivatives, ref:
+  // https://en.wikipedia.org/wiki/Associated_Legendre_polynomials and Wertz,
+  // Spacecraft Attitude Determination and Control, appendix H
+  P_buffer_[0] = 1;
+  dP_buffer_[0] = 0;
+  for (int n = 1; n <= max_degree_; n++) {
+    // Sectoral term from the previous sectoral term
+    const size_t nn = triangular_index(n, n);
+    const size_t previous_nn = triangular_index(n - 1, n - 1);
+    const double sectoral_factor =
+        (n == 1) ? 1.0 : sqrt((2.0 * n - 1) / (2 * n));
+    P_buffer_[nn] = sectoral_factor * sin_theta * P_buffer_[previous_nn];
+    dP_buffer_[nn] = sectoral_factor * (cos_theta * P_buffer_[previous_nn] +
+                                        sin_theta * dP_buffer_[previous_nn]);
+    // Remaining orders from the two previous degrees
+    for (int m = 0; m < n; m++) {
+      const size_t nm = triangular_index(n, m);
+      const size_t n1m = triangular_index(n - 1, m);
+      const double denominator = sqrt(1.0 * n * n - m * m);
+      P_buffer_[nm] = (2 * n - 1) * cos_theta * P_buffer_[n1m];
+      dP_buffer_[nm] = (2 * n - 1) * (cos_theta * dP_buffer_[n1m] -
+                                      sin_theta * P_buffer_[n1m]);
+      if (n >= 2 + m) {
+        const size_t n2m = triangular_index(n - 2, m);
+        const double previous_factor = sqrt(1.0 * (n - 1) * (n - 1) - m * m);
+        P_buffer_[nm] -= previous_factor * P_buffer_[n2m];
+        dP_buffer_[nm] -= previous_factor * dP_buffer_[n2m];
+      }
+      P_buffer_[nm] /= denominator;
+      dP_buffer_[nm] /= denominator;
+    }
+  }
+
+  double B_r = 0;
+  double B_theta = 0;
+  double B_phi = 0;
+  const double radius_ratio = geomagnetic_reference_radius / r;
+  double radius_ratio_power = radius_ratio * radius_ratio;
+  for (int n = 1; n <= max_degree_; n++) {
+    // (a/r)^(n+2)
+    radius_ratio_power *= radius_ratio;
+    for (int m = 0; m <= n; m++) {
+      const size_t nm = triangular_index(n, m);
+      const double g = g_coefficients_[nm];
+      const double h = h_coefficients_[nm];
+      const double cos_sum =
+          g * cos_m_phi_buffer_[m] + h * sin_m_phi_buffer_[m];
+      const double sin_sum =
+          -g * sin_m_phi_buffer_[m] + h * cos_m_phi_buffer_[m];
+      B_r += (n + 1) * radius_ratio_power * cos_sum * P_buffer_[nm];
+      B_theta -= radius_ratio_power * cos_sum * dP_buffer_[nm];
+      B_phi -= radius_ratio_power * m * sin_sum * P_buffer_[nm];
+    }
+  }
+  B_phi /= sin_theta;
+
+  // Spherical to Cartesian components, and nT to T
+  const double nT_to_T = 1e-9;
+  const double B_rho = B_r * sin_theta + B_theta * cos_theta;
+  return {(B_rho * cos_phi - B_phi * sin_phi) * nT_to_T,
+          (B_rho * sin_phi + B_phi * cos_phi) * nT_to_T,
+          (B_r * cos_theta - B_theta * sin_theta) * nT_to_T};
+}
+
+std::array<double, 3> calculate_geomagnetic_field_ECI(
+    GeomagneticField& input_geomagnetic_field,
+    const Eigen::Matrix3d& input_ECI_to_ECEF_matrix,
+    const std::array<double, 3>& input_ECI_position) {
+  Eigen::Vector3d ECEF_position =
+      input_ECI_to_ECEF_matrix *
+      Eigen::Vector3d(input_ECI_position.at(0), input_ECI_position.at(1),
+                      input_ECI_position.at(2));
+  std::array<double, 3> field_ECEF =
+      input_geomagnetic_field.calculate_field_ECEF(
+          {ECEF_position(0), ECEF_position(1), ECEF_position(2)});
+  // Rotation matrix, so the inverse is the transpose
+  Eigen::Vector3d field_ECI =
+      input_ECI_to_ECEF_matrix.transpose() *
+      Eigen::Vector3d(field_ECEF.at(0), field_ECEF.at(1), field_ECEF.at(2));
+  return {field_ECI(0), field_ECI(1), field_ECI(2)};
+}
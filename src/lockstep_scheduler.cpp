@@ -0,0 +1,74 @@
+#include "lockstep_scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+LockstepScheduler::LockstepScheduler(
+    const double input_epsilon,
+    const std::vector<ForceTerm>& input_force_terms,
+    const std::pair<double, double> drag_elements,
+    const double input_initial_timestep) {
+  epsilon_ = input_epsilon;
+  force_terms_ = input_force_terms;
+  drag_elements_ = drag_elements;
+  initial_timestep_ = input_initial_timestep;
+}
+
+int LockstepScheduler::synchronize(SatelliteStore& input_satellite_store,
+                                   const AbsoluteEpoch& input_sync_epoch) {
+  // Satellites added to the store since the last call start from the
+  // initial step size
+  if (next_timesteps_.size() < input_satellite_store.size()) {
+    next_timesteps_.resize(input_satellite_store.size(), initial_timestep_);
+  }
+  for (const SatelliteHandle& handle : input_satellite_store.get_handles()) {
+    Satellite& satellite = input_satellite_store.get_satellite(handle);
+    double& next_timestep = next_timesteps_.at(handle.index);
+    // Measured from the satellite's own epoch, so the difference between
+    // epochs is taken exactly rather than through Julian dates
+    const double t_sync = input_sync_epoch.seconds_since(satellite.get_epoch());
+    if (t_sync < satellite.get_instantaneous_time()) {
+      throw std::invalid_argument("Can't synchronize satellite " +
+                                  input_satellite_store.get_name(handle) +
+                                  " to an epoch before its current time");
+    }
+    while (satellite.get_instantaneous_time() < t_sync) {
+      // As in TrajectoryBranch::propagate, capping the step size lands
+      // exactly on the synchronization time
+      double remaining_time = t_sync - satellite.get_instantaneous_time();
+      double timestep_to_use = std::min(next_timestep, remaining_time);
+      std::pair<double, int> new_timestep_and_error_code =
+          satellite.evolve_RK45(epsilon_, timestep_to_use, force_terms_,
+                                drag_elements_);
+      if (new_timestep_and_error_code.second != 0) {
+        return new_timestep_and_error_code.second;
+      }
+      // The suggested size after a step cut short by the cap would be biased
+      // small, so it's only kept after full steps
+      if (timestep_to_use < remaining_time) {
+        next_timestep = new_timestep_and_error_code.first;
+      }
+    }
+  }
+  return 0;
+}
+
+int LockstepScheduler::run(
+    SatelliteStore& input_satellite_store,
+    const AbsoluteEpoch& input_first_sync_epoch,
+    const double input_sync_interval, const size_t input_num_syncs,
+    const std::function<void(const AbsoluteEpoch&, SatelliteStore&)>&
+        input_callback) {
+  for (size_t sync_ind = 0; sync_ind < input_num_syncs; sync_ind++) {
+    // Offsets from the first epoch rather than accumulated intervals, so
+    // roundoff doesn't build up over many synchronizations
+    AbsoluteEpoch sync_epoch =
+        input_first_sync_epoch.add_seconds(sync_ind * input_sync_interval);
+    int error_code = synchronize(input_satellite_store, sync_epoch);
+    if (error_code != 0) {
+      return error_code;
+    }
+    input_callback(sync_epoch, input_satellite_store);
+  }
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include "satellite_store.h"
+
+#include <utility>
+
+#include "binary_io.h"
+
+SatelliteStore::SatelliteStore(std::vector<Satellite> input_satellite_vector) {
+  reserve(input_satellite_vector.size());
+  for (Satellite& current_satellite : input_satellite_vector) {
+    add_satellite(std::move(current_satellite));
+  }
+}
+
+SatelliteHandle SatelliteStore::add_satellite(Satellite input_satellite) {
+  satellites_.push_back(std::move(input_satellite));
+  return {satellites_.size() - 1};
+}
+
+void SatelliteStore::reserve(const size_t input_num_satellites) {
+  satellites_.reserve(input_num_satellites);
+}
+
+std::vector<SatelliteHandle> SatelliteStore::get_handles() const {
+  std::vector<SatelliteHandle> handles(satellites_.size());
+  for (size_t ind = 0; ind < handles.size(); ind++) {
+    handles.at(ind).index = ind;
+  }
+  return handles;
+}
+
+SatelliteStore::SatelliteStore(std::istream& input_checkpoint_stream) {
+  uint64_t num_satellites =
+      read_binary_value<uint64_t>(input_checkpoint_stream);
+  reserve(num_satellites);
+  for (uint64_t ind = 0; ind < num_satellites; ind++) {
+    satellites_.push_back(Satellite(input_checkpoint_stream));
+  }
+}
+
+void SatelliteStore::write_checkpoint(std::ostream& output_stream) const {
+  write_binary_value<uint64_t>(output_stream, satellites_.size());
+  for (const Satellite& satellite : satellites_) {
+    satellite.write_checkpoint(output_stream);
+  }
+}
@@ -0,0 +1,535 @@
+#define _USE_MATH_DEFINES
+#include "sgp4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include "binary_io.h"
+
+// WGS-72 constants used by SGP4, ref: Vallado et al., Revisiting Spacetrack
+// Report #3, AIAA 2006-6753, section on gravitational constants. Distances
+// are in Earth radii and times in minutes inside the propagator
+const double SGP4_earth_radius = 6378.135;  // km
+const double SGP4_mu = 398600.8;            // km^3/s^2
+const double SGP4_xke =
+    60.0 / sqrt(SGP4_earth_radius * SGP4_earth_radius * SGP4_earth_radius /
+                SGP4_mu);  // sqrt(mu) in Earth radii^1.5/min
+const double SGP4_J2 = 0.001082616;
+const double SGP4_J3 = -0.00000253881;
+const double SGP4_J4 = -0.00000165597;
+// Element sets with longer periods need the deep-space model
+const double SGP4_deep_space_period = 225.0;  // min
+// Iterations used for the Kepler equation, the reference's maximum
+const int SGP4_num_kepler_iterations = 10;
+
+TwoLineElementSet::TwoLineElementSet(std::istream& input_checkpoint_stream) {
+  name = read_binary_string(input_checkpoint_stream);
+  catalog_number = read_binary_value<int>(input_checkpoint_stream);
+  epoch = read_binary_value<AbsoluteEpoch>(input_checkpoint_stream);
+  bstar = read_binary_value<double>(input_checkpoint_stream);
+  inclination = read_binary_value<double>(input_checkpoint_stream);
+  raan = read_binary_value<double>(input_checkpoint_stream);
+  eccentricity = read_binary_value<double>(input_checkpoint_stream);
+  arg_of_perigee = read_binary_value<double>(input_checkpoint_stream);
+  mean_anomaly = read_binary_value<double>(input_checkpoint_stream);
+  mean_motion = read_binary_value<double>(input_checkpoint_stream);
+}
+
+void TwoLineElementSet::write_checkpoint(std::ostream& output_stream) const {
+  write_binary_string(output_stream, name);
+  write_binary_value(output_stream, catalog_number);
+  write_binary_value(output_stream, epoch);
+  write_binary_value(output_stream, bstar);
+  write_binary_value(output_stream, inclination);
+  write_binary_value(output_stream, raan);
+  write_binary_value(output_stream, eccentricity);
+  write_binary_value(output_stream, arg_of_perigee);
+  write_binary_value(output_stream, mean_anomaly);
+  write_binary_value(output_stream, mean_motion);
+}
+
+// Objective: read the number in the given columns of a TLE line
+double parse_TLE_field(const std::string& input_line,
+                       const size_t input_start_column,
+                       const size_t input_num_columns) {
+  std::string field = input_line.substr(input_start_column, input_num_columns);
+  size_t num_characters_read = 0;
+  double value = {0};
+  try {
+    value = std::stod(field, &num_characters_read);
+  } catch (const std::exception&) {
+    num_characters_read = 0;
+  }
+  if ((num_characters_read == 0) ||
+      (field.find_first_not_of(" ", num_characters_read) !=
+       std::string::npos)) {
+    throw std::invalid_argument("Couldn't read TLE field \"" + field +
+                                "\" in line: " + input_line);
+  }
+  return value;
+}
+
+// Objective: read a field in the TLE's exponential format with an assumed
+// leading decimal point, e.g. " 12345-4" for 0.12345e-4
+double parse_TLE_exponent_field(const std::string& input_line,
+                                const size_t input_start_column) {
+  double mantissa =
+      parse_TLE_field("." + input_line.substr(input_start_column + 1, 5), 0, 6);
+  double exponent = parse_TLE_field(input_line, input_start_column + 6, 2);
+  double sign = (input_line.at(input_start_column) == '-') ? -1.0 : 1.0;
+  return sign * mantissa * pow(10.0, exponent);
+}
+
+// Objective: check the line number and the checksum (the sum of the digits,
+// with each minus sign counting as 1, modulo 10) of a TLE line
+void check_TLE_line(const std::string& input_line,
+                    const char input_line_number) {
+  const size_t TLE_line_length = 69;
+  if ((input_line.size() < TLE_line_length) ||
+      (input_line.at(0) != input_line_number) || (input_line.at(1) != ' ')) {
+    throw std::invalid_argument("Malformed TLE line " +
+                                std::string(1, input_line_number) + ": " +
+                                input_line);
+  }
+  int checksum = 0;
+  for (size_t ind = 0; ind < TLE_line_length - 1; ind++) {
+    if (isdigit(input_line.at(ind))) {
+      checksum += input_line.at(ind) - '0';
+    } else if (input_line.at(ind) == '-') {
+      checksum += 1;
+    }
+  }
+  if (checksum % 10 != input_line.at(TLE_line_length - 1) - '0') {
+    throw std::invalid_argument("TLE checksum mismatch in line: " +
+                                input_line);
+  }
+}
+
+TwoLineElementSet parse_TLE(const std::string& input_line_1,
+                            const std::string& input_line_2,
+                            const std::string input_name) {
+  check_TLE_line(input_line_1, '1');
+  check_TLE_line(input_line_2, '2');
+  TwoLineElementSet element_set;
+  element_set.name = input_name;
+  element_set.catalog_number =
+      static_cast<int>(parse_TLE_field(input_line_1, 2, 5));
+  if (static_cast<int>(parse_TLE_field(input_line_2, 2, 5)) !=
+      element_set.catalog_number) {
+    throw std::invalid_argument("TLE lines are for different satellites: " +
+                                input_line_1.substr(2, 5) + " and " +
+                                input_line_2.substr(2, 5));
+  }
+
+  // Two-digit years from 57 onwards are in the 1900s. The day of the year
+  // starts from 1 at midnight on January 1st
+  int epoch_year = static_cast<int>(parse_TLE_field(input_line_1, 18, 2));
+  epoch_year += (epoch_year < 57) ? 2000 : 1900;
+  double epoch_day_of_year = parse_TLE_field(input_line_1, 20, 12);
+  // Julian date of midnight on January 1st, valid from 1901 to 2099, ref:
+  // Vallado, Fundamentals of Astrodynamics and Applications, algorithm 14.
+  // This is a whole number plus a half, so the epoch can be assembled without
+  // rounding the fraction of the day to a Julian date's precision
+  int64_t january_1_julian_day =
+      367 * epoch_year - (7 * epoch_year) / 4 + 275 / 9 + 1 + 1721013;
+  double whole_days = floor(epoch_day_of_year);
+  element_set.epoch =
+      AbsoluteEpoch(january_1_julian_day + static_cast<int64_t>(whole_days),
+                    (0.5 + epoch_day_of_year - whole_days - 1.0) *
+                        seconds_per_day);
+  element_set.bstar = parse_TLE_exponent_field(input_line_1, 53);
+
+  element_set.inclination = parse_TLE_field(input_line_2, 8, 8);
+  element_set.raan = parse_TLE_field(input_line_2, 17, 8);
+  element_set.eccentricity =
+      parse_TLE_field("0." + input_line_2.substr(26, 7), 0, 9);
+  element_set.arg_of_perigee = parse_TLE_field(input_line_2, 34, 8);
+  element_set.mean_anomaly = parse_TLE_field(input_line_2, 43, 8);
+  element_set.mean_motion = parse_TLE_field(input_line_2, 52, 11);
+  return element_set;
+}
+
+std::vector<TwoLineElementSet> load_TLE_file(
+    const std::string input_file_name) {
+  std::ifstream input_filestream(input_file_name);
+  if (!input_filestream) {
+    throw std::invalid_argument("Failed to open TLE file " + input_file_name);
+  }
+  std::vector<std::string> lines = {};
+  std::string line;
+  while (std::getline(input_filestream, line)) {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (line.size() > 0) {
+      lines.push_back(line);
+    }
+  }
+
+  std::vector<TwoLineElementSet> element_sets = {};
+  std::string name = "";
+  for (size_t ind = 0; ind < lines.size(); ind++) {
+    if ((lines.at(ind).rfind("1 ", 0) == 0) && (ind + 1 < lines.size()) &&
+        (lines.at(ind + 1).rfind("2 ", 0) == 0)) {
+      element_sets.push_back(
+          parse_TLE(lines.at(ind), lines.at(ind + 1), name));
+      name = "";
+      ind++;
+    } else {
+      // Name line. Some sources prefix these with "0 "
+      name = lines.at(ind);
+      if (name.rfind("0 ", 0) == 0) {
+        name = name.substr(2);
+      }
+    }
+  }
+  return element_sets;
+}
+
+Matrix3d calculate_TEME_to_ECI_matrix(const double input_julian_date) {
+  // TEME is the true-of-date frame rotated about its z axis by the equation
+  // of the equinoxes, i.e., its x axis points along the mean rather than the
+  // true equinox
+  std::pair<Matrix3d, double> nutation =
+      calculate_nutation_matrix(input_julian_date);
+  Matrix3d ECI_to_true_of_date_matrix =
+      nutation.first * calculate_precession_matrix(input_julian_date);
+  return ECI_to_true_of_date_matrix.transpose() *
+         frame_rotation_z(-nutation.second);
+}
+
+SGP4Propagator::SGP4Propagator(
+    const std::vector<TwoLineElementSet>& input_element_sets) {
+  // Ref: Vallado et al., Revisiting Spacetrack Report #3, AIAA 2006-6753,
+  // routines initl and sgp4init, restricted to the near-Earth model
+  element_sets_ = input_element_sets;
+  const size_t num_element_sets = element_sets_.size();
+  for (std::vector<double>* constant :
+       {&inclo_,   &nodeo_,   &argpo_,  &mo_,     &ecco_,   &bstar_,
+        &no_unkozai_, &mdot_, &argpdot_, &nodedot_, &nodecf_, &cc1_,
+        &cc4_,     &cc5_,     &t2cof_,  &t3cof_,  &t4cof_,  &t5cof_,
+        &d2_,      &d3_,      &d4_,     &omgcof_, &xmcof_,  &eta_,
+        &delmo_,   &sinmao_,  &aycof_,  &xlcof_,  &con41_,  &x1mth2_,
+        &x7thm1_}) {
+    constant->assign(num_element_sets, 0.0);
+  }
+
+  const double deg_to_rad = M_PI / 180.0;
+  const double J3_over_J2 = SGP4_J3 / SGP4_J2;
+  const double x2o3 = 2.0 / 3.0;
+  // Parameters of the atmospheric density model, in Earth radii
+  const double ss = 78.0 / SGP4_earth_radius + 1.0;
+  const double qzms2t = pow((120.0 - 78.0) / SGP4_earth_radius, 4);
+  for (size_t ind = 0; ind < num_element_sets; ind++) {
+    const TwoLineElementSet& element_set = element_sets_.at(ind);
+    const double inclo = element_set.inclination * deg_to_rad;
+    const double argpo = element_set.arg_of_perigee * deg_to_rad;
+    const double mo = element_set.mean_anomaly * deg_to_rad;
+    const double ecco = element_set.eccentricity;
+    const double bstar = element_set.bstar;
+    // rev/day to rad/min
+    const double no_kozai = element_set.mean_motion * 2 * M_PI / 1440.0;
+    if ((no_kozai <= 0) || (ecco < 0) || (ecco >= 1)) {
+      throw std::invalid_argument(
+          "Invalid mean motion or eccentricity in TLE for satellite " +
+          std::to_string(element_set.catalog_number));
+    }
+    inclo_[ind] = inclo;
+    nodeo_[ind] = element_set.raan * deg_to_rad;
+    argpo_[ind] = argpo;
+    mo_[ind] = mo;
+    ecco_[ind] = ecco;
+    bstar_[ind] = bstar;
+
+    // Recovering the original (un-Kozai'd) mean motion and semimajor axis
+    const double eccsq = ecco * ecco;
+    const double omeosq = 1.0 - eccsq;
+    const double rteosq = sqrt(omeosq);
+    const double cosio = cos(inclo);
+    const double cosio2 = cosio * cosio;
+    const double ak = pow(SGP4_xke / no_kozai, x2o3);
+    const double d1 =
+        0.75 * SGP4_J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+    double del = d1 / (ak * ak);
+    const double adel =
+        ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+    del = d1 / (adel * adel);
+    const double no_unkozai = no_kozai / (1.0 + del);
+    if (2 * M_PI / no_unkozai >= SGP4_deep_space_period) {
+      throw std::invalid_argument(
+          "Only near-Earth TLEs (periods under 225 minutes) are supported by "
+          "SGP4Propagator, not satellite " +
+          std::to_string(element_set.catalog_number));
+    }
+    no_unkozai_[ind] = no_unkozai;
+    const double ao = pow(SGP4_xke / no_unkozai, x2o3);
+    const double sinio = sin(inclo);
+    const double po = ao * omeosq;
+    const double con42 = 1.0 - 5.0 * cosio2;
+    const double con41 = -con42 - cosio2 - cosio2;
+    const double posq = po * po;
+    const double rp = ao * (1.0 - ecco);
+    con41_[ind] = con41;
+
+    // Perigees below 220 km use a simplified drag model, and the density
+    // model's parameters are adjusted for perigees below 156 km
+    const bool isimp = (rp < 220.0 / SGP4_earth_radius + 1.0);
+    double sfour = ss;
+    double qzms24 = qzms2t;
+    const double perige = (rp - 1.0) * SGP4_earth_radius;
+    if (perige < 156.0) {
+      sfour = perige - 78.0;
+      if (perige < 98.0) {
+        sfour = 20.0;
+      }
+      qzms24 = pow((120.0 - sfour) / SGP4_earth_radius, 4);
+      sfour = sfour / SGP4_earth_radius + 1.0;
+    }
+    const double pinvsq = 1.0 / posq;
+    const double tsi = 1.0 / (ao - sfour);
+    const double eta = ao * ecco * tsi;
+    const double etasq = eta * eta;
+    const double eeta = ecco * eta;
+    const double psisq = fabs(1.0 - etasq);
+    const double coef = qzms24 * pow(tsi, 4);
+    const double coef1 = coef / pow(psisq, 3.5);
+    const double cc2 =
+        coef1 * no_unkozai *
+        (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+         0.375 * SGP4_J2 * tsi / psisq * con41 *
+             (8.0 + 3.0 * etasq * (8.0 + etasq)));
+    const double cc1 = bstar * cc2;
+    double cc3 = 0.0;
+    if (ecco > 1.0e-4) {
+      cc3 = -2.0 * coef * tsi * J3_over_J2 * no_unkozai * sinio / ecco;
+    }
+    const double x1mth2 = 1.0 - cosio2;
+    eta_[ind] = eta;
+    cc1_[ind] = cc1;
+    x1mth2_[ind] = x1mth2;
+    cc4_[ind] = 2.0 * no_unkozai * coef1 * ao * omeosq *
+                (eta * (2.0 + 0.5 * etasq) + ecco * (0.5 + 2.0 * etasq) -
+                 SGP4_J2 * tsi / (ao * psisq) *
+                     (-3.0 * con41 *
+                          (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+                      0.75 * x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) *
+                          cos(2.0 * argpo)));
+    const double cc5 = 2.0 * coef1 * ao * omeosq *
+                       (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+    // Secular rates from J2 and J4
+    const double cosio4 = cosio2 * cosio2;
+    const double temp1 = 1.5 * SGP4_J2 * pinvsq * no_unkozai;
+    const double temp2 = 0.5 * temp1 * SGP4_J2 * pinvsq;
+    const double temp3 = -0.46875 * SGP4_J4 * pinvsq * pinvsq * no_unkozai;
+    mdot_[ind] = no_unkozai + 0.5 * temp1 * rteosq * con41 +
+                 0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 +
+                                            137.0 * cosio4);
+    argpdot_[ind] =
+        -0.5 * temp1 * con42 +
+        0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+        temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+    const double xhdot1 = -temp1 * cosio;
+    nodedot_[ind] = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) +
+                              2.0 * temp3 * (3.0 - 7.0 * cosio2)) *
+                                 cosio;
+    nodecf_[ind] = 3.5 * omeosq * xhdot1 * cc1;
+    t2cof_[ind] = 1.5 * cc1;
+    // Avoiding a division by zero for inclinations of 180 degrees
+    const double one_plus_cosio = std::max(fabs(1.0 + cosio), 1.5e-12);
+    xlcof_[ind] =
+        -0.25 * J3_over_J2 * sinio * (3.0 + 5.0 * cosio) / one_plus_cosio;
+    aycof_[ind] = -0.5 * J3_over_J2 * sinio;
+    x7thm1_[ind] = 7.0 * cosio2 - 1.0;
+
+    // Higher order drag terms, which stay 0 for the simplified drag model
+    if (!isimp) {
+      omgcof_[ind] = bstar * cc3 * cos(argpo);
+      if (ecco > 1.0e-4) {
+        xmcof_[ind] = -x2o3 * coef * bstar / eeta;
+      }
+      delmo_[ind] = pow(1.0 + eta * cos(mo), 3);
+      sinmao_[ind] = sin(mo);
+      cc5_[ind] = cc5;
+      const double cc1sq = cc1 * cc1;
+      const double d2 = 4.0 * ao * tsi * cc1sq;
+      const double temp = d2 * tsi * cc1 / 3.0;
+      const double d3 = (17.0 * ao + sfour) * temp;
+      const double d4 =
+          0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * cc1;
+      d2_[ind] = d2;
+      d3_[ind] = d3;
+      d4_[ind] = d4;
+      t3cof_[ind] = d2 + 2.0 * cc1sq;
+      t4cof_[ind] = 0.25 * (3.0 * d3 + cc1 * (12.0 * d2 + 10.0 * cc1sq));
+      t5cof_[ind] = 0.2 * (3.0 * d4 + 12.0 * cc1 * d3 + 6.0 * d2 * d2 +
+                           15.0 * cc1sq * (2.0 * d2 + cc1sq));
+    }
+  }
+}
+
+// Objective: propagate element sets input_begin to input_end - 1, reading
+// and writing entries from 0 of the input and output arrays
+void SGP4Propagator::propagate_range(
+    const size_t input_begin, const size_t input_end,
+    const double* input_times, std::array<double, 3>* output_TEME_positions,
+    std::array<double, 3>* output_TEME_velocities,
+    int* output_error_codes) const {
+  // Ref: Vallado et al., Revisiting Spacetrack Report #3, AIAA 2006-6753,
+  // routine sgp4, restricted to the near-Earth model
+  const double two_pi = 2 * M_PI;
+  const double x2o3 = 2.0 / 3.0;
+  const double vkmpersec = SGP4_earth_radius * SGP4_xke / 60.0;
+  for (size_t ind = input_begin; ind < input_end; ind++) {
+    const size_t output_index = ind - input_begin;
+    // s to min
+    const double t = input_times[output_index] / 60.0;
+
+    // Secular gravity and drag
+    const double xmdf = mo_[ind] + mdot_[ind] * t;
+    const double argpdf = argpo_[ind] + argpdot_[ind] * t;
+    const double nodedf = nodeo_[ind] + nodedot_[ind] * t;
+    const double t2 = t * t;
+    const double t3 = t2 * t;
+    const double t4 = t3 * t;
+    double nodem = nodedf + nodecf_[ind] * t2;
+    const double delomg = omgcof_[ind] * t;
+    const double delm =
+        xmcof_[ind] * (pow(1.0 + eta_[ind] * cos(xmdf), 3) - delmo_[ind]);
+    double mm = xmdf + delomg + delm;
+    double argpm = argpdf - delomg - delm;
+    const double tempa = 1.0 - cc1_[ind] * t - d2_[ind] * t2 -
+                         d3_[ind] * t3 - d4_[ind] * t4;
+    const double tempe = bstar_[ind] * cc4_[ind] * t +
+                         bstar_[ind] * cc5_[ind] * (sin(mm) - sinmao_[ind]);
+    const double templ = t2cof_[ind] * t2 + t3cof_[ind] * t3 +
+                         t4 * (t4cof_[ind] + t * t5cof_[ind]);
+
+    const double am =
+        pow(SGP4_xke / no_unkozai_[ind], x2o3) * tempa * tempa;
+    const double nm = SGP4_xke / pow(am, 1.5);
+    double em = ecco_[ind] - tempe;
+    int error_code = ((em >= 1.0) || (em < -0.001)) ? 1 : 0;
+    em = std::max(em, 1.0e-6);
+    mm += no_unkozai_[ind] * templ;
+    double xlm = mm + argpm + nodem;
+    nodem = fmod(nodem, two_pi);
+    argpm = fmod(argpm, two_pi);
+    xlm = fmod(xlm, two_pi);
+    mm = fmod(xlm - argpm - nodem, two_pi);
+    const double sinim = sin(inclo_[ind]);
+    const double cosim = cos(inclo_[ind]);
+
+    // Long period periodics
+    const double axnl = em * cos(argpm);
+    double temp = 1.0 / (am * (1.0 - em * em));
+    const double aynl = em * sin(argpm) + temp * aycof_[ind];
+    const double xl = mm + argpm + nodem + temp * xlcof_[ind] * axnl;
+
+    // Kepler's equation, with the Newton steps limited to 0.95 rad
+    const double u = fmod(xl - nodem, two_pi);
+    double eo1 = u;
+    double sineo1 = 0;
+    double coseo1 = 0;
+    for (int iteration = 0; iteration < SGP4_num_kepler_iterations;
+         iteration++) {
+      sineo1 = sin(eo1);
+      coseo1 = cos(eo1);
+      double tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) /
+                    (1.0 - coseo1 * axnl - sineo1 * aynl);
+      eo1 += std::min(std::max(tem5, -0.95), 0.95);
+    }
+
+    // Short period periodics
+    const double ecose = axnl * coseo1 + aynl * sineo1;
+    const double esine = axnl * sineo1 - aynl * coseo1;
+    const double el2 = axnl * axnl + aynl * aynl;
+    const double pl = am * (1.0 - el2);
+    if ((error_code == 0) && (pl < 0.0)) {
+      error_code = 4;
+    }
+    const double rl = am * (1.0 - ecose);
+    const double rdotl = sqrt(am) * esine / rl;
+    const double rvdotl = sqrt(pl) / rl;
+    const double betal = sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    const double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    const double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = atan2(sinu, cosu);
+    const double sin2u = (cosu + cosu) * sinu;
+    const double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    const double temp1 = 0.5 * SGP4_J2 * temp;
+    const double temp2 = temp1 * temp;
+
+    const double mrt =
+        rl * (1.0 - 1.5 * temp2 * betal * con41_[ind]) +
+        0.5 * temp1 * x1mth2_[ind] * cos2u;
+    su -= 0.25 * temp2 * x7thm1_[ind] * sin2u;
+    const double xnode = nodem + 1.5 * temp2 * cosim * sin2u;
+    const double xinc = inclo_[ind] + 1.5 * temp2 * cosim * sinim * cos2u;
+    const double mvt = rdotl - nm * temp1 * x1mth2_[ind] * sin2u / SGP4_xke;
+    const double rvdot =
+        rvdotl +
+        nm * temp1 * (x1mth2_[ind] * cos2u + 1.5 * con41_[ind]) / SGP4_xke;
+    if ((error_code == 0) && (mrt < 1.0)) {
+      error_code = 6;
+    }
+
+    // Orientation vectors
+    const double sinsu = sin(su);
+    const double cossu = cos(su);
+    const double snod = sin(xnode);
+    const double cnod = cos(xnode);
+    const double sini = sin(xinc);
+    const double cosi = cos(xinc);
+    const double xmx = -snod * cosi;
+    const double xmy = cnod * cosi;
+    const std::array<double, 3> u_vec = {xmx * sinsu + cnod * cossu,
+                                         xmy * sinsu + snod * cossu,
+                                         sini * sinsu};
+    const std::array<double, 3> v_vec = {xmx * cossu - cnod * sinsu,
+                                         xmy * cossu - snod * sinsu,
+                                         sini * cossu};
+    // Earth radii to m, and Earth radii/min to m/s
+    for (size_t component = 0; component < 3; component++) {
+      output_TEME_positions[output_index][component] =
+          mrt * u_vec[component] * SGP4_earth_radius * 1000.0;
+      output_TEME_velocities[output_index][component] =
+          (mvt * u_vec[component] + rvdot * v_vec[component]) * vkmpersec *
+          1000.0;
+    }
+    output_error_codes[output_index] = error_code;
+  }
+}
+
+int SGP4Propagator::propagate_element_set(
+    const size_t input_index, const double input_time,
+    std::array<double, 3>& output_TEME_position,
+    std::array<double, 3>& output_TEME_velocity) const {
+  if (input_index >= element_sets_.size()) {
+    throw std::invalid_argument("No TLE with index " +
+                                std::to_string(input_index));
+  }
+  int error_code = 0;
+  propagate_range(input_index, input_index + 1, &input_time,
+                  &output_TEME_position, &output_TEME_velocity, &error_code);
+  return error_code;
+}
+
+void SGP4Propagator::propagate(
+    const std::vector<double>& input_times,
+    std::vector<std::array<double, 3>>& output_TEME_positions,
+    std::vector<std::array<double, 3>>& output_TEME_velocities,
+    std::vector<int>& output_error_codes) const {
+  if (input_times.size() != element_sets_.size()) {
+    throw std::invalid_argument(
+        "SGP4 propagation needs one time per element set");
+  }
+  output_TEME_positions.resize(element_sets_.size());
+  output_TEME_velocities.resize(element_sets_.size());
+  output_error_codes.resize(element_sets_.size());
+  propagate_range(0, element_sets_.size(), input_times.data(),
+                  output_TEME_positions.data(),
+                  output_TEME_velocities.data(), output_error_codes.data());
+}
@@ -0,0 +1,290 @@
+#include "thrust_curve.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Satellite.h"
+#include "binary_io.h"
+
+// Objective: slopes at the knots for a monotone cubic Hermite interpolant
+// (PCHIP), which keeps the interpolant within the range of neighboring knot
+// values
+std::vector<double> calculate_monotone_knot_slopes(
+    const std::vector<double>& input_times,
+    const std::vector<double>& input_values) {
+  // Ref: Fritsch & Carlson, Monotone Piecewise Cubic Interpolation (1980),
+  // with the weighted harmonic mean slopes and one-sided end conditions of
+  // https://en.wikipedia.org/wiki/Monotone_cubic_interpolation and MATLAB's
+  // pchip
+  const size_t num_knots = input_times.size();
+  std::vector<double> interval_lengths(num_knots - 1);
+  std::vector<double> secant_slopes(num_knots - 1);
+  for (size_t ind = 0; ind < num_knots - 1; ind++) {
+    interval_lengths.at(ind) = input_times.at(ind + 1) - input_times.at(ind);
+    secant_slopes.at(ind) = (input_values.at(ind + 1) - input_values.at(ind)) /
+                            interval_lengths.at(ind);
+  }
+
+  std::vector<double> knot_slopes(num_knots, 0.0);
+  if (num_knots == 2) {
+    knot_slopes.at(0) = secant_slopes.at(0);
+    knot_slopes.at(1) = secant_slopes.at(0);
+    return knot_slopes;
+  }
+
+  for (size_t ind = 1; ind < num_knots - 1; ind++) {
+    double previous_slope = secant_slopes.at(ind - 1);
+    double next_slope = secant_slopes.at(ind);
+    if (previous_slope * next_slope <= 0) {
+      // Local extremum (or flat section): zero slope avoids overshoot
+      continue;
+    }
+    double w_1 = 2 * interval_lengths.at(ind) + interval_lengths.at(ind - 1);
+    double w_2 = interval_lengths.at(ind) + 2 * interval_lengths.at(ind - 1);
+    knot_slopes.at(ind) =
+        (w_1 + w_2) / (w_1 / previous_slope + w_2 / next_slope);
+  }
+
+  // One-sided, shape-preserving end slopes
+  auto calculate_end_slope = [](const double h_0, const double h_1,
+                                const double delta_0, const double delta_1) {
+    double slope = ((2 * h_0 + h_1) * delta_0 - h_0 * delta_1) / (h_0 + h_1);
+    if (slope * delta_0 <= 0) {
+      return 0.0;
+    }
+    if ((delta_0 * delta_1 <= 0) && (fabs(slope) > fabs(3 * delta_0))) {
+      return 3 * delta_0;
+    }
+    return slope;
+  };
+  knot_slopes.at(0) =
+      calculate_end_slope(interval_lengths.at(0), interval_lengths.at(1),
+                          secant_slopes.at(0), secant_slopes.at(1));
+  knot_slopes.at(num_knots - 1) = calculate_end_slope(
+      interval_lengths.at(num_knots - 2), interval_lengths.at(num_knots - 3),
+      secant_slopes.at(num_knots - 2), secant_slopes.at(num_knots - 3));
+  return knot_slopes;
+}
+
+// Objective: convert the knots into one cubic polynomial per segment for each
+// of the magnitude and direction components
+void ThrustCurveLVLH::build_segments(
+    const std::vector<double>& input_times,
+    const std::vector<std::array<double, 4>>& input_values,
+    const std::string input_interpolation) {
+  const size_t num_knots = input_times.size();
+  segment_list_.assign(num_knots - 1, {});
+  for (size_t ind = 0; ind < num_knots - 1; ind++) {
+    segment_list_.at(ind).t_start = input_times.at(ind);
+    segment_list_.at(ind).t_end = input_times.at(ind + 1);
+  }
+
+  for (size_t comp = 0; comp < 4; comp++) {
+    std::vector<double> component_values(num_knots);
+    for (size_t ind = 0; ind < num_knots; ind++) {
+      component_values.at(ind) = input_values.at(ind).at(comp);
+    }
+    std::vector<double> knot_slopes;
+    if (input_interpolation == "Cubic") {
+      knot_slopes =
+          calculate_monotone_knot_slopes(input_times, component_values);
+    }
+
+    for (size_t ind = 0; ind < num_knots - 1; ind++) {
+      double h = input_times.at(ind + 1) - input_times.at(ind);
+      double y_0 = component_values.at(ind);
+      double y_1 = component_values.at(ind + 1);
+      double secant_slope = (y_1 - y_0) / h;
+      std::array<double, 4>& coefficients =
+          segment_list_.at(ind).coefficients.at(comp);
+      coefficients = {y_0, secant_slope, 0, 0};
+      if (input_interpolation == "Cubic") {
+        // Cubic Hermite segment, ref:
+        // https://en.wikipedia.org/wiki/Cubic_Hermite_spline
+        double d_0 = knot_slopes.at(ind);
+        double d_1 = knot_slopes.at(ind + 1);
+        coefficients.at(1) = d_0;
+        coefficients.at(2) = (3 * secant_slope - 2 * d_0 - d_1) / h;
+        coefficients.at(3) = (d_0 + d_1 - 2 * secant_slope) / (h * h);
+      }
+    }
+  }
+}
+
+ThrustCurveLVLH::ThrustCurveLVLH(
+    const std::vector<double>& input_times,
+    const std::vector<double>& input_thrust_magnitudes,
+    const std::vector<std::array<double, 3>>& input_directions,
+    const std::string input_interpolation, const double input_Isp) {
+  if (input_times.size() < 2) {
+    throw std::invalid_argument("Thrust curves need at least 2 knots");
+  }
+  if ((input_thrust_magnitudes.size() != input_times.size()) ||
+      ((input_directions.size() != input_times.size()) &&
+       (input_directions.size() != 1))) {
+    throw std::invalid_argument(
+        "Thrust curve times, magnitudes and directions must have matching "
+        "lengths");
+  }
+  if ((input_interpolation != "Linear") && (input_interpolation != "Cubic")) {
+    throw std::invalid_argument(
+        "Thrust curve interpolation must be \"Linear\" or \"Cubic\"");
+  }
+  std::vector<std::array<double, 4>> knot_values(input_times.size());
+  for (size_t ind = 0; ind < input_times.size(); ind++) {
+    if ((ind > 0) && (input_times.at(ind) <= input_times.at(ind - 1))) {
+      throw std::invalid_argument(
+          "Thrust curve knot times must be strictly increasing");
+    }
+    if (input_thrust_magnitudes.at(ind) < 0) {
+      throw std::invalid_argument(
+          "Thrust curve magnitudes must be nonnegative");
+    }
+    const std::array<double, 3>& direction =
+        input_directions.at((input_directions.size() == 1) ? 0 : ind);
+    double direction_norm =
+        sqrt(direction.at(0) * direction.at(0) +
+             direction.at(1) * direction.at(1) +
+             direction.at(2) * direction.at(2));
+    if (direction_norm == 0) {
+      throw std::invalid_argument("Thrust curve directions must be nonzero");
+    }
+    knot_values.at(ind) = {input_thrust_magnitudes.at(ind),
+                           direction.at(0) / direction_norm,
+                           direction.at(1) / direction_norm,
+                           direction.at(2) / direction_norm};
+  }
+  Isp_ = input_Isp;
+  build_segments(input_times, knot_values, input_interpolation);
+}
+
+ThrustCurveLVLH::ThrustCurveLVLH(std::istream& input_checkpoint_stream) {
+  segment_list_ = read_binary_vector<CubicSegment>(input_checkpoint_stream);
+  Isp_ = read_binary_value<double>(input_checkpoint_stream);
+  if (segment_list_.size() < 1) {
+    throw std::invalid_argument("Checkpointed thrust curve has no segments");
+  }
+}
+
+void ThrustCurveLVLH::write_checkpoint(std::ostream& output_stream) const {
+  write_binary_vector(output_stream, segment_list_);
+  write_binary_value(output_stream, Isp_);
+}
+
+std::array<double, 4> ThrustCurveLVLH::evaluate(const double input_time) {
+  std::array<double, 4> output_values = {0, 0, 0, 0};
+  if ((input_time < segment_list_.front().t_start) ||
+      (input_time > segment_list_.back().t_end)) {
+    return output_values;
+  }
+  while ((cursor_ + 1 < segment_list_.size()) &&
+         (input_time >= segment_list_.at(cursor_).t_end)) {
+    cursor_++;
+  }
+  while ((cursor_ > 0) && (input_time < segment_list_.at(cursor_).t_start)) {
+    cursor_--;
+  }
+  const CubicSegment& segment = segment_list_.at(cursor_);
+  double s = input_time - segment.t_start;
+  for (size_t comp = 0; comp < 4; comp++) {
+    const std::array<double, 4>& c = segment.coefficients.at(comp);
+    output_values.at(comp) =
+        ((c.at(3) * s + c.at(2)) * s + c.at(1)) * s + c.at(0);
+  }
+  return output_values;
+}
+
+std::array<double, 3> ThrustCurveLVLH::get_LVLH_force(const double input_time) {
+  std::array<double, 4> values = evaluate(input_time);
+  std::array<double, 3> LVLH_force_vec = {0, 0, 0};
+  double direction_norm = sqrt(values.at(1) * values.at(1) +
+                               values.at(2) * values.at(2) +
+                               values.at(3) * values.at(3));
+  if ((values.at(0) <= 0) || (direction_norm == 0)) {
+    return LVLH_force_vec;
+  }
+  for (size_t ind = 0; ind < 3; ind++) {
+    LVLH_force_vec.at(ind) = values.at(0) * values.at(ind + 1) / direction_norm;
+  }
+  return LVLH_force_vec;
+}
+
+double ThrustCurveLVLH::get_mass_flow_rate(const double input_time) {
+  if (Isp_ <= 0) {
+    return 0;
+  }
+  double thrust_magnitude = std::max(0.0, evaluate(input_time).at(0));
+  return thrust_magnitude / (Isp_ * standard_gravity);
+}
+
+ThrustCurveLVLH load_thrust_curve_JSON(const std::string input_file_name) {
+  std::ifstream input_filestream(input_file_name);
+  json input_data = json::parse(input_filestream);
+
+  std::vector<double> times = input_data.at("Time");
+  std::vector<double> thrust_magnitudes = input_data.at("Thrust");
+  std::vector<std::array<double, 3>> directions = {};
+  if (input_data.at("Direction").at(0).is_array()) {
+    directions =
+        input_data.at("Direction").get<std::vector<std::array<double, 3>>>();
+  } else {
+    directions.push_back(
+        input_data.at("Direction").get<std::array<double, 3>>());
+  }
+
+  std::string interpolation = "Cubic";
+  if (input_data.find("Interpolation") != input_data.end()) {
+    interpolation = input_data.at("Interpolation");
+  }
+  double Isp = 0;
+  if (input_data.find("Isp") != input_data.end()) {
+    Isp = input_data.at("Isp");
+  }
+  return ThrustCurveLVLH(times, thrust_magnitudes, directions, interpolation,
+                         Isp);
+}
+
+ThrustCurveLVLH load_thrust_curve_CSV(const std::string input_file_name,
+                                      const std::string input_interpolation,
+                                      const double input_Isp) {
+  std::ifstream input_filestream(input_file_name);
+  if (!input_filestream) {
+    throw std::invalid_argument("Couldn't open thrust curve file " +
+                                input_file_name);
+  }
+  std::vector<double> times = {};
+  std::vector<double> thrust_magnitudes = {};
+  std::vector<std::array<double, 3>> directions = {};
+  std::string line;
+  while (std::getline(input_filestream, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    std::stringstream line_stream(line);
+    std::string field;
+    std::vector<double> row = {};
+    try {
+      while (std::getline(line_stream, field, ',')) {
+        row.push_back(std::stod(field));
+      }
+    } catch (const std::invalid_argument&) {
+      if (times.size() == 0) {
+        // Header row
+        continue;
+      }
+      throw std::invalid_argument("Couldn't parse thrust curve CSV row: " +
+                                  line);
+    }
+    if (row.size() != 5) {
+      throw std::invalid_argument(
+          "Thrust curve CSV rows must have 5 columns: " + line);
+    }
+    times.push_back(row.at(0));
+    thrust_magnitudes.push_back(row.at(1));
+    directions.push_back({row.at(2), row.at(3), row.at(4)});
+  }
+  return ThrustCurveLVLH(times, thrust_magnitudes, directions,
+                         input_interpolation, input_Isp);
+}
@@ -0,0 +1,241 @@
+#include "trajectory_branch.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "utils.h"
+
+TrajectoryBranch::TrajectoryBranch(const Satellite& input_satellite,
+                                   const double input_initial_timestep)
+    : satellite_(input_satellite) {
+  if (input_initial_timestep <= 0) {
+    throw std::invalid_argument("Initial timestep must be positive");
+  }
+  next_timestep_ = input_initial_timestep;
+  record_sample();
+}
+
+void TrajectoryBranch::record_sample() {
+  TrajectorySample sample;
+  sample.t = satellite_.get_instantaneous_time();
+  sample.ECI_position = satellite_.get_ECI_position();
+  sample.ECI_velocity = satellite_.get_ECI_velocity();
+  sample.quaternion = satellite_.get_quaternion();
+  sample.mass = satellite_.get_mass();
+  own_samples_.push_back(sample);
+  if ((get_num_samples() - 1) % checkpoint_interval_ == 0) {
+    checkpoints_.push_back({get_num_samples(), next_timestep_,
+                            std::make_shared<const Satellite>(satellite_)});
+  }
+}
+
+// Objective: drop the samples after the first input_num_samples. Shared
+// segments are never modified, so a shared segment which is only partly kept
+// is copied into this branch's own samples
+void TrajectoryBranch::truncate_samples(const size_t input_num_samples) {
+  if (input_num_samples >= num_shared_samples_) {
+    own_samples_.resize(input_num_samples - num_shared_samples_);
+    return;
+  }
+  std::vector<TrajectorySample> kept_samples = {};
+  size_t num_kept_shared_samples = 0;
+  size_t num_kept_segments = 0;
+  for (const std::shared_ptr<const std::vector<TrajectorySample>>& segment :
+       shared_segments_) {
+    if (num_kept_shared_samples + segment->size() > input_num_samples) {
+      kept_samples.assign(
+          segment->begin(),
+          segment->begin() + (input_num_samples - num_kept_shared_samples));
+      break;
+    }
+    num_kept_shared_samples += segment->size();
+    num_kept_segments++;
+  }
+  shared_segments_.resize(num_kept_segments);
+  num_shared_samples_ = num_kept_shared_samples;
+  own_samples_ = kept_samples;
+}
+
+// Objective: restore the branch to its last checkpoint before input_time (or
+// to its first checkpoint, if none are before it)
+void TrajectoryBranch::rewind_before(const double input_time) {
+  size_t checkpoint_index = 0;
+  while ((checkpoint_index + 1 < checkpoints_.size()) &&
+         (checkpoints_.at(checkpoint_index + 1)
+              .satellite->get_instantaneous_time() < input_time)) {
+    checkpoint_index++;
+  }
+  checkpoints_.erase(checkpoints_.begin() + checkpoint_index + 1,
+                     checkpoints_.end());
+  const BranchCheckpoint& checkpoint = checkpoints_.back();
+  truncate_samples(checkpoint.num_samples);
+  next_timestep_ = checkpoint.next_timestep;
+  // Keep this branch's own caches, which may not be shared with the
+  // checkpoint's (e.g., after a fork)
+  std::shared_ptr<EnvironmentCache> environment = satellite_.get_environment();
+  std::shared_ptr<GeomagneticField> geomagnetic_field =
+      satellite_.get_geomagnetic_field();
+  satellite_ = *checkpoint.satellite;
+  satellite_.set_environment(environment);
+  satellite_.set_geomagnetic_field(geomagnetic_field);
+}
+
+int TrajectoryBranch::propagate(
+    const double input_t_end, const double input_epsilon,
+    const std::vector<ForceTerm>& input_force_terms,
+    const std::pair<double, double> drag_elements) {
+  epsilon_ = input_epsilon;
+  force_terms_ = input_force_terms;
+  drag_elements_ = drag_elements;
+  while (satellite_.get_instantaneous_time() < input_t_end) {
+    // RK45 steps never exceed the step size they're given, so capping it
+    // lands exactly on input_t_end
+    double remaining_time = input_t_end - satellite_.get_instantaneous_time();
+    double timestep_to_use = std::min(next_timestep_, remaining_time);
+    std::pair<double, int> new_timestep_and_error_code =
+        satellite_.evolve_RK45(input_epsilon, timestep_to_use,
+                               input_force_terms, drag_elements);
+    if (new_timestep_and_error_code.second != 0) {
+      return new_timestep_and_error_code.second;
+    }
+    // Only a step which used the whole remaining time was cut short, and its
+    // suggested size would be biased small by the cap
+    if (timestep_to_use < remaining_time) {
+      next_timestep_ = new_timestep_and_error_code.first;
+    }
+    record_sample();
+  }
+  return 0;
+}
+
+std::vector<TrajectoryBranch> TrajectoryBranch::fork(
+    const size_t input_num_branches) {
+  // Move the samples recorded since the last fork into a shared, read-only
+  // segment
+  if (own_samples_.size() > 0) {
+    num_shared_samples_ += own_samples_.size();
+    shared_segments_.push_back(
+        std::make_shared<const std::vector<TrajectorySample>>(
+            std::move(own_samples_)));
+    own_samples_ = {};
+  }
+  std::vector<TrajectoryBranch> branches(input_num_branches, *this);
+  for (TrajectoryBranch& branch : branches) {
+    branch.satellite_.detach_shared_caches();
+  }
+  return branches;
+}
+
+int TrajectoryBranch::edit_plan(
+    const double input_earliest_affected_time,
+    const std::function<void(Satellite&)>& input_edit) {
+  const double t_reached = satellite_.get_instantaneous_time();
+  rewind_before(input_earliest_affected_time);
+  input_edit(satellite_);
+  // The retained checkpoints are all before the edit takes effect, but need
+  // the edited plan in case a later edit rewinds to them. They may be shared
+  // with other branches, so each is replaced by an edited copy
+  for (BranchCheckpoint& checkpoint : checkpoints_) {
+    Satellite edited_satellite = *checkpoint.satellite;
+    input_edit(edited_satellite);
+    checkpoint.satellite =
+        std::make_shared<const Satellite>(std::move(edited_satellite));
+  }
+  if (satellite_.get_instantaneous_time() >= t_reached) {
+    return 0;
+  }
+  return propagate(t_reached, epsilon_, force_terms_, drag_elements_);
+}
+
+int TrajectoryBranch::add_LVLH_thrust_profile(
+    const ThrustProfileLVLH input_thrust_profile) {
+  return edit_plan(input_thrust_profile.t_start_,
+                   [&input_thrust_profile](Satellite& input_satellite) {
+                     std::vector<ThrustProfileLVLH> thrust_profiles =
+                         input_satellite.get_LVLH_thrust_profiles();
+                     thrust_profiles.push_back(input_thrust_profile);
+                     input_satellite.set_LVLH_thrust_profiles(thrust_profiles);
+                   });
+}
+
+int TrajectoryBranch::set_LVLH_thrust_profiles(
+    const std::vector<ThrustProfileLVLH>& input_thrust_profiles) {
+  // The earliest affected time is the earliest start of a profile which is
+  // only in one of the old and new plans
+  std::vector<ThrustProfileLVLH> old_thrust_profiles =
+      satellite_.get_LVLH_thrust_profiles();
+  double earliest_affected_time = INFINITY;
+  for (ThrustProfileLVLH old_profile : old_thrust_profiles) {
+    if (std::find(input_thrust_profiles.begin(), input_thrust_profiles.end(),
+                  old_profile) == input_thrust_profiles.end()) {
+      earliest_affected_time =
+          std::min(earliest_affected_time, old_profile.t_start_);
+    }
+  }
+  for (ThrustProfileLVLH new_profile : input_thrust_profiles) {
+    if (std::find(old_thrust_profiles.begin(), old_thrust_profiles.end(),
+                  new_profile) == old_thrust_profiles.end()) {
+      earliest_affected_time =
+          std::min(earliest_affected_time, new_profile.t_start_);
+    }
+  }
+  if (earliest_affected_time == INFINITY) {
+    // Same profiles, possibly reordered
+    return 0;
+  }
+  return edit_plan(earliest_affected_time,
+                   [&input_thrust_profiles](Satellite& input_satellite) {
+                     input_satellite.set_LVLH_thrust_profiles(
+                         input_thrust_profiles);
+                   });
+}
+
+void TrajectoryBranch::set_checkpoint_interval(
+    const size_t input_checkpoint_interval) {
+  if (input_checkpoint_interval < 1) {
+    throw std::invalid_argument("Checkpoint interval must be at least 1");
+  }
+  checkpoint_interval_ = input_checkpoint_interval;
+}
+
+const TrajectorySample& TrajectoryBranch::get_sample(
+    const size_t input_index) const {
+  size_t index_in_segment = input_index;
+  for (const std::shared_ptr<const std::vector<TrajectorySample>>& segment :
+       shared_segments_) {
+    if (index_in_segment < segment->size()) {
+      return (*segment)[index_in_segment];
+    }
+    index_in_segment -= segment->size();
+  }
+  return own_samples_.at(index_in_segment);
+}
+
+std::vector<TrajectorySample> TrajectoryBranch::get_trajectory() const {
+  std::vector<TrajectorySample> trajectory = {};
+  trajectory.reserve(get_num_samples());
+  for (const std::shared_ptr<const std::vector<TrajectorySample>>& segment :
+       shared_segments_) {
+    trajectory.insert(trajectory.end(), segment->begin(), segment->end());
+  }
+  trajectory.insert(trajectory.end(), own_samples_.begin(),
+                    own_samples_.end());
+  return trajectory;
+}
+
+std::vector<int> propagate_branches(
+    std::vector<TrajectoryBranch>& input_branches, const double input_t_end,
+    const double input_epsilon,
+    const std::vector<ForceTerm>& input_force_terms,
+    const std::pair<double, double> drag_elements,
+    const size_t input_num_threads) {
+  std::vector<int> error_codes(input_branches.size(), 0);
+  run_in_parallel(input_branches.size(), input_num_threads,
+                  [&](const size_t input_branch_index) {
+                    error_codes.at(input_branch_index) =
+                        input_branches.at(input_branch_index)
+                            .propagate(input_t_end, input_epsilon,
+                                       input_force_terms, drag_elements);
+                  });
+  return error_codes;
+}
@@ -1,9 +1,14 @@
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
+#include <atomic>
 #include <cmath>
+#include <exception>
 #include <iostream>
+#include <thread>
 
 #include "Satellite.h"
+#include "ephemeris.h"
+#include "utils.h"
 
 using Eigen::Matrix3d;
 using Eigen::Matrix4d;
@@ -199,33 +204,130 @@ std::array<double, 3> convert_cylindrical_to_cartesian(
   return output_cartesian_vec;
 }
 
-std::array<double, 3> calculate_orbital_acceleration(
-    const std::array<double, 3> input_r_vec, const double input_spacecraft_mass,
-    const std::vector<ThrustProfileLVLH> input_list_of_thrust_profiles_LVLH,
-    const double input_evaluation_time,
-    const std::array<double, 3> input_velocity_vec,
-    const double input_inclination, const double input_arg_of_periapsis,
-    const double input_true_anomaly, const double input_F_10,
-    const double input_A_p, const double input_A_s,
-    const double input_satellite_mass, const bool perturbation,
-    const bool atmospheric_drag) {
-  // Note: this is the version used in the RK45 solver (this has a more updated
-  // workflow) orbital acceleration = -G m_Earth/distance^3 * r_vec (just based
-  // on rearranging F=ma with a the acceleration due to gravitational attraction
+// Objective: calculate the perturbing acceleration on the satellite (relative
+// to the Earth) due to the gravitational attraction of a third body
+std::array<double, 3> calculate_third_body_acceleration(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_third_body_position_vec,
+    const double input_third_body_mu) {
+  // Ref: Montenbruck & Gill, Satellite Orbits, eq. 3.37. The second term is
+  // the indirect acceleration of the Earth itself towards the third body
+  std::array<double, 3> satellite_to_body_vec = {0, 0, 0};
+  for (size_t ind = 0; ind < 3; ind++) {
+    satellite_to_body_vec.at(ind) =
+        input_third_body_position_vec.at(ind) - input_r_vec.at(ind);
+  }
+  const double satellite_to_body_distance =
+      sqrt(satellite_to_body_vec.at(0) * satellite_to_body_vec.at(0) +
+           satellite_to_body_vec.at(1) * satellite_to_body_vec.at(1) +
+           satellite_to_body_vec.at(2) * satellite_to_body_vec.at(2));
+  const double earth_to_body_distance =
+      sqrt(input_third_body_position_vec.at(0) *
+               input_third_body_position_vec.at(0) +
+           input_third_body_position_vec.at(1) *
+               input_third_body_position_vec.at(1) +
+           input_third_body_position_vec.at(2) *
+               input_third_body_position_vec.at(2));
+  const double direct_factor =
+      input_third_body_mu / pow(satellite_to_body_distance, 3);
+  const double indirect_factor =
+      input_third_body_mu / pow(earth_to_body_distance, 3);
+
+  std::array<double, 3> third_body_acceleration_vec = {0, 0, 0};
+  for (size_t ind = 0; ind < 3; ind++) {
+    third_body_acceleration_vec.at(ind) =
+        direct_factor * satellite_to_body_vec.at(ind) -
+        indirect_factor * input_third_body_position_vec.at(ind);
+  }
+  return third_body_acceleration_vec;
+}
+
+// Objective: calculate the fraction of the solar disk visible from the
+// satellite (1 in sunlight, 0 in umbra)
+double calculate_shadow_function(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_sun_position_vec) {
+  // Conical shadow geometry from Montenbruck & Gill, Satellite Orbits, section
+  // 3.4.2: a is the apparent radius of the Sun, b the apparent radius of the
+  // Earth, and c the apparent separation of their centers, all seen from the
+  // satellite. Rather than the exact occulted-area fraction (whose derivative
+  // jumps at the penumbra boundaries), the penumbra transition is smoothed
+  // with a tanh in the normalized separation x=(c-b)/a, so the adaptive
+  // stepper doesn't have to resolve kinks at every shadow entry and exit.
+  // x=0 (Sun center on the Earth's limb) gives half the disk visible, as in
+  // the exact model
+  Vector3d r_vec = {input_r_vec.at(0), input_r_vec.at(1), input_r_vec.at(2)};
+  Vector3d sun_vec = {input_sun_position_vec.at(0),
+                      input_sun_position_vec.at(1),
+                      input_sun_position_vec.at(2)};
+  Vector3d satellite_to_sun_vec = sun_vec - r_vec;
+  double satellite_to_sun_distance = satellite_to_sun_vec.norm();
+  double r = r_vec.norm();
+
+  double a = asin(radius_Sun / satellite_to_sun_distance);
+  double b = asin(radius_Earth / r);
+  double c = acos((-r_vec).dot(satellite_to_sun_vec) /
+                  (r * satellite_to_sun_distance));
+
+  // Steepness of the smoothed transition; tanh(3) ~ 0.995, so the smoothed
+  // shadow function is within 0.5% of the exact one outside the penumbra
+  const double smoothing_steepness = 3.0;
+  double x = (c - b) / a;
+  // Minimum visible fraction (nonzero only if the Sun's disk appears larger
+  // than the Earth's, i.e., annular eclipses far from the Earth)
+  double minimum_visible_fraction = std::max(0.0, 1.0 - (b * b) / (a * a));
+  double visible_fraction =
+      minimum_visible_fraction + (1 - minimum_visible_fraction) * 0.5 *
+                                     (1 + tanh(smoothing_steepness * x));
+  return visible_fraction;
+}
+
+// Objective: calculate the acceleration on the satellite due to solar
+// radiation pressure, including Earth shadowing
+std::array<double, 3> calculate_solar_radiation_pressure_acceleration(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_sun_position_vec,
+    const double input_A_srp, const double input_C_R,
+    const double input_satellite_mass) {
+  // Cannonball model, ref: Montenbruck & Gill, Satellite Orbits, eq. 3.75.
+  // Acts along the Sun-to-satellite direction, scaled with the inverse square
+  // of the distance to the Sun
+  std::array<double, 3> sun_to_satellite_vec = {0, 0, 0};
+  for (size_t ind = 0; ind < 3; ind++) {
+    sun_to_satellite_vec.at(ind) =
+        input_r_vec.at(ind) - input_sun_position_vec.at(ind);
+  }
+  double sun_to_satellite_distance =
+      sqrt(sun_to_satellite_vec.at(0) * sun_to_satellite_vec.at(0) +
+           sun_to_satellite_vec.at(1) * sun_to_satellite_vec.at(1) +
+           sun_to_satellite_vec.at(2) * sun_to_satellite_vec.at(2));
+  double visible_fraction =
+      calculate_shadow_function(input_r_vec, input_sun_position_vec);
+  double srp_acceleration_magnitude =
+      visible_fraction * solar_radiation_pressure_1AU * input_C_R *
+      (input_A_srp / input_satellite_mass) *
+      pow(astronomical_unit / sun_to_satellite_distance, 2);
+
+  std::array<double, 3> srp_acceleration_vec = {0, 0, 0};
+  for (size_t ind = 0; ind < 3; ind++) {
+    srp_acceleration_vec.at(ind) = srp_acceleration_magnitude *
+                                   sun_to_satellite_vec.at(ind) /
+                                   sun_to_satellite_distance;
+  }
+  return srp_acceleration_vec;
+}
+
+// Objective: calculate the acceleration on the satellite due to the Earth's
+// gravity, treating the Earth as a point mass
+std::array<double, 3> calculate_central_body_acceleration(
+    const std::array<double, 3> input_r_vec) {
+  // orbital acceleration = -G m_Earth/distance^3 * r_vec (just based on
+  // rearranging F=ma with a the acceleration due to gravitational attraction
   // between satellite and Earth
   // https://en.wikipedia.org/wiki/Newton%27s_law_of_universal_gravitation)
   // going to be assuming Earth's position doesn't change for now
-  // also assuming Earth is spherical, can loosen this assumption in the future
-  // note: this is in ECI frame (r_vec and velocity vec should also be in ECI
-  // frame)
-
-  std::array<double, 3> acceleration_vec_due_to_gravity =
-      input_r_vec;  // shouldn't need to explicitly call copy function because
-                    // input_r_vec is passed by value not ref
-
-  // F=ma
-  // a=F/m = (F_grav + F_ext)/m = (F_grav/m) + (F_ext/m) = -G*M_Earth/distance^3
-  // + ...
+  // note: this is in ECI frame
+  std::array<double, 3> acceleration_vec_due_to_gravity = input_r_vec;
 
   const double distance = sqrt(input_r_vec.at(0) * input_r_vec.at(0) +
                                input_r_vec.at(1) * input_r_vec.at(1) +
@@ -235,139 +337,227 @@ std::array<double, 3> calculate_orbital_acceleration(
   for (size_t ind = 0; ind < input_r_vec.size(); ind++) {
     acceleration_vec_due_to_gravity.at(ind) *= overall_factor;
   }
+  return acceleration_vec_due_to_gravity;
+}
 
-  std::array<double, 3> acceleration_vec = acceleration_vec_due_to_gravity;
+// Objective: calculate the perturbing acceleration on the satellite due to the
+// Earth's oblateness (J2 term)
+std::array<double, 3> calculate_J2_acceleration(
+    const std::array<double, 3> input_r_vec, const double input_inclination,
+    const double input_arg_of_periapsis, const double input_true_anomaly) {
+  // Ref:
+  // https://vatankhahghadim.github.io/AER506/Notes/6%20-%20Orbital%20Perturbations.pdf
+  const double distance = sqrt(input_r_vec.at(0) * input_r_vec.at(0) +
+                               input_r_vec.at(1) * input_r_vec.at(1) +
+                               input_r_vec.at(2) * input_r_vec.at(2));
+  double J2 = J2_Earth;
+  double mu = G * mass_Earth;
+  double C = 3 * mu * J2 * radius_Earth * radius_Earth / (2 * pow(distance, 4));
+  double x = input_r_vec.at(0);
+  double y = input_r_vec.at(1);
+  double rho = sqrt(pow(x, 2) + pow(y, 2));
+  double theta;
+  // Ref:
+  // https://en.wikipedia.org/wiki/Cylindrical_coordinate_system#Line_and_volume_elements
+  if (x >= 0) {
+    theta = asin(y / rho);  // Note: here setting theta=0 even if both x and y
+                            // are zero, whereas it should technically be
+                            // indeterminate, but I'm going to assume this edge
+                            // condition won't be hit and I don't want
+                            // undefined behavior
+  } else {
+    if (y >= 0) {
+      theta = -asin(y / rho) + M_PI;
+    } else {
+      theta = -asin(y / rho) - M_PI;
+    }
+  }
 
-  // now add effects from externally-applied forces, e.g., thrusters, if any
+  double a_r =
+      C * (3 * pow(sin(input_inclination), 2) *
+               pow(sin(input_arg_of_periapsis + input_true_anomaly), 2) -
+           1);
+  double a_theta = -C * pow(sin(input_inclination), 2) *
+                   sin(2 * (input_arg_of_periapsis + input_true_anomaly));
+  double a_z = -C * sin(2 * input_inclination) *
+               sin(input_arg_of_periapsis + input_true_anomaly);
+  return convert_cylindrical_to_cartesian(a_r, a_theta, a_z, theta);
+}
 
-  std::vector<std::array<double, 3>> list_of_LVLH_forces_at_evaluation_time =
-      {};
-  std::vector<std::array<double, 3>> list_of_ECI_forces_at_evaluation_time = {};
-
-  for (const ThrustProfileLVLH thrust_profile :
-       input_list_of_thrust_profiles_LVLH) {
-    if ((input_evaluation_time >= thrust_profile.t_start_) &&
-        (input_evaluation_time <= thrust_profile.t_end_)) {
-      list_of_LVLH_forces_at_evaluation_time.push_back(
-          thrust_profile.LVLH_force_vec_);
-      std::array<double, 3> ECI_thrust_vector = convert_LVLH_to_ECI_manual(
-          thrust_profile.LVLH_force_vec_, input_r_vec, input_velocity_vec);
-      list_of_ECI_forces_at_evaluation_time.push_back(ECI_thrust_vector);
-    }
+// Objective: calculate the acceleration on the satellite due to atmospheric
+// drag. Zero outside of the 140-400 km altitude range covered by the density
+// model
+std::array<double, 3> calculate_atmospheric_drag_acceleration(
+    const std::array<double, 3> input_r_vec,
+    const std::array<double, 3> input_velocity_vec, const double input_F_10,
+    const double input_A_p, const double input_A_s,
+    const double input_satellite_mass) {
+  std::array<double, 3> drag_acceleration_vec = {0.0, 0.0, 0.0};
+  const double distance = sqrt(input_r_vec.at(0) * input_r_vec.at(0) +
+                               input_r_vec.at(1) * input_r_vec.at(1) +
+                               input_r_vec.at(2) * input_r_vec.at(2));
+  double altitude = (distance - radius_Earth) / 1000;  // km
+  if ((altitude < 140) || (altitude > 400)) {
+    return drag_acceleration_vec;
   }
 
-  for (std::array<double, 3> external_force_vec_in_ECI :
-       list_of_ECI_forces_at_evaluation_time) {
-    acceleration_vec.at(0) +=
-        (external_force_vec_in_ECI.at(0) / input_spacecraft_mass);
-    acceleration_vec.at(1) +=
-        (external_force_vec_in_ECI.at(1) / input_spacecraft_mass);
-    acceleration_vec.at(2) +=
-        (external_force_vec_in_ECI.at(2) / input_spacecraft_mass);
+  // Refs: https://angeo.copernicus.org/articles/39/397/2021/
+  // https://www.spaceacademy.net.au/watch/debris/atmosmod.htm
+  double speed = sqrt(pow(input_velocity_vec.at(0), 2) +
+                      pow(input_velocity_vec.at(1), 2) +
+                      pow(input_velocity_vec.at(2), 2));
+  // First, esimate atmospheric density
+  double rho = {0};
+  if (altitude < 180) {
+    double a0 = 7.001985 * pow(10, -2);
+    double a1 = -4.336216 * pow(10, -3);
+    double a2 = -5.009831 * pow(10, -3);
+    double a3 = 1.621827 * pow(10, -4);
+    double a4 = -2.471283 * pow(10, -6);
+    double a5 = 1.904383 * pow(10, -8);
+    double a6 = -7.189421 * pow(10, -11);
+    double a7 = 1.060067 * pow(10, -13);
+    double fit_val =
+        ((((((a7 * altitude + a6) * altitude + a4) * altitude + a3) *
+           altitude) +
+          a2) *
+             altitude +
+         a1) *
+            altitude +
+        a0;
+    rho = pow(10, fit_val);
+  } else {
+    double T = 900 + 2.5 * (input_F_10 - 70) + 1.5 * input_A_p;
+    double new_mu = 27 - 0.012 * (altitude - 200);
+    double H = T / new_mu;
+    rho = 6 * pow(10, -10) * exp(-(altitude - 175) / H);
+  }
+
+  // Now estimate the satellite's ballistic coefficient B
+  double C_d = 2.2;
+  double B = C_d * input_A_s / input_satellite_mass;
+  double drag_deceleration = (1.0 / 2.0) * rho * B * pow(speed, 2);
+  // Should act in direction directly opposite to velocity
+  for (size_t ind = 0; ind < 3; ind++) {
+    drag_acceleration_vec.at(ind) =
+        drag_deceleration * (-1) * (input_velocity_vec.at(ind) / speed);
+    // Factor of (-1) because this acceleration acts in direction opposite to
+    // velocity
   }
+  return drag_acceleration_vec;
+}
 
+// Objective: translate the older on/off flags for the optional force terms
+// into a list of force terms. The central body and thrust terms are always
+// included
+std::vector<ForceTerm> force_terms_from_flags(
+    const bool perturbation, const bool atmospheric_drag, const bool third_body,
+    const bool solar_radiation_pressure) {
+  std::vector<ForceTerm> force_terms = {ForceTerm::central_body,
+                                        ForceTerm::thrust};
   if (perturbation) {
-    // If accounting for J2 perturbation
-
-    // Now let's add the additional acceleration components due to the J2
-    // perturbation Ref:
-    // https://vatankhahghadim.github.io/AER506/Notes/6%20-%20Orbital%20Perturbations.pdf
-    double J2 = 1.083 * pow(10, -3);
-    double mu = G * mass_Earth;
-    double C =
-        3 * mu * J2 * radius_Earth * radius_Earth / (2 * pow(distance, 4));
-    double x = input_r_vec.at(0);
-    double y = input_r_vec.at(1);
-    double rho = sqrt(pow(x, 2) + pow(y, 2));
-    double theta;
-    // Ref:
-    // https://en.wikipedia.org/wiki/Cylindrical_coordinate_system#Line_and_volume_elements
-    if (x >= 0) {
-      theta = asin(
-          y / rho);  // Note: here setting theta=0 even if both x and y are
-                     // zero, whereas it should technically be indeterminate,
-                     // but I'm going to assume this edge condition won't be hit
-                     // and I don't want undefined behavior
-    } else {
-      if (y >= 0) {
-        theta = -asin(y / rho) + M_PI;
-      } else {
-        theta = -asin(y / rho) - M_PI;
+    force_terms.push_back(ForceTerm::J2);
+  }
+  if (atmospheric_drag) {
+    force_terms.push_back(ForceTerm::atmospheric_drag);
+  }
+  if (third_body) {
+    force_terms.push_back(ForceTerm::third_body);
+  }
+  if (solar_radiation_pressure) {
+    force_terms.push_back(ForceTerm::solar_radiation_pressure);
+  }
+  return force_terms;
+}
+
+// Objective: point satellites with the same epoch (and Earth orientation
+// settings) at a single EnvironmentCache, so that time-dependent quantities
+// are computed once for all of them rather than once per satellite
+void share_environment(std::vector<Satellite>& input_satellite_vector) {
+  std::vector<std::shared_ptr<EnvironmentCache>> distinct_environments = {};
+  for (Satellite& current_satellite : input_satellite_vector) {
+    std::shared_ptr<EnvironmentCache> environment =
+        current_satellite.get_environment();
+    if (environment->has_space_weather()) {
+      // Keep satellite-specific space weather windows
+      continue;
+    }
+    bool found_match = false;
+    for (std::shared_ptr<EnvironmentCache>& distinct_environment :
+         distinct_environments) {
+      if ((distinct_environment->get_epoch_julian_date() ==
+           environment->get_epoch_julian_date()) &&
+          (distinct_environment->get_earth_orientation()
+               ->get_include_precession_nutation() ==
+           environment->get_earth_orientation()
+               ->get_include_precession_nutation())) {
+        current_satellite.set_environment(distinct_environment);
+        found_match = true;
+        break;
       }
     }
-
-    double a_r =
-        C * (3 * pow(sin(input_inclination), 2) *
-                 pow(sin(input_arg_of_periapsis + input_true_anomaly), 2) -
-             1);
-    double a_theta = -C * pow(sin(input_inclination), 2) *
-                     sin(2 * (input_arg_of_periapsis + input_true_anomaly));
-    double a_z = -C * sin(2 * input_inclination) *
-                 sin(input_arg_of_periapsis + input_true_anomaly);
-    std::array<double, 3> cartesian_acceleration_components =
-        convert_cylindrical_to_cartesian(a_r, a_theta, a_z, theta);
-
-    for (size_t ind = 0; ind < 3; ind++) {
-      acceleration_vec.at(ind) += cartesian_acceleration_components.at(ind);
+    if (!found_match) {
+      distinct_environments.push_back(environment);
     }
   }
-  double altitude = (distance - radius_Earth) / 1000;  // km
+}
 
-  if ((atmospheric_drag) && (altitude >= 140) && (altitude <= 400)) {
-    // Refs: https://angeo.copernicus.org/articles/39/397/2021/
-    // https://www.spaceacademy.net.au/watch/debris/atmosmod.htm
-    double speed = sqrt(pow(input_velocity_vec.at(0), 2) +
-                        pow(input_velocity_vec.at(1), 2) +
-                        pow(input_velocity_vec.at(2), 2));
-    // First, esimate atmospheric density
-    double rho = {0};
-    if (altitude < 180) {
-      double a0 = 7.001985 * pow(10, -2);
-      double a1 = -4.336216 * pow(10, -3);
-      double a2 = -5.009831 * pow(10, -3);
-      double a3 = 1.621827 * pow(10, -4);
-      double a4 = -2.471283 * pow(10, -6);
-      double a5 = 1.904383 * pow(10, -8);
-      double a6 = -7.189421 * pow(10, -11);
-      double a7 = 1.060067 * pow(10, -13);
-      double fit_val =
-          ((((((a7 * altitude + a6) * altitude + a4) * altitude + a3) *
-             altitude) +
-            a2) *
-               altitude +
-           a1) *
-              altitude +
-          a0;
-      rho = pow(10, fit_val);
-    } else {
-      double T = 900 + 2.5 * (input_F_10 - 70) + 1.5 * input_A_p;
-      double new_mu = 27 - 0.012 * (altitude - 200);
-      double H = T / new_mu;
-      rho = 6 * pow(10, -10) * exp(-(altitude - 175) / H);
+void share_SGP4_propagator(std::vector<Satellite>& input_satellite_vector) {
+  std::vector<TwoLineElementSet> element_sets = {};
+  for (Satellite& current_satellite : input_satellite_vector) {
+    std::shared_ptr<const SGP4Propagator> SGP4_propagator =
+        current_satellite.get_SGP4_propagator();
+    if (SGP4_propagator) {
+      element_sets.push_back(SGP4_propagator->get_element_set(
+          current_satellite.get_SGP4_element_set_index()));
     }
-
-    // Now estimate the satellite's ballistic coefficient B
-    double C_d = 2.2;
-    double B = C_d * input_A_s / input_satellite_mass;
-    double drag_deceleration = (1.0 / 2.0) * rho * B * pow(speed, 2);
-    // Should act in direction directly opposite to velocity
-    std::array<double, 3> velocity_unit_vec = {0.0, 0.0, 0.0};
-    for (size_t ind = 0; ind < 3; ind++) {
-      velocity_unit_vec.at(ind) = input_velocity_vec.at(ind) / speed;
+  }
+  if (element_sets.size() == 0) {
+    return;
+  }
+  std::shared_ptr<const SGP4Propagator> shared_SGP4_propagator =
+      std::make_shared<const SGP4Propagator>(element_sets);
+  size_t element_set_index = 0;
+  for (Satellite& current_satellite : input_satellite_vector) {
+    if (current_satellite.get_SGP4_propagator()) {
+      current_satellite.set_SGP4_propagator(shared_SGP4_propagator,
+                                            element_set_index);
+      element_set_index++;
     }
-    std::array<double, 3> drag_acceleration_vec = {0.0, 0.0, 0.0};
-    for (size_t ind = 0; ind < 3; ind++) {
-      drag_acceleration_vec.at(ind) =
-          drag_deceleration * (-1) * velocity_unit_vec.at(ind);
-      // Factor of (-1) because this acceleration acts in direction opposite to
-      // velocity
+  }
+}
+
+void run_in_parallel(const size_t input_num_tasks,
+                     const size_t input_num_threads,
+                     const std::function<void(const size_t)>& input_task) {
+  std::vector<std::exception_ptr> task_exceptions(input_num_tasks, nullptr);
+  // Each thread takes the next task which hasn't been started yet
+  std::atomic<size_t> next_task_index(0);
+  auto run_remaining_tasks = [&]() {
+    for (size_t task_index = next_task_index++; task_index < input_num_tasks;
+         task_index = next_task_index++) {
+      try {
+        input_task(task_index);
+      } catch (...) {
+        task_exceptions.at(task_index) = std::current_exception();
+      }
     }
-    for (size_t ind = 0; ind < 3; ind++) {
-      acceleration_vec.at(ind) += drag_acceleration_vec.at(ind);
+  };
+  size_t num_threads =
+      std::min(std::max(input_num_threads, size_t(1)), input_num_tasks);
+  std::vector<std::thread> threads = {};
+  for (size_t thread_ind = 1; thread_ind < num_threads; thread_ind++) {
+    threads.emplace_back(run_remaining_tasks);
+  }
+  run_remaining_tasks();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const std::exception_ptr& task_exception : task_exceptions) {
+    if (task_exception) {
+      std::rethrow_exception(task_exception);
     }
   }
-
-  return acceleration_vec;
 }
 
 std::array<double, 6> RK4_deriv_function_orbit_position_and_velocity(
@@ -394,53 +584,23 @@ std::array<double, 6> RK4_deriv_function_orbit_position_and_velocity(
   return derivative_of_input_y;
 }
 
-std::array<double, 6> RK45_deriv_function_orbit_position_and_velocity(
-    const std::array<double, 6> input_position_and_velocity,
-    const double input_spacecraft_mass,
-    const std::vector<ThrustProfileLVLH> input_list_of_thrust_profiles_LVLH,
-    const double input_evaluation_time, const double input_inclination,
-    const double input_arg_of_periapsis, const double input_true_anomaly,
-    const double input_F_10, const double input_A_p, const double input_A_s,
-    const double input_satellite_mass, const bool perturbation,
-    const bool atmospheric_drag) {
-  std::array<double, 6> derivative_of_input_y = {};
-  std::array<double, 3> position_array = {};
-  std::array<double, 3> velocity_array = {};
-
-  for (size_t ind = 0; ind < 3; ind++) {
-    derivative_of_input_y.at(ind) = input_position_and_velocity.at(ind + 3);
-    velocity_array.at(ind) = input_position_and_velocity.at(ind + 3);
-    position_array.at(ind) = input_position_and_velocity.at(ind);
-  }
-
-  std::array<double, 3> calculated_orbital_acceleration =
-      calculate_orbital_acceleration(
-          position_array, input_spacecraft_mass,
-          input_list_of_thrust_profiles_LVLH, input_evaluation_time,
-          velocity_array, input_inclination, input_arg_of_periapsis,
-          input_true_anomaly, input_F_10, input_A_p, input_A_s,
-          input_satellite_mass, perturbation, atmospheric_drag);
-
-  for (size_t ind = 3; ind < 6; ind++) {
-    derivative_of_input_y.at(ind) = calculated_orbital_acceleration.at(ind - 3);
-  }
-
-  return derivative_of_input_y;
-}
-
 // Objective: simulate the input satellites over the specified total sim time,
 // and visualize the resulting orbits in an interactive 3D plot using gnuplot
-void sim_and_draw_orbit_gnuplot(std::vector<Satellite> input_satellite_vector,
+void sim_and_draw_orbit_gnuplot(SatelliteStore& input_satellite_store,
                                 const double input_timestep,
                                 const double input_total_sim_time,
                                 const double input_epsilon,
                                 const bool perturbation,
                                 const bool atmospheric_drag,
-                                const std::pair<double, double> drag_elements) {
-  if (input_satellite_vector.size() < 1) {
+                                const std::pair<double, double> drag_elements,
+                                const bool third_body,
+                                const bool solar_radiation_pressure) {
+  if (input_satellite_store.size() < 1) {
     std::cout << "No input Satellite objects\n";
     return;
   }
+  // Satellites with the same epoch share one set of Sun and Moon positions
+  share_environment(input_satellite_store.get_satellites());
 
   // first, open "pipe" to gnuplot
   FILE *gnuplot_pipe = popen("gnuplot -persist", "w");
@@ -473,57 +633,62 @@ void sim_and_draw_orbit_gnuplot(std::vector<Satellite> input_satellite_vector,
     fprintf(gnuplot_pipe, "set vrange [0:2*pi]\n");
 
     // first satellite
-    Satellite current_satellite = input_satellite_vector.at(0);
-    if (input_satellite_vector.size() == 1) {
-      if (current_satellite.plotting_color_.size() > 0) {
+    const std::string& first_name = input_satellite_store.get_name({0});
+    const std::string& first_color =
+        input_satellite_store.get_plotting_color({0});
+    if (input_satellite_store.size() == 1) {
+      if (first_color.size() > 0) {
         fprintf(gnuplot_pipe,
                 "splot '-' with lines lw 1 lc rgb '%s' title '%s' \\\n",
-                current_satellite.plotting_color_.c_str(),
-                current_satellite.get_name().c_str());
+                first_color.c_str(),
+                first_name.c_str());
       } else {
         fprintf(gnuplot_pipe, "splot '-' with lines lw 1 title '%s' \\\n",
-                current_satellite.get_name().c_str());
+                first_name.c_str());
       }
 
     }
 
     else {
-      if (current_satellite.plotting_color_.size() > 0) {
+      if (first_color.size() > 0) {
         fprintf(gnuplot_pipe,
                 "splot '-' with lines lw 1 lc rgb '%s' title '%s'\\\n",
-                current_satellite.plotting_color_.c_str(),
-                current_satellite.get_name().c_str());
+                first_color.c_str(),
+                first_name.c_str());
       } else {
         fprintf(gnuplot_pipe, "splot '-' with lines lw 1 title '%s'\\\n",
-                current_satellite.get_name().c_str());
+                first_name.c_str());
       }
     }
 
     for (size_t satellite_index = 1;
-         satellite_index < input_satellite_vector.size(); satellite_index++) {
-      current_satellite = input_satellite_vector.at(satellite_index);
-      if (satellite_index < input_satellite_vector.size() - 1) {
-        if (current_satellite.plotting_color_.size() > 0) {
+         satellite_index < input_satellite_store.size(); satellite_index++) {
+      const std::string& current_name =
+          input_satellite_store.get_name({satellite_index});
+      const std::string& current_color =
+          input_satellite_store.get_plotting_color({satellite_index});
+      if (satellite_index < input_satellite_store.size() - 1) {
+        if (current_color.size() > 0) {
           fprintf(gnuplot_pipe,
                   ",'-' with lines lw 1 lc rgb '%s' title '%s' \\\n",
-                  current_satellite.plotting_color_.c_str(),
-                  current_satellite.get_name().c_str());
+                  current_color.c_str(),
+                  current_name.c_str());
         } else {
           fprintf(gnuplot_pipe, ",'-' with lines lw 1 title '%s' \\\n",
-                  current_satellite.get_name().c_str());
+                  current_name.c_str());
         }
 
       }
 
       else {
-        if (current_satellite.plotting_color_.size() > 0) {
+        if (current_color.size() > 0) {
           fprintf(gnuplot_pipe,
                   ",'-' with lines lw 1 lc rgb '%s' title '%s'\\\n",
-                  current_satellite.plotting_color_.c_str(),
-                  current_satellite.get_name().c_str());
+                  current_color.c_str(),
+                  current_name.c_str());
         } else {
           fprintf(gnuplot_pipe, ",'-' with lines lw 1 title '%s'\\\n",
-                  current_satellite.get_name().c_str());
+                  current_name.c_str());
         }
       }
     }
@@ -533,8 +698,9 @@ void sim_and_draw_orbit_gnuplot(std::vector<Satellite> input_satellite_vector,
 
     // now the orbit data, inline, one satellite at a time
     for (size_t satellite_index = 0;
-         satellite_index < input_satellite_vector.size(); satellite_index++) {
-      Satellite current_satellite = input_satellite_vector.at(satellite_index);
+         satellite_index < input_satellite_store.size(); satellite_index++) {
+      Satellite& current_satellite =
+          input_satellite_store.get_satellite({satellite_index});
       std::array<double, 3> initial_position =
           current_satellite.get_ECI_position();
       fprintf(gnuplot_pipe, "%.17g %.17g %.17g\n", initial_position.at(0),
@@ -543,13 +709,18 @@ void sim_and_draw_orbit_gnuplot(std::vector<Satellite> input_satellite_vector,
       std::array<double, 3> evolved_position = {};
 
       double timestep_to_use = input_timestep;
+      std::vector<ForceTerm> force_terms = force_terms_from_flags(
+          perturbation, atmospheric_drag, third_body, solar_radiation_pressure);
+      if (third_body || solar_radiation_pressure) {
+        // Fit the Sun and Moon ephemeris over the whole run up front
+        current_satellite.prefit_sun_moon_ephemeris(input_total_sim_time);
+      }
       double current_satellite_time =
           current_satellite.get_instantaneous_time();
       while (current_satellite_time < input_total_sim_time) {
         std::pair<double, int> new_timestep_and_error_code =
             current_satellite.evolve_RK45(input_epsilon, timestep_to_use,
-                                          perturbation, atmospheric_drag,
-                                          drag_elements);
+                                          force_terms, drag_elements);
         double new_timestep = new_timestep_and_error_code.first;
         int error_code = new_timestep_and_error_code.second;
         if (error_code != 0) {
@@ -579,18 +750,37 @@ void sim_and_draw_orbit_gnuplot(std::vector<Satellite> input_satellite_vector,
   return;
 }
 
+void sim_and_draw_orbit_gnuplot(std::vector<Satellite> input_satellite_vector,
+                                const double input_timestep,
+                                const double input_total_sim_time,
+                                const double input_epsilon,
+                                const bool perturbation,
+                                const bool atmospheric_drag,
+                                const std::pair<double, double> drag_elements,
+                                const bool third_body,
+                                const bool solar_radiation_pressure) {
+  SatelliteStore satellite_store(std::move(input_satellite_vector));
+  sim_and_draw_orbit_gnuplot(satellite_store, input_timestep,
+                             input_total_sim_time, input_epsilon, perturbation,
+                             atmospheric_drag, drag_elements, third_body,
+                             solar_radiation_pressure);
+}
+
 // Objective: simulate the input satellites over the specified total sim time,
 // and plot a specific orbital element over time
 void sim_and_plot_orbital_elem_gnuplot(
-    std::vector<Satellite> input_satellite_vector, const double input_timestep,
+    SatelliteStore& input_satellite_store, const double input_timestep,
     const double input_total_sim_time, const double input_epsilon,
     const std::string input_orbital_element_name, const bool perturbation,
     const bool atmospheric_drag,
-    const std::pair<double, double> drag_elements) {
-  if (input_satellite_vector.size() < 1) {
+    const std::pair<double, double> drag_elements, const bool third_body,
+    const bool solar_radiation_pressure) {
+  if (input_satellite_store.size() < 1) {
     std::cout << "No input Satellite objects\n";
     return;
   }
+  // Satellites with the same epoch share one set of Sun and Moon positions
+  share_environment(input_satellite_store.get_satellites());
 
   // first, open "pipe" to gnuplot
   FILE *gnuplot_pipe = popen("gnuplot", "w");
@@ -616,68 +806,74 @@ void sim_and_plot_orbital_elem_gnuplot(
     // plotting
 
     // first satellite
-    Satellite current_satellite = input_satellite_vector.at(0);
-    if (input_satellite_vector.size() == 1) {
-      if (current_satellite.plotting_color_.size() > 0) {
+    const std::string& first_name = input_satellite_store.get_name({0});
+    const std::string& first_color =
+        input_satellite_store.get_plotting_color({0});
+    if (input_satellite_store.size() == 1) {
+      if (first_color.size() > 0) {
         fprintf(gnuplot_pipe,
                 "plot '-' using 1:2 with lines lw 1 lc rgb '%s' title '%s' \n",
-                current_satellite.plotting_color_.c_str(),
-                current_satellite.get_name().c_str());
+                first_color.c_str(),
+                first_name.c_str());
       } else {
         fprintf(gnuplot_pipe,
                 "pplot '-' using 1:2 with lines lw 1 title '%s' \n",
-                current_satellite.get_name().c_str());
+                first_name.c_str());
       }
 
     }
 
     else {
-      if (current_satellite.plotting_color_.size() > 0) {
+      if (first_color.size() > 0) {
         fprintf(gnuplot_pipe,
                 "plot '-' using 1:2 with lines lw 1 lc rgb '%s' title '%s'\\\n",
-                current_satellite.plotting_color_.c_str(),
-                current_satellite.get_name().c_str());
+                first_color.c_str(),
+                first_name.c_str());
       } else {
         fprintf(gnuplot_pipe,
                 "plot '-' using 1:2 with lines lw 1 title '%s'\\\n",
-                current_satellite.get_name().c_str());
+                first_name.c_str());
       }
     }
 
     for (size_t satellite_index = 1;
-         satellite_index < input_satellite_vector.size(); satellite_index++) {
-      current_satellite = input_satellite_vector.at(satellite_index);
-      if (satellite_index < input_satellite_vector.size() - 1) {
-        if (current_satellite.plotting_color_.size() > 0) {
+         satellite_index < input_satellite_store.size(); satellite_index++) {
+      const std::string& current_name =
+          input_satellite_store.get_name({satellite_index});
+      const std::string& current_color =
+          input_satellite_store.get_plotting_color({satellite_index});
+      if (satellite_index < input_satellite_store.size() - 1) {
+        if (current_color.size() > 0) {
           fprintf(gnuplot_pipe,
                   ",'-' using 1:2 with lines lw 1 lc rgb '%s' title '%s' \\\n",
-                  current_satellite.plotting_color_.c_str(),
-                  current_satellite.get_name().c_str());
+                  current_color.c_str(),
+                  current_name.c_str());
         } else {
           fprintf(gnuplot_pipe,
                   ",'-' using 1:2 with lines lw 1 title '%s' \\\n",
-                  current_satellite.get_name().c_str());
+                  current_name.c_str());
         }
 
       }
 
       else {
-        if (current_satellite.plotting_color_.size() > 0) {
+        if (current_color.size() > 0) {
           fprintf(gnuplot_pipe,
                   ",'-' using 1:2 with lines lw 1 lc rgb '%s' title '%s'\n",
-                  current_satellite.plotting_color_.c_str(),
-                  current_satellite.get_name().c_str());
+                  current_color.c_str(),
+                  current_name.c_str());
         } else {
           fprintf(gnuplot_pipe, ",'-' using 1:2 with lines lw 1 title '%s'\n",
-                  current_satellite.get_name().c_str());
+                  current_name.c_str());
         }
       }
     }
 
     // now the orbit data, inline, one satellite at a time
     for (size_t satellite_index = 0;
-         satellite_index < input_satellite_vector.size(); satellite_index++) {
-      Satellite current_satellite = input_satellite_vector.at(satellite_index);
+         satellite_index < input_satellite_store.size(); satellite_index++) {
+      Satellite& current_satellite =
+          input_satellite_store.get_satellite({satellite_index});
       double val =
           current_satellite.get_orbital_element(input_orbital_element_name);
       double current_satellite_time =
@@ -687,12 +883,17 @@ void sim_and_plot_orbital_elem_gnuplot(
       double evolved_val = {0};
 
       double timestep_to_use = input_timestep;
+      std::vector<ForceTerm> force_terms = force_terms_from_flags(
+          perturbation, atmospheric_drag, third_body, solar_radiation_pressure);
+      if (third_body || solar_radiation_pressure) {
+        // Fit the Sun and Moon ephemeris over the whole run up front
+        current_satellite.prefit_sun_moon_ephemeris(input_total_sim_time);
+      }
       current_satellite_time = current_satellite.get_instantaneous_time();
       while (current_satellite_time < input_total_sim_time) {
         std::pair<double, int> new_timestep_and_error_code =
             current_satellite.evolve_RK45(input_epsilon, timestep_to_use,
-                                          perturbation, atmospheric_drag,
-                                          drag_elements);
+                                          force_terms, drag_elements);
         double new_timestep = new_timestep_and_error_code.first;
         int error_code = new_timestep_and_error_code.second;
 
@@ -726,6 +927,20 @@ void sim_and_plot_orbital_elem_gnuplot(
   return;
 }
 
+void sim_and_plot_orbital_elem_gnuplot(
+    std::vector<Satellite> input_satellite_vector, const double input_timestep,
+    const double input_total_sim_time, const double input_epsilon,
+    const std::string input_orbital_element_name, const bool perturbation,
+    const bool atmospheric_drag,
+    const std::pair<double, double> drag_elements, const bool third_body,
+    const bool solar_radiation_pressure) {
+  SatelliteStore satellite_store(std::move(input_satellite_vector));
+  sim_and_plot_orbital_elem_gnuplot(
+      satellite_store, input_timestep, input_total_sim_time, input_epsilon,
+      input_orbital_element_name, perturbation, atmospheric_drag,
+      drag_elements, third_body, solar_radiation_pressure);
+}
+
 Matrix3d z_rot_matrix(const double input_angle) {
   Matrix3d z_rotation_matrix;
   z_rotation_matrix << cos(input_angle), -sin(input_angle), 0, sin(input_angle),
@@ -780,15 +995,18 @@ std::array<double, 4> bodyframe_quaternion_deriv(
 // Objective: simulate the input satellites over the specified total sim time,
 // and plot a specific attitude-related value over time
 void sim_and_plot_attitude_evolution_gnuplot(
-    std::vector<Satellite> input_satellite_vector, const double input_timestep,
+    SatelliteStore& input_satellite_store, const double input_timestep,
     const double input_total_sim_time, const double input_epsilon,
     const std::string input_plotted_val_name, const bool perturbation,
     const bool atmospheric_drag,
-    const std::pair<double, double> drag_elements) {
-  if (input_satellite_vector.size() < 1) {
+    const std::pair<double, double> drag_elements, const bool third_body,
+    const bool solar_radiation_pressure) {
+  if (input_satellite_store.size() < 1) {
     std::cout << "No input Satellite objects\n";
     return;
   }
+  // Satellites with the same epoch share one set of Sun and Moon positions
+  share_environment(input_satellite_store.get_satellites());
 
   // first, open "pipe" to gnuplot
   FILE *gnuplot_pipe = popen("gnuplot", "w");
@@ -818,68 +1036,74 @@ void sim_and_plot_attitude_evolution_gnuplot(
     // plotting
 
     // first satellite
-    Satellite current_satellite = input_satellite_vector.at(0);
-    if (input_satellite_vector.size() == 1) {
-      if (current_satellite.plotting_color_.size() > 0) {
+    const std::string& first_name = input_satellite_store.get_name({0});
+    const std::string& first_color =
+        input_satellite_store.get_plotting_color({0});
+    if (input_satellite_store.size() == 1) {
+      if (first_color.size() > 0) {
         fprintf(gnuplot_pipe,
                 "plot '-' using 1:2 with lines lw 1 lc rgb '%s' title '%s' \n",
-                current_satellite.plotting_color_.c_str(),
-                current_satellite.get_name().c_str());
+                first_color.c_str(),
+                first_name.c_str());
       } else {
         fprintf(gnuplot_pipe,
                 "pplot '-' using 1:2 with lines lw 1 title '%s' \n",
-                current_satellite.get_name().c_str());
+                first_name.c_str());
       }
 
     }
 
     else {
-      if (current_satellite.plotting_color_.size() > 0) {
+      if (first_color.size() > 0) {
         fprintf(gnuplot_pipe,
                 "plot '-' using 1:2 with lines lw 1 lc rgb '%s' title '%s'\\\n",
-                current_satellite.plotting_color_.c_str(),
-                current_satellite.get_name().c_str());
+                first_color.c_str(),
+                first_name.c_str());
       } else {
         fprintf(gnuplot_pipe,
                 "plot '-' using 1:2 with lines lw 1 title '%s'\\\n",
-                current_satellite.get_name().c_str());
+                first_name.c_str());
       }
     }
 
     for (size_t satellite_index = 1;
-         satellite_index < input_satellite_vector.size(); satellite_index++) {
-      current_satellite = input_satellite_vector.at(satellite_index);
-      if (satellite_index < input_satellite_vector.size() - 1) {
-        if (current_satellite.plotting_color_.size() > 0) {
+         satellite_index < input_satellite_store.size(); satellite_index++) {
+      const std::string& current_name =
+          input_satellite_store.get_name({satellite_index});
+      const std::string& current_color =
+          input_satellite_store.get_plotting_color({satellite_index});
+      if (satellite_index < input_satellite_store.size() - 1) {
+        if (current_color.size() > 0) {
           fprintf(gnuplot_pipe,
                   ",'-' using 1:2 with lines lw 1 lc rgb '%s' title '%s' \\\n",
-                  current_satellite.plotting_color_.c_str(),
-                  current_satellite.get_name().c_str());
+                  current_color.c_str(),
+                  current_name.c_str());
         } else {
           fprintf(gnuplot_pipe,
                   ",'-' using 1:2 with lines lw 1 title '%s' \\\n",
-                  current_satellite.get_name().c_str());
+                  current_name.c_str());
         }
 
       }
 
       else {
-        if (current_satellite.plotting_color_.size() > 0) {
+        if (current_color.size() > 0) {
           fprintf(gnuplot_pipe,
                   ",'-' using 1:2 with lines lw 1 lc rgb '%s' title '%s'\n",
-                  current_satellite.plotting_color_.c_str(),
-                  current_satellite.get_name().c_str());
+                  current_color.c_str(),
+                  current_name.c_str());
         } else {
           fprintf(gnuplot_pipe, ",'-' using 1:2 with lines lw 1 title '%s'\n",
-                  current_satellite.get_name().c_str());
+                  current_name.c_str());
         }
       }
     }
 
     // now the orbit data, inline, one satellite at a time
     for (size_t satellite_index = 0;
-         satellite_index < input_satellite_vector.size(); satellite_index++) {
-      Satellite current_satellite = input_satellite_vector.at(satellite_index);
+         satellite_index < input_satellite_store.size(); satellite_index++) {
+      Satellite& current_satellite =
+          input_satellite_store.get_satellite({satellite_index});
       double val = current_satellite.get_attitude_val(input_plotted_val_name);
       double current_satellite_time =
           current_satellite.get_instantaneous_time();
@@ -888,12 +1112,17 @@ void sim_and_plot_attitude_evolution_gnuplot(
       double evolved_val = {0};
 
       double timestep_to_use = input_timestep;
+      std::vector<ForceTerm> force_terms = force_terms_from_flags(
+          perturbation, atmospheric_drag, third_body, solar_radiation_pressure);
+      if (third_body || solar_radiation_pressure) {
+        // Fit the Sun and Moon ephemeris over the whole run up front
+        current_satellite.prefit_sun_moon_ephemeris(input_total_sim_time);
+      }
       current_satellite_time = current_satellite.get_instantaneous_time();
       while (current_satellite_time < input_total_sim_time) {
         std::pair<double, int> new_timestep_and_error_code =
             current_satellite.evolve_RK45(input_epsilon, timestep_to_use,
-                                          perturbation, atmospheric_drag,
-                                          drag_elements);
+                                          force_terms, drag_elements);
         double new_timestep = new_timestep_and_error_code.first;
         int error_code = new_timestep_and_error_code.second;
 
@@ -925,6 +1154,20 @@ void sim_and_plot_attitude_evolution_gnuplot(
   return;
 }
 
+void sim_and_plot_attitude_evolution_gnuplot(
+    std::vector<Satellite> input_satellite_vector, const double input_timestep,
+    const double input_total_sim_time, const double input_epsilon,
+    const std::string input_plotted_val_name, const bool perturbation,
+    const bool atmospheric_drag,
+    const std::pair<double, double> drag_elements, const bool third_body,
+    const bool solar_radiation_pressure) {
+  SatelliteStore satellite_store(std::move(input_satellite_vector));
+  sim_and_plot_attitude_evolution_gnuplot(
+      satellite_store, input_timestep, input_total_sim_time, input_epsilon,
+      input_plotted_val_name, perturbation, atmospheric_drag, drag_elements,
+      third_body, solar_radiation_pressure);
+}
+
 Matrix3d rollyawpitch_bodyframe_to_LVLH_matrix(const double input_roll,
                                                const double input_pitch,
                                                const double input_yaw) {
@@ -983,54 +1226,60 @@ Matrix3d LVLH_to_body_transformation_matrix_from_quaternion(
   return LVLH_to_body_mat;
 }
 
+// Objective: compute the terms of the attitude dynamics which depend on the
+// angular velocity and attitude at one RK stage, and are shared by the
+// gyroscopic and LVLH frame rotation parts of the angular acceleration
+AttitudeStageTerms calculate_attitude_stage_terms(
+    const InertiaTensor& input_inertia_tensor, const Vector3d input_omega_I,
+    const double input_orbital_angular_acceleration,
+    const Matrix3d input_LVLH_to_bodyframe_transformation_matrix,
+    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH) {
+  AttitudeStageTerms stage_terms;
+  stage_terms.inertia_tensor = &input_inertia_tensor;
+  stage_terms.gyroscopic_torque =
+      -input_omega_I.cross(input_inertia_tensor.multiply(input_omega_I));
+  stage_terms.omega_LVLH_wrt_inertial_in_body_frame =
+      input_LVLH_to_bodyframe_transformation_matrix *
+      input_omega_LVLH_wrt_inertial_in_LVLH;
+  Vector3d omega_dot_vec_LVLH_wrt_inertial_in_ECI = {
+      0, -input_orbital_angular_acceleration, 0};
+  stage_terms.LVLH_angular_acceleration_term =
+      -input_LVLH_to_bodyframe_transformation_matrix *
+      omega_dot_vec_LVLH_wrt_inertial_in_ECI;
+  return stage_terms;
+}
+
 // Objective: compute time derivatives of bodyframe angular velocities
 std::array<double, 3> calculate_spacecraft_bodyframe_angular_acceleration(
-    const Matrix3d J_matrix,
-    const std::vector<BodyframeTorqueProfile>
-        input_bodyframe_torque_profile_list,
-    const Vector3d input_omega_I,
-    const double input_orbital_angular_acceleration,
+    const AttitudeStageTerms& input_stage_terms,
+    PiecewiseConstantSchedule<3>& input_bodyframe_torque_schedule,
     const Vector3d input_omega_bodyframe_wrt_LVLH_in_body_frame,
-    const Matrix3d input_LVLH_to_bodyframe_transformation_matrix,
-    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH,
-    const double input_evaluation_time) {
+    const double input_evaluation_time,
+    const Vector3d input_state_dependent_bodyframe_torque) {
   // Using approach from
   // https://ntrs.nasa.gov/api/citations/20240009554/downloads/Space%20Attitude%20Development%20Control.pdf
   // , Ch. 4 especially Objective: calculate omega_dot in spacecraft body frame
-  // w.r.t. the LVLH frame, expressed in the spacecraft body frame Disturbance
-  // torques, if eventually added in, should just be more torque profiles in the
-  // satellite object's list of torque profiles So the input_torques vector
-  // includes both disturbance and control torques
-  Vector3d bodyframe_torque_vec = {0, 0, 0};
-
-  for (const BodyframeTorqueProfile bodyframe_torque_profile :
-       input_bodyframe_torque_profile_list) {
-    if ((input_evaluation_time >= bodyframe_torque_profile.t_start_) &&
-        (input_evaluation_time <= bodyframe_torque_profile.t_end_)) {
-      for (size_t ind = 0; ind < 3; ind++) {
-        bodyframe_torque_vec(ind) +=
-            bodyframe_torque_profile.bodyframe_torque_list.at(ind);
-      }
-    }
-  }
-
-  Vector3d omega_lvlh_dot = {0, -input_orbital_angular_acceleration, 0};
-  Matrix3d inverted_J_matrix = J_matrix;
-  inverted_J_matrix.inverse();
-
-  Vector3d comp1 =
-      -inverted_J_matrix * (input_omega_I.cross(J_matrix * input_omega_I));
-  Vector3d comp2 = inverted_J_matrix * bodyframe_torque_vec;
+  // w.r.t. the LVLH frame, expressed in the spacecraft body frame. The total
+  // torque is the sum of the scheduled torque profiles and any torques which
+  // depend on the satellite's state (e.g., magnetic, gravity-gradient and
+  // aerodynamic torques), which are computed by the caller at this
+  // evaluation's state
+  const std::array<double, 3>& bodyframe_torque_array =
+      input_bodyframe_torque_schedule.get_value(input_evaluation_time);
+  Vector3d bodyframe_torque_vec = {bodyframe_torque_array.at(0),
+                                   bodyframe_torque_array.at(1),
+                                   bodyframe_torque_array.at(2)};
+  bodyframe_torque_vec += input_state_dependent_bodyframe_torque;
+
+  // J^-1 applied to the gyroscopic and external torques together
+  Vector3d comp1_and_comp2 = input_stage_terms.inertia_tensor->solve(
+      input_stage_terms.gyroscopic_torque + bodyframe_torque_vec);
   Vector3d comp3 = input_omega_bodyframe_wrt_LVLH_in_body_frame.cross(
-      input_LVLH_to_bodyframe_transformation_matrix *
-      input_omega_LVLH_wrt_inertial_in_LVLH);
-  Vector3d omega_dot_vec_LVLH_wrt_inertial_in_ECI = {
-      0, -input_orbital_angular_acceleration, 0};
-  Vector3d comp4 = -input_LVLH_to_bodyframe_transformation_matrix *
-                   omega_dot_vec_LVLH_wrt_inertial_in_ECI;
+      input_stage_terms.omega_LVLH_wrt_inertial_in_body_frame);
+  Vector3d comp4 = input_stage_terms.LVLH_angular_acceleration_term;
 
   Vector3d angular_acceleration_bodyframe_wrt_LVLH_in_bodyframe =
-      comp1 + comp2 + comp3 + comp4;
+      comp1_and_comp2 + comp3 + comp4;
   std::array<double, 3>
       angular_acceleration_bodyframe_wrt_LVLH_in_bodyframe_array = {
           angular_acceleration_bodyframe_wrt_LVLH_in_bodyframe(0),
@@ -1069,46 +1318,98 @@ Vector4d quaternion_kinematics_equation(
   return quaternion_derivative;
 }
 
-// Computes time derivative of combined satellite quaternion + angular velocity
+// Objective: compute the time derivative of the rotation vector theta which
+// describes the body frame's rotation since the start of a time step, i.e.,
+// q(t) = q_n * exp(theta(t)), from the body angular velocity. This is the
+// inverse of the right Jacobian of SO(3) applied to omega (the dexp^-1 map
+// of Runge-Kutta-Munthe-Kaas methods)
+Vector3d rotation_vector_kinematics_equation(
+    const Vector3d input_rotation_vector,
+    const Vector3d angular_velocity_vec_wrt_ref_frame_in_body_frame) {
+  // Ref: Iserles et al., Lie-group methods, Acta Numerica 9 (2000), section
+  // 5.1, and Chirikjian, Stochastic Models, Information Theory, and Lie
+  // Groups, vol. 2, section 10.2
+  //   theta_dot = omega + 1/2 theta x omega
+  //               + (1/|theta|^2 - (1 + cos|theta|)/(2|theta| sin|theta|))
+  //                 theta x (theta x omega)
+  const double angle = input_rotation_vector.norm();
+  double second_order_coefficient = 1.0 / 12;
+  if (angle > 1e-4) {
+    second_order_coefficient = 1 / (angle * angle) -
+                               (1 + cos(angle)) / (2 * angle * sin(angle));
+  } else {
+    // Series expansion, avoiding cancellation for small angles
+    second_order_coefficient += angle * angle / 720;
+  }
+  Vector3d theta_cross_omega = input_rotation_vector.cross(
+      angular_velocity_vec_wrt_ref_frame_in_body_frame);
+  return angular_velocity_vec_wrt_ref_frame_in_body_frame +
+         0.5 * theta_cross_omega +
+         second_order_coefficient *
+             input_rotation_vector.cross(theta_cross_omega);
+}
+
+// Objective: rotate a quaternion by a rotation vector expressed in its body
+// frame, q * exp(theta). The result has unit norm whenever the input does
+std::array<double, 4> apply_rotation_vector_to_quaternion(
+    const std::array<double, 4> input_quaternion,
+    const Vector3d input_rotation_vector) {
+  // Ref:
+  // https://en.wikipedia.org/wiki/Quaternions_and_spatial_rotation#Using_quaternions_as_rotations
+  const double angle = input_rotation_vector.norm();
+  // sin(|theta|/2)/|theta|, by its series expansion for small angles
+  double vector_part_factor = 0.5 - angle * angle / 48;
+  if (angle > 1e-4) {
+    vector_part_factor = sin(angle / 2) / angle;
+  }
+  Vector4d rotation_quaternion;
+  rotation_quaternion << cos(angle / 2),
+      vector_part_factor * input_rotation_vector(0),
+      vector_part_factor * input_rotation_vector(1),
+      vector_part_factor * input_rotation_vector(2);
+  Vector4d rotated_quaternion = quaternion_multiplication(
+      {input_quaternion.at(0), input_quaternion.at(1), input_quaternion.at(2),
+       input_quaternion.at(3)},
+      rotation_quaternion);
+  return {rotated_quaternion(0), rotated_quaternion(1), rotated_quaternion(2),
+          rotated_quaternion(3)};
+}
+
+// Computes time derivative of combined rotation vector + angular velocity
 // vector
-std::array<double, 7> RK45_satellite_body_angular_deriv_function(
-    const std::array<double, 7> combined_bodyframe_angular_array,
-    const Matrix3d J_matrix,
-    const std::vector<BodyframeTorqueProfile>
-        input_bodyframe_torque_profile_list,
-    const Vector3d input_omega_I, double input_orbital_angular_acceleration,
-    const Matrix3d input_LVLH_to_bodyframe_transformation_matrix,
-    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH,
-    const double input_evaluation_time) {
+std::array<double, 6> RK45_satellite_body_angular_deriv_function(
+    const std::array<double, 6> combined_bodyframe_angular_array,
+    const AttitudeStageTerms& input_stage_terms,
+    PiecewiseConstantSchedule<3>& input_bodyframe_torque_schedule,
+    const double input_evaluation_time,
+    const Vector3d input_state_dependent_bodyframe_torque) {
   // Setting this up for an RK45 step with
-  // y={q_0,q_1,q_2,q_3,omega_1,omega_2,omega_3} Objective is to produce dy/dt
-  // Input quaternion should be quaternion of bodyframe relative to LVLH
-  std::array<double, 7> combined_angular_derivative_array = {0, 0, 0, 0,
+  // y={theta_1,theta_2,theta_3,omega_1,omega_2,omega_3}, where theta is the
+  // rotation vector of the body frame relative to its orientation at the
+  // start of the step (see rotation_vector_kinematics_equation). Objective is
+  // to produce dy/dt
+  std::array<double, 6> combined_angular_derivative_array = {0, 0, 0,
                                                              0, 0, 0};
-  Vector4d quaternion = {combined_bodyframe_angular_array.at(0),
-                         combined_bodyframe_angular_array.at(1),
-                         combined_bodyframe_angular_array.at(2),
-                         combined_bodyframe_angular_array.at(3)};
+  Vector3d rotation_vector = {combined_bodyframe_angular_array.at(0),
+                              combined_bodyframe_angular_array.at(1),
+                              combined_bodyframe_angular_array.at(2)};
   Vector3d body_angular_velocity_vec_wrt_LVLH_in_body_frame = {
+      combined_bodyframe_angular_array.at(3),
       combined_bodyframe_angular_array.at(4),
-      combined_bodyframe_angular_array.at(5),
-      combined_bodyframe_angular_array.at(6)};
-  Vector4d quaternion_derivative = quaternion_kinematics_equation(
-      quaternion, body_angular_velocity_vec_wrt_LVLH_in_body_frame);
+      combined_bodyframe_angular_array.at(5)};
+  Vector3d rotation_vector_derivative = rotation_vector_kinematics_equation(
+      rotation_vector, body_angular_velocity_vec_wrt_LVLH_in_body_frame);
   std::array<double, 3> body_angular_acceleration_vec_wrt_LVLH_in_body_frame =
       calculate_spacecraft_bodyframe_angular_acceleration(
-          J_matrix, input_bodyframe_torque_profile_list, input_omega_I,
-          input_orbital_angular_acceleration,
+          input_stage_terms, input_bodyframe_torque_schedule,
           body_angular_velocity_vec_wrt_LVLH_in_body_frame,
-          input_LVLH_to_bodyframe_transformation_matrix,
-          input_omega_LVLH_wrt_inertial_in_LVLH, input_evaluation_time);
+          input_evaluation_time, input_state_dependent_bodyframe_torque);
 
-  for (size_t ind = 0; ind < 4; ind++) {
-    combined_angular_derivative_array.at(ind) = quaternion_derivative(ind);
-  }
-  for (size_t ind = 4; ind < 7; ind++) {
+  for (size_t ind = 0; ind < 3; ind++) {
     combined_angular_derivative_array.at(ind) =
-        body_angular_acceleration_vec_wrt_LVLH_in_body_frame.at(ind - 4);
+        rotation_vector_derivative(ind);
+    combined_angular_derivative_array.at(ind + 3) =
+        body_angular_acceleration_vec_wrt_LVLH_in_body_frame.at(ind);
   }
 
   return combined_angular_derivative_array;
@@ -1138,68 +1439,6 @@ Matrix3d construct_J_matrix(const double input_Jxx, const double input_Jyy,
   return J_matrix;
 }
 
-std::array<double, 13>
-RK45_combined_orbit_position_velocity_attitude_deriv_function(
-    const std::array<double, 13>
-        combined_position_velocity_bodyframe_angular_array,
-    const Matrix3d J_matrix,
-    const std::vector<BodyframeTorqueProfile>
-        input_bodyframe_torque_profile_list,
-    const Vector3d input_omega_I, double input_orbital_angular_acceleration,
-    const Matrix3d input_LVLH_to_bodyframe_transformation_matrix,
-    const Vector3d input_omega_LVLH_wrt_inertial_in_LVLH,
-    const double input_spacecraft_mass,
-    const std::vector<ThrustProfileLVLH> input_list_of_thrust_profiles_LVLH,
-    const double input_evaluation_time, const double input_inclination,
-    const double input_arg_of_periapsis, const double input_true_anomaly,
-    const double input_F_10, const double input_A_p, const double input_A_s,
-    const bool perturbation, const bool atmospheric_drag) {
-  // Input vector is in the form of {ECI_position,
-  // ECI_velocity,bodyframe_quaternion_to_LVLH,bodyframe_omega_wrt_LVLH}
-  // Objective is to output derivative of that vector
-  std::array<double, 13> derivative_vec;
-  std::array<double, 6> combined_position_and_velocity_array;
-  std::array<double, 7> combined_angular_array;
-
-  for (size_t ind = 0; ind < combined_position_and_velocity_array.size();
-       ind++) {
-    combined_position_and_velocity_array.at(ind) =
-        combined_position_velocity_bodyframe_angular_array.at(ind);
-  }
-  for (size_t ind = 0; ind < combined_angular_array.size(); ind++) {
-    combined_angular_array.at(ind) =
-        combined_position_velocity_bodyframe_angular_array.at(
-            ind + combined_position_and_velocity_array.size());
-  }
-  std::array<double, 6> orbital_position_and_velocity_derivative_array =
-      RK45_deriv_function_orbit_position_and_velocity(
-          combined_position_and_velocity_array, input_spacecraft_mass,
-          input_list_of_thrust_profiles_LVLH, input_evaluation_time,
-          input_inclination, input_arg_of_periapsis, input_true_anomaly,
-          input_F_10, input_A_p, input_A_s, input_spacecraft_mass, perturbation,
-          atmospheric_drag);
-
-  std::array<double, 7> angular_derivative_array =
-      RK45_satellite_body_angular_deriv_function(
-          combined_angular_array, J_matrix, input_bodyframe_torque_profile_list,
-          input_omega_I, input_orbital_angular_acceleration,
-          input_LVLH_to_bodyframe_transformation_matrix,
-          input_omega_LVLH_wrt_inertial_in_LVLH, input_evaluation_time);
-
-  for (size_t ind = 0;
-       ind < orbital_position_and_velocity_derivative_array.size(); ind++) {
-    derivative_vec.at(ind) =
-        orbital_position_and_velocity_derivative_array.at(ind);
-  }
-  for (size_t ind = 0; ind < angular_derivative_array.size(); ind++) {
-    derivative_vec.at(ind +
-                      orbital_position_and_velocity_derivative_array.size()) =
-        angular_derivative_array.at(ind);
-  }
-
-  return derivative_vec;
-}
-
 std::array<double, 4> normalize_quaternion(
     std::array<double, 4> input_quaternion) {
   double length = 0;
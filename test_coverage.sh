@@ -7,4 +7,5 @@ cmake --build .
 ./circular_orbit_tests
 ./attitude_tests
 ./misc_tests
+./perturbation_tests
 gcovr -r .. --filter ../src/ --filter ../include/ --html-details output.html
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "Satellite.h"
+#include "force_model.h"
 #include "utils.h"
 
 const double pitch_tolerance = 5*pow(10.0, -3);
@@ -60,4 +61,233 @@ TEST(AttitudeTests, PassivePitchTest2) {
   double evolved_pitch = test_satellite.get_attitude_val("Pitch");
   EXPECT_TRUE(evolved_pitch > initial_pitch)
       << "Pitch didn't increase as expected\n";
-}
\ No newline at end of file
+}
+TEST(AttitudeTests, MagneticTorqueTest1) {
+  // Over a short step, the extra angular acceleration from a residual dipole
+  // should match J^-1 (m x B) with B the body frame geomagnetic field (J is
+  // the identity here). The magnetorquer and residual dipoles share a single
+  // field evaluation per RK stage
+  Satellite reference_satellite("../tests/attitude_test_input_1.json");
+  Satellite magnetic_satellite("../tests/attitude_test_input_1.json");
+  const std::array<double, 3> residual_dipole = {0.5, -0.2, 0.3};  // A*m^2
+  const std::array<double, 3> commanded_dipole = {0.5, 0.2, 0};    // A*m^2
+  magnetic_satellite.set_residual_magnetic_dipole(residual_dipole);
+  magnetic_satellite.add_magnetorquer_dipole_profile(commanded_dipole, 0, 10);
+  std::array<double, 3> magnetic_field_bodyframe =
+      magnetic_satellite.get_magnetic_field_bodyframe();
+  Vector3d total_dipole = {residual_dipole.at(0) + commanded_dipole.at(0),
+                           residual_dipole.at(1) + commanded_dipole.at(1),
+                           residual_dipole.at(2) + commanded_dipole.at(2)};
+  Vector3d expected_torque = total_dipole.cross(
+      Vector3d(magnetic_field_bodyframe.at(0), magnetic_field_bodyframe.at(1),
+               magnetic_field_bodyframe.at(2)));
+
+  const double test_timestep = 0.01;  // s
+  size_t initial_field_evaluations =
+      magnetic_satellite.get_geomagnetic_field()->get_num_field_evaluations();
+  reference_satellite.evolve_RK45(1, test_timestep);
+  magnetic_satellite.evolve_RK45(1, test_timestep);
+  EXPECT_EQ(
+      magnetic_satellite.get_geomagnetic_field()->get_num_field_evaluations() -
+          initial_field_evaluations,
+      6);
+  std::array<std::string, 3> omega_names = {"omega_x", "omega_y", "omega_z"};
+  for (size_t ind = 0; ind < 3; ind++) {
+    double angular_acceleration_difference =
+        (magnetic_satellite.get_attitude_val(omega_names.at(ind)) -
+         reference_satellite.get_attitude_val(omega_names.at(ind))) /
+        test_timestep;
+    EXPECT_NEAR(angular_acceleration_difference, expected_torque(ind),
+                pow(10.0, -3) * expected_torque.norm())
+        << "Magnetic torque mismatch in component " << ind << "\n";
+  }
+}
+
+TEST(AttitudeTests, GravityGradientTorqueTest1) {
+  // For a body rolled by angle theta from the LVLH frame, the
+  // gravity-gradient torque is 3 mu / r^3 (J_33 - J_22) sin(theta)
+  // cos(theta) about the body x-axis, and zero for an isotropic body
+  const double theta = 0.3;  // rad
+  Matrix3d LVLH_to_body_matrix;
+  LVLH_to_body_matrix << 1, 0, 0, 0, cos(theta), sin(theta), 0, -sin(theta),
+      cos(theta);
+  InertiaTensor inertia_tensor(construct_J_matrix(10, 20, 35));
+  const std::array<double, 3> position = {7000000, 0, 0};
+  Vector3d torque = GravityGradientTorque::calculate_bodyframe_torque(
+      position, LVLH_to_body_matrix, inertia_tensor);
+  double expected_torque_x = 3 * G * mass_Earth / pow(position.at(0), 3) *
+                             (35 - 20) * sin(theta) * cos(theta);
+  EXPECT_NEAR(torque(0), expected_torque_x,
+              pow(10.0, -12) * fabs(expected_torque_x));
+  EXPECT_NEAR(torque(1), 0, pow(10.0, -12) * fabs(expected_torque_x));
+  EXPECT_NEAR(torque(2), 0, pow(10.0, -12) * fabs(expected_torque_x));
+
+  Vector3d isotropic_torque =
+      GravityGradientTorque::calculate_bodyframe_torque(
+          position, LVLH_to_body_matrix,
+          InertiaTensor(construct_J_matrix(5, 5, 5)));
+  EXPECT_NEAR(isotropic_torque.norm(), 0,
+              pow(10.0, -12) * fabs(expected_torque_x));
+}
+
+TEST(AttitudeTests, AerodynamicTorqueTest1) {
+  // With the body frame aligned with the LVLH frame, drag acts along -x, so
+  // a center of pressure offset along +z (towards nadir) gives a torque along
+  // -y with magnitude |offset| * m * |a_drag|
+  ForceModelContext context;
+  context.spacecraft_mass_ = 100;
+  context.A_s_ = 2;
+  context.F_10_ = 150;
+  context.A_p_ = 10;
+  context.center_of_pressure_offset_ = {0, 0, 0.2};
+  const std::array<double, 3> position = {radius_Earth + 300000, 0, 0};
+  const std::array<double, 3> velocity = {0, 7700, 0};
+  Vector3d torque = AerodynamicTorque::calculate_bodyframe_torque(
+      position, velocity, Matrix3d::Identity(), 0, context);
+  std::array<double, 3> drag_acceleration =
+      calculate_atmospheric_drag_acceleration(
+          position, velocity, context.F_10_, context.A_p_, context.A_s_,
+          context.spacecraft_mass_);
+  double expected_magnitude =
+      0.2 * context.spacecraft_mass_ *
+      sqrt(pow(drag_acceleration.at(0), 2) + pow(drag_acceleration.at(1), 2) +
+           pow(drag_acceleration.at(2), 2));
+  ASSERT_TRUE(expected_magnitude > 0);
+  EXPECT_NEAR(torque(1), -expected_magnitude,
+              pow(10.0, -2) * expected_magnitude);
+  EXPECT_NEAR(torque(0), 0, pow(10.0, -2) * expected_magnitude);
+
+  // Above the atmosphere model's altitude range there's no torque
+  const std::array<double, 3> high_position = {radius_Earth + 800000, 0, 0};
+  Vector3d high_torque = AerodynamicTorque::calculate_bodyframe_torque(
+      high_position, velocity, Matrix3d::Identity(), 0, context);
+  EXPECT_EQ(high_torque.norm(), 0);
+}
+
+TEST(AttitudeTests, InertiaTensorTest1) {
+  // The cached inverse and the diagonal fast path should both invert J, and
+  // invalid tensors should be rejected
+  Matrix3d full_J_matrix;
+  full_J_matrix << 12, -1.5, 0.4, -1.5, 20, 2.2, 0.4, 2.2, 31;
+  InertiaTensor full_inertia_tensor(full_J_matrix);
+  InertiaTensor diagonal_inertia_tensor(construct_J_matrix(12, 20, 31));
+  EXPECT_FALSE(full_inertia_tensor.is_diagonal_);
+  EXPECT_TRUE(diagonal_inertia_tensor.is_diagonal_);
+  const Vector3d test_vec = {0.3, -1.2, 2.5};
+  Vector3d full_round_trip =
+      full_inertia_tensor.solve(full_inertia_tensor.multiply(test_vec));
+  Vector3d diagonal_round_trip =
+      diagonal_inertia_tensor.solve(diagonal_inertia_tensor.multiply(test_vec));
+  EXPECT_TRUE((full_round_trip - test_vec).norm() < pow(10.0, -12));
+  EXPECT_TRUE((diagonal_round_trip - test_vec).norm() < pow(10.0, -12));
+  EXPECT_TRUE((full_inertia_tensor.multiply(test_vec) -
+               full_J_matrix * test_vec)
+                  .norm() < pow(10.0, -12));
+
+  Matrix3d asymmetric_J_matrix = full_J_matrix;
+  asymmetric_J_matrix(0, 1) = 1.5;
+  EXPECT_THROW(InertiaTensor{asymmetric_J_matrix}, std::invalid_argument);
+  EXPECT_THROW(InertiaTensor{construct_J_matrix(1, -1, 1)},
+               std::invalid_argument);
+}
+
+TEST(AttitudeTests, InertiaTensorTorqueResponseTest1) {
+  // Over a short step, a constant body frame torque should add J^-1 torque
+  // to the angular acceleration, with the full inertia tensor loaded from the
+  // input file
+  Satellite reference_satellite("../tests/attitude_test_input_2.json");
+  Satellite torqued_satellite("../tests/attitude_test_input_2.json");
+  Matrix3d J_matrix = torqued_satellite.get_inertia_tensor();
+  EXPECT_EQ(J_matrix(0, 1), -1.5);
+  EXPECT_EQ(J_matrix(2, 1), 2.2);
+  const std::array<double, 3> torque = {0.02, -0.01, 0.03};  // N*m
+  torqued_satellite.add_bodyframe_torque_profile(torque, 0, 10);
+  Vector3d expected_angular_acceleration =
+      J_matrix.inverse() * Vector3d(torque.at(0), torque.at(1), torque.at(2));
+
+  const double test_timestep = 0.01;  // s
+  reference_satellite.evolve_RK45(1, test_timestep);
+  torqued_satellite.evolve_RK45(1, test_timestep);
+  std::array<std::string, 3> omega_names = {"omega_x", "omega_y", "omega_z"};
+  for (size_t ind = 0; ind < 3; ind++) {
+    double angular_acceleration_difference =
+        (torqued_satellite.get_attitude_val(omega_names.at(ind)) -
+         reference_satellite.get_attitude_val(omega_names.at(ind))) /
+        test_timestep;
+    EXPECT_NEAR(angular_acceleration_difference,
+                expected_angular_acceleration(ind),
+                pow(10.0, -3) * expected_angular_acceleration.norm())
+        << "Angular acceleration mismatch in component " << ind << "\n";
+  }
+}
+
+TEST(AttitudeTests, RotationVectorUpdateTest1) {
+  // Repeatedly applying rotation vector updates should keep the quaternion at
+  // unit norm without renormalization, and a fixed rotation vector applied n
+  // times should match a single update by n times that rotation vector
+  std::array<double, 4> composed_quaternion = {1, 0, 0, 0};
+  const Vector3d rotation_vector = {0.07, -0.11, 0.05};  // rad
+  const int num_updates = 10000;
+  for (int ind = 0; ind < num_updates; ind++) {
+    composed_quaternion =
+        apply_rotation_vector_to_quaternion(composed_quaternion,
+                                            rotation_vector);
+  }
+  double norm_squared = 0;
+  for (size_t ind = 0; ind < 4; ind++) {
+    norm_squared += composed_quaternion.at(ind) * composed_quaternion.at(ind);
+  }
+  EXPECT_NEAR(sqrt(norm_squared), 1, pow(10.0, -12));
+  std::array<double, 4> single_update_quaternion =
+      apply_rotation_vector_to_quaternion({1, 0, 0, 0},
+                                          num_updates * rotation_vector);
+  for (size_t ind = 0; ind < 4; ind++) {
+    EXPECT_NEAR(composed_quaternion.at(ind), single_update_quaternion.at(ind),
+                pow(10.0, -9))
+        << "Quaternion mismatch in component " << ind << "\n";
+  }
+  // With theta parallel to omega, the rotation vector's derivative is omega
+  Vector3d theta_derivative =
+      rotation_vector_kinematics_equation(2.5 * rotation_vector,
+                                          rotation_vector);
+  EXPECT_NEAR((theta_derivative - rotation_vector).norm(), 0, pow(10.0, -15));
+}
+
+TEST(AttitudeTests, LieGroupIntegratorTest1) {
+  // For a tumbling satellite, a loose error tolerance should take several
+  // times fewer (larger) steps and still track the attitude of a
+  // tightly-toleranced propagation
+  Satellite reference_satellite("../tests/attitude_test_input_3.json");
+  Satellite loose_satellite("../tests/attitude_test_input_3.json");
+  const double sim_time = 120;  // s
+  const double loose_epsilon = pow(10.0, -7);
+  double reference_timestep = 0.01;
+  double loose_timestep = 0.01;
+  size_t num_reference_steps = 0;
+  size_t num_loose_steps = 0;
+  while (reference_satellite.get_instantaneous_time() < sim_time) {
+    double next_timestep =
+        reference_satellite.evolve_RK45(epsilon, reference_timestep).first;
+    reference_timestep = std::min(
+        next_timestep, sim_time - reference_satellite.get_instantaneous_time());
+    num_reference_steps++;
+  }
+  while (loose_satellite.get_instantaneous_time() < sim_time) {
+    double next_timestep =
+        loose_satellite.evolve_RK45(loose_epsilon, loose_timestep).first;
+    loose_timestep = std::min(
+        next_timestep, sim_time - loose_satellite.get_instantaneous_time());
+    num_loose_steps++;
+  }
+  EXPECT_LT(5 * num_loose_steps, num_reference_steps)
+      << "Loose tolerance took " << num_loose_steps << " steps, against "
+      << num_reference_steps << " for the reference\n";
+  std::array<std::string, 6> attitude_val_names = {
+      "Roll", "Pitch", "Yaw", "omega_x", "omega_y", "omega_z"};
+  for (const std::string& attitude_val_name : attitude_val_names) {
+    EXPECT_NEAR(loose_satellite.get_attitude_val(attitude_val_name),
+                reference_satellite.get_attitude_val(attitude_val_name),
+                pow(10.0, -4))
+        << "Mismatch in " << attitude_val_name << "\n";
+  }
+}
@@ -228,4 +228,193 @@ TEST(CircularOrbitTests, Thruster_Eccentricity_Change) {
   EXPECT_TRUE(resulting_eccentricity > 0)
       << "Resulting eccentricity was not greater than 0. Calculated value: "
       << resulting_eccentricity << "\n";
-}
\ No newline at end of file
+}
+TEST(CircularOrbitTests, Thruster_Propellant_Mass_Flow) {
+  // With a specific impulse, the satellite should lose mass at a rate of
+  // F/(Isp*g_0) while the thruster is on
+  Satellite test_satellite("../tests/circular_orbit_test_2_input.json");
+  std::array<double, 3> LVLH_thrust_direction = {1, 0, 0};
+  double thrust_magnitude = 100;  // N
+  double Isp = 300;               // s
+  double t_thrust_start = 0;
+  double t_thrust_end = 100;
+  double initial_mass = test_satellite.get_mass();
+
+  test_satellite.add_LVLH_thrust_profile(LVLH_thrust_direction,
+                                         thrust_magnitude, t_thrust_start,
+                                         t_thrust_end, Isp);
+  double test_timestep = 1;  // s
+  while (test_satellite.get_instantaneous_time() < t_thrust_end) {
+    // Step exactly up to the end of the burn
+    double timestep_to_use = std::min(
+        test_timestep, t_thrust_end - test_satellite.get_instantaneous_time());
+    std::pair<double, int> new_timestep_and_error_code =
+        test_satellite.evolve_RK45(epsilon, timestep_to_use);
+    test_timestep = new_timestep_and_error_code.first;
+  }
+  double expected_mass =
+      initial_mass - thrust_magnitude / (Isp * standard_gravity) *
+                         test_satellite.get_instantaneous_time();
+  EXPECT_NEAR(test_satellite.get_mass(), expected_mass, pow(10.0, -9))
+      << "Mass after burn didn't match expected propellant consumption\n";
+}
+
+TEST(CircularOrbitTests, Thruster_Propellant_Exhaustion) {
+  // Thrust should cut out once the mass reaches the dry mass
+  Satellite test_satellite("../tests/circular_orbit_test_3_input.json");
+  std::array<double, 3> LVLH_thrust_direction = {1, 0, 0};
+  double thrust_magnitude = 100;  // N
+  double Isp = 300;               // s
+  double mass_flow_rate = thrust_magnitude / (Isp * standard_gravity);
+
+  test_satellite.add_LVLH_thrust_profile(LVLH_thrust_direction,
+                                         thrust_magnitude, 0, 100, Isp);
+  double test_timestep = 1;  // s
+  while (test_satellite.get_instantaneous_time() < 100) {
+    std::pair<double, int> new_timestep_and_error_code =
+        test_satellite.evolve_RK45(epsilon, test_timestep);
+    test_timestep = new_timestep_and_error_code.first;
+  }
+  // The cutoff happens within a step, so allow for one step's worth of flow
+  EXPECT_NEAR(test_satellite.get_mass(), 929, mass_flow_rate * test_timestep)
+      << "Mass didn't stop decreasing at the dry mass\n";
+}
+
+TEST(CircularOrbitTests, Thruster_Isp_Requires_Dry_Mass) {
+  // Without a dry mass, propellant-consuming thrust would drive the mass
+  // towards 0, so it is rejected
+  Satellite test_satellite("../tests/circular_orbit_test_1_input.json");
+  double Isp = 300;  // s
+  EXPECT_THROW(
+      test_satellite.add_LVLH_thrust_profile({1, 0, 0}, 100, 0, 100, Isp),
+      std::invalid_argument);
+  ThrustProfileLVLH thrust_profile(0, 100, {1, 0, 0});
+  test_satellite.set_LVLH_thrust_profiles({thrust_profile});
+  EXPECT_THROW(test_satellite.set_LVLH_thrust_profiles(
+                   {ThrustProfileLVLH(0, 100, {1, 0, 0}, 100, Isp)}),
+               std::invalid_argument);
+  EXPECT_EQ(test_satellite.get_LVLH_thrust_profiles(),
+            std::vector<ThrustProfileLVLH>({thrust_profile}));
+  EXPECT_THROW(test_satellite.add_LVLH_thrust_curve(ThrustCurveLVLH(
+                   {0, 100}, {0, 100}, {{1, 0, 0}}, "Linear", Isp)),
+               std::invalid_argument);
+  EXPECT_THROW(test_satellite.add_LVLH_thrust_curve(
+                   "../tests/thrust_curve_test_input.json"),
+               std::invalid_argument);
+  // Thrust without an Isp doesn't consume propellant, so is still allowed
+  test_satellite.add_LVLH_thrust_profile({1, 0, 0}, 100, 0, 100);
+}
+
+TEST(CircularOrbitTests, Thrust_Curve_Propellant_Mass_Flow) {
+  // A linear ramp up to 100 N and back down over 100 s delivers an impulse of
+  // 5000 N s, so should consume 5000/(Isp*g_0) kg of propellant
+  Satellite test_satellite("../tests/circular_orbit_test_2_input.json");
+  double Isp = 300;  // s
+  double initial_mass = test_satellite.get_mass();
+  test_satellite.add_LVLH_thrust_curve(
+      ThrustCurveLVLH({0, 50, 100}, {0, 100, 0}, {{1, 0, 0}}, "Linear", Isp));
+  double test_timestep = 1;  // s
+  while (test_satellite.get_instantaneous_time() < 100) {
+    // Steps end at the peak, since the error estimate doesn't see the kink in
+    // the thrust there
+    double next_breakpoint =
+        (test_satellite.get_instantaneous_time() < 50) ? 50 : 100;
+    double timestep_to_use = std::min(
+        test_timestep,
+        next_breakpoint - test_satellite.get_instantaneous_time());
+    std::pair<double, int> new_timestep_and_error_code =
+        test_satellite.evolve_RK45(epsilon, timestep_to_use);
+    test_timestep = new_timestep_and_error_code.first;
+  }
+  double expected_mass = initial_mass - 5000 / (Isp * standard_gravity);
+  EXPECT_NEAR(test_satellite.get_mass(), expected_mass, pow(10.0, -6))
+      << "Mass after thrust curve burn didn't match expected consumption\n";
+  std::array<double, 6> evolved_orbit_elements =
+      test_satellite.get_orbital_elements();
+  EXPECT_TRUE(evolved_orbit_elements.at(1) > 0)
+      << "Thrust curve didn't change the eccentricity\n";
+}
+
+TEST(CircularOrbitTests, Impulsive_Maneuver_Prograde) {
+  // A prograde delta-v should change the semimajor axis according to the
+  // vis-viva equation. The reference satellite gets a zero delta-v maneuver at
+  // the same time, so both satellites take the same steps up to the maneuver
+  Satellite test_satellite("../tests/circular_orbit_test_2_input.json");
+  Satellite reference_satellite("../tests/circular_orbit_test_2_input.json");
+  double initial_mass = test_satellite.get_mass();
+  double mu = G * mass_Earth;
+  double delta_v = 100;       // m/s
+  double Isp = 300;           // s
+  double t_maneuver = 100.3;  // s
+  // Maneuvers which cancel out, to check that maneuvers at the same time are
+  // all applied
+  test_satellite.add_impulsive_maneuver({1, 0, 0}, t_maneuver * 0.5);
+  test_satellite.add_impulsive_maneuver({-1, 0, 0}, t_maneuver * 0.5);
+  reference_satellite.add_impulsive_maneuver({0, 0, 0}, t_maneuver * 0.5);
+  test_satellite.add_impulsive_maneuver({delta_v, 0, 0}, t_maneuver,
+                                        ManeuverFrame::LVLH, Isp);
+  reference_satellite.add_impulsive_maneuver({0, 0, 0}, t_maneuver);
+  double test_timestep = 10;  // s
+  double reference_timestep = 10;  // s
+  double requested_timestep = test_timestep;
+  while (test_satellite.get_instantaneous_time() < t_maneuver) {
+    requested_timestep = test_timestep;
+    test_timestep =
+        test_satellite.evolve_RK45(epsilon, test_timestep, false).first;
+    reference_timestep =
+        reference_satellite.evolve_RK45(epsilon, reference_timestep, false)
+            .first;
+  }
+  EXPECT_EQ(test_satellite.get_instantaneous_time(), t_maneuver)
+      << "Time evolution didn't stop at the maneuver time\n";
+  // The stepper should resume with the step size it was given, rather than
+  // one shortened to reach the maneuver
+  EXPECT_EQ(test_timestep, requested_timestep);
+
+  double orbital_radius = reference_satellite.get_radius_ECI();
+  double speed_after_maneuver = reference_satellite.get_speed_ECI() + delta_v;
+  double expected_semimajor_axis =
+      1 / (2 / orbital_radius -
+           speed_after_maneuver * speed_after_maneuver / mu);
+  EXPECT_NEAR(test_satellite.get_speed_ECI(), speed_after_maneuver,
+              pow(10.0, -8));
+  EXPECT_NEAR(test_satellite.get_orbital_element("Semimajor Axis"),
+              expected_semimajor_axis, pow(10.0, -2));
+  double expected_mass =
+      initial_mass * exp(-delta_v / (Isp * standard_gravity));
+  EXPECT_NEAR(test_satellite.get_mass(), expected_mass, pow(10.0, -9));
+
+  // The same maneuver specified in the ECI frame, at t=0
+  Satellite LVLH_satellite("../tests/circular_orbit_test_2_input.json");
+  Satellite ECI_satellite("../tests/circular_orbit_test_2_input.json");
+  std::array<double, 3> ECI_velocity = ECI_satellite.get_ECI_velocity();
+  double speed = ECI_satellite.get_speed_ECI();
+  std::array<double, 3> ECI_delta_v = {};
+  for (size_t ind = 0; ind < 3; ind++) {
+    ECI_delta_v.at(ind) = delta_v * ECI_velocity.at(ind) / speed;
+  }
+  LVLH_satellite.add_impulsive_maneuver({delta_v, 0, 0}, 0);
+  ECI_satellite.add_impulsive_maneuver(ECI_delta_v, 0, ManeuverFrame::ECI);
+  LVLH_satellite.evolve_RK45(epsilon, 1, false);
+  ECI_satellite.evolve_RK45(epsilon, 1, false);
+  std::array<double, 6> LVLH_elements = LVLH_satellite.get_orbital_elements();
+  std::array<double, 6> ECI_elements = ECI_satellite.get_orbital_elements();
+  for (size_t ind = 0; ind < 6; ind++) {
+    EXPECT_NEAR(LVLH_elements.at(ind), ECI_elements.at(ind),
+                pow(10.0, -6) * std::max(1.0, fabs(LVLH_elements.at(ind))));
+  }
+
+  // A maneuver needing more propellant than is left above the dry mass is
+  // skipped without stopping propagation, and its time is reported
+  Satellite dry_satellite("../tests/circular_orbit_test_3_input.json");
+  Satellite unmaneuvered_satellite("../tests/circular_orbit_test_3_input.json");
+  dry_satellite.add_impulsive_maneuver({1000, 0, 0}, 0, ManeuverFrame::LVLH,
+                                       Isp);
+  EXPECT_EQ(dry_satellite.evolve_RK45(epsilon, 1, false).second, 0);
+  EXPECT_EQ(dry_satellite.get_skipped_impulsive_maneuver_times(),
+            std::vector<double>({0}));
+  unmaneuvered_satellite.evolve_RK45(epsilon, 1, false);
+  EXPECT_EQ(dry_satellite.get_mass(), unmaneuvered_satellite.get_mass());
+  EXPECT_EQ(dry_satellite.get_ECI_velocity(),
+            unmaneuvered_satellite.get_ECI_velocity());
+}
@@ -274,7 +274,7 @@ TEST(EllipticalOrbitTests, DragTest1) {
   while (current_time < total_sim_time) {
   std::pair<double, int> new_timestep_and_error_code =
   test_satellite_withdrag.evolve_RK45(epsilon, test_timestep, perturbation_bool,
-        false);
+        true, drag_elements);
       double next_timestep = new_timestep_and_error_code.first;
       test_timestep = next_timestep;
       int error_code = new_timestep_and_error_code.second;
@@ -286,3 +286,28 @@ TEST(EllipticalOrbitTests, DragTest1) {
       << "Semimajor axis after evolution wasn't lower when drag was introduced. "
       "This isn't expected behavior.\n";
 }
+
+TEST(EllipticalOrbitTests, PerifocalConversionTest1) {
+  // With J2 the orbital plane precesses, so the cached perifocal rotation has
+  // to follow the elements: the evolved position should stay in the
+  // perifocal P-Q plane, and converting to ECI and back should return the
+  // original vector
+  Satellite test_satellite("../tests/elliptical_orbit_test_2.json");
+  double test_timestep = 10;  // s
+  for (size_t step_ind = 0; step_ind < 100; step_ind++) {
+    test_timestep = test_satellite.evolve_RK45(epsilon, test_timestep).first;
+  }
+  std::array<double, 3> perifocal_position =
+      test_satellite.convert_ECI_to_perifocal(
+          test_satellite.get_ECI_position());
+  EXPECT_NEAR(perifocal_position.at(2), 0,
+              length_tolerance * test_satellite.get_radius_ECI());
+  std::array<double, 3> round_trip_position =
+      test_satellite.convert_ECI_to_perifocal(
+          test_satellite.convert_perifocal_to_ECI(perifocal_position));
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_NEAR(round_trip_position.at(ind), perifocal_position.at(ind),
+                length_tolerance)
+        << "Round trip mismatch in component " << ind << "\n";
+  }
+}
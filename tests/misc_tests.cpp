@@ -1,8 +1,17 @@
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <iostream>
+#include <sstream>
 
 #include "Satellite.h"
+#include "catalog.h"
+#include "checkpoint.h"
+#include "constellation.h"
+#include "lockstep_scheduler.h"
+#include "sgp4.h"
+#include "thrust_curve.h"
+#include "trajectory_branch.h"
 #include "utils.h"
 
 TEST(MiscTests, ThrustProfileInitializationTest1) {
@@ -37,4 +46,989 @@ TEST(MiscTests, TorqueProfileInitializationTest1) {
 
   EXPECT_TRUE(torque_profile_1 == torque_profile_2)
       << "Torque profiles initialized differently didn't agree.\n";
-}
\ No newline at end of file
+}
+TEST(MiscTests, PiecewiseConstantScheduleTest1) {
+  // Overlapping closed windows should sum, including exactly at the window
+  // boundaries, regardless of the order in which times are looked up
+  PiecewiseConstantSchedule<3> schedule;
+  schedule.add_window(10.0, 20.0, {1.0, 0.0, 0.0});
+  schedule.add_window(15.0, 30.0, {0.0, 2.0, 0.0});
+  schedule.add_window(20.0, 25.0, {0.0, 0.0, 3.0});
+
+  std::vector<std::pair<double, std::array<double, 3>>> expected_values = {
+      {25.0, {0.0, 2.0, 3.0}}, {5.0, {0.0, 0.0, 0.0}},
+      {10.0, {1.0, 0.0, 0.0}}, {12.0, {1.0, 0.0, 0.0}},
+      {15.0, {1.0, 2.0, 0.0}}, {20.0, {1.0, 2.0, 3.0}},
+      {20.5, {0.0, 2.0, 3.0}}, {27.0, {0.0, 2.0, 0.0}},
+      {30.0, {0.0, 2.0, 0.0}}, {30.1, {0.0, 0.0, 0.0}},
+      {14.9, {1.0, 0.0, 0.0}}};
+  for (const std::pair<double, std::array<double, 3>>& expected_value :
+       expected_values) {
+    std::array<double, 3> value = schedule.get_value(expected_value.first);
+    EXPECT_TRUE(std::equal(value.begin(), value.end(),
+                           expected_value.second.begin()))
+        << "Schedule value didn't match at t=" << expected_value.first
+        << "\n";
+  }
+}
+
+TEST(MiscTests, PiecewiseConstantScheduleTest2) {
+  // Adding a window after lookups have been done should be picked up
+  PiecewiseConstantSchedule<3> schedule;
+  schedule.add_window(0.0, 10.0, {1.0, 1.0, 1.0});
+  EXPECT_EQ(schedule.get_value(5.0).at(0), 1.0);
+  schedule.add_window(4.0, 6.0, {1.0, 0.0, 0.0});
+  EXPECT_EQ(schedule.get_value(5.0).at(0), 2.0);
+  EXPECT_EQ(schedule.get_num_windows(), 2);
+}
+
+TEST(MiscTests, ThrustCurveInterpolationTest1) {
+  std::vector<double> times = {0.0, 10.0, 20.0, 40.0};
+  std::vector<double> magnitudes = {0.0, 100.0, 100.0, 20.0};
+  std::vector<std::array<double, 3>> directions = {{1.0, 0.0, 0.0}};
+  ThrustCurveLVLH linear_curve(times, magnitudes, directions, "Linear");
+  ThrustCurveLVLH cubic_curve(times, magnitudes, directions, "Cubic");
+
+  EXPECT_DOUBLE_EQ(linear_curve.get_LVLH_force(5.0).at(0), 50.0);
+  EXPECT_DOUBLE_EQ(linear_curve.get_LVLH_force(30.0).at(0), 60.0);
+  // Both interpolants pass through the knots, and are zero outside them
+  for (size_t ind = 0; ind < times.size(); ind++) {
+    EXPECT_NEAR(cubic_curve.get_LVLH_force(times.at(ind)).at(0),
+                magnitudes.at(ind), pow(10.0, -12));
+  }
+  EXPECT_EQ(cubic_curve.get_LVLH_force(-1.0).at(0), 0.0);
+  EXPECT_EQ(cubic_curve.get_LVLH_force(41.0).at(0), 0.0);
+  // The monotone cubic shouldn't overshoot the flat section between 10 and
+  // 20 s. Evaluate out of order to exercise the segment cursor both ways
+  for (double t : {15.0, 35.0, 12.0, 2.0, 19.0, 25.0}) {
+    double thrust = cubic_curve.get_LVLH_force(t).at(0);
+    EXPECT_TRUE((thrust >= 0) && (thrust <= 100.0 + pow(10.0, -12)))
+        << "Cubic thrust curve overshot at t=" << t << ": " << thrust << "\n";
+  }
+  EXPECT_NEAR(cubic_curve.get_LVLH_force(15.0).at(0), 100.0, pow(10.0, -12));
+}
+
+TEST(MiscTests, ThrustCurveFileLoadingTest1) {
+  ThrustCurveLVLH JSON_curve =
+      load_thrust_curve_JSON("../tests/thrust_curve_test_input.json");
+  ThrustCurveLVLH CSV_curve =
+      load_thrust_curve_CSV("../tests/thrust_curve_test_input.csv", "Cubic",
+                            300);
+  EXPECT_EQ(JSON_curve.get_num_segments(), 4);
+  EXPECT_EQ(JSON_curve.get_Isp(), 300);
+  for (double t = 0; t <= 100; t += 7.3) {
+    std::array<double, 3> JSON_force = JSON_curve.get_LVLH_force(t);
+    std::array<double, 3> CSV_force = CSV_curve.get_LVLH_force(t);
+    for (size_t ind = 0; ind < 3; ind++) {
+      EXPECT_DOUBLE_EQ(JSON_force.at(ind), CSV_force.at(ind))
+          << "JSON and CSV thrust curves disagreed at t=" << t << "\n";
+    }
+    EXPECT_DOUBLE_EQ(JSON_curve.get_mass_flow_rate(t),
+                     CSV_curve.get_mass_flow_rate(t));
+  }
+  std::vector<double> times = {0.0, 10.0};
+  std::vector<double> magnitudes = {1.0, 2.0};
+  std::vector<std::array<double, 3>> directions = {{1.0, 0.0, 0.0}};
+  EXPECT_THROW(ThrustCurveLVLH(times, magnitudes, directions, "Quintic"),
+               std::invalid_argument);
+}
+
+TEST(MiscTests, EarthOrientationTest1) {
+  // GMST check against Vallado, Fundamentals of Astrodynamics and
+  // Applications, example 3-5 (1992 August 20, 12:14 UT1)
+  double julian_date = 2448854.5 + (12 + 14.0 / 60.0) / 24.0;
+  EXPECT_NEAR(calculate_GMST(julian_date) * (180.0 / M_PI), 152.578787886,
+              pow(10.0, -6));
+
+  // ECI to ECEF and back should give the original vectors, with and without
+  // precession and nutation
+  std::array<double, 3> ECI_position = {7000000, -1200000, 3100000};
+  std::array<double, 3> ECI_velocity = {1500, 6900, -2200};
+  for (bool include_precession_nutation : {false, true}) {
+    EarthOrientation earth_orientation(2460676.5, include_precession_nutation);
+    for (double t : {0.0, 1234.5, 86400.0 * 3 + 17}) {
+      std::array<double, 3> ECEF_position =
+          earth_orientation.convert_ECI_to_ECEF(ECI_position, t);
+      std::array<double, 3> ECEF_velocity =
+          earth_orientation.convert_ECI_to_ECEF_velocity(ECI_position,
+                                                         ECI_velocity, t);
+      std::array<double, 3> returned_position =
+          earth_orientation.convert_ECEF_to_ECI(ECEF_position, t);
+      std::array<double, 3> returned_velocity =
+          earth_orientation.convert_ECEF_to_ECI_velocity(ECEF_position,
+                                                         ECEF_velocity, t);
+      for (size_t ind = 0; ind < 3; ind++) {
+        EXPECT_NEAR(returned_position.at(ind), ECI_position.at(ind),
+                    pow(10.0, -6));
+        EXPECT_NEAR(returned_velocity.at(ind), ECI_velocity.at(ind),
+                    pow(10.0, -9));
+      }
+      // Rotation about the Earth's axis doesn't change the distance from it
+      // (up to precession and nutation, which tilt the axis by < 1 degree
+      // from J2000 over this decade)
+      if (!include_precession_nutation) {
+        EXPECT_NEAR(ECEF_position.at(2), ECI_position.at(2), pow(10.0, -6));
+      }
+    }
+  }
+
+  // The interpolated precession-nutation rotation should stay very close to
+  // an orthogonal matrix, and match the directly computed one
+  EarthOrientation earth_orientation(2460676.5, true);
+  double t = 5400;  // s, halfway between nodes
+  Matrix3d ECI_to_ECEF_matrix = earth_orientation.get_ECI_to_ECEF_matrix(t);
+  EXPECT_TRUE((ECI_to_ECEF_matrix * ECI_to_ECEF_matrix.transpose())
+                  .isIdentity(pow(10.0, -9)));
+  double julian_date_at_t = 2460676.5 + t / seconds_per_day;
+  std::pair<Matrix3d, double> nutation =
+      calculate_nutation_matrix(julian_date_at_t);
+  double apparent_sidereal_angle =
+      calculate_GMST(julian_date_at_t) + nutation.second;
+  Matrix3d sidereal_rotation;
+  sidereal_rotation << cos(apparent_sidereal_angle),
+      sin(apparent_sidereal_angle), 0, -sin(apparent_sidereal_angle),
+      cos(apparent_sidereal_angle), 0, 0, 0, 1;
+  Matrix3d direct_matrix = sidereal_rotation * nutation.first *
+                           calculate_precession_matrix(julian_date_at_t);
+  EXPECT_TRUE(ECI_to_ECEF_matrix.isApprox(direct_matrix, pow(10.0, -9)));
+
+  // Repeated lookups at the same time come from the cache
+  size_t num_calculations = earth_orientation.get_num_matrix_calculations();
+  earth_orientation.get_ECI_to_ECEF_matrix(t);
+  earth_orientation.convert_ECI_to_ECEF(ECI_position, t);
+  EXPECT_EQ(earth_orientation.get_num_matrix_calculations(), num_calculations);
+}
+
+TEST(MiscTests, EarthOrientationTest2) {
+  // A geostationary satellite should stay nearly fixed in the ECEF frame
+  // while moving thousands of km in the ECI frame
+  Satellite test_satellite("../tests/geostationary_test_input.json");
+  std::array<double, 3> initial_ECI_position =
+      test_satellite.get_ECI_position();
+  std::array<double, 3> initial_ECEF_position =
+      test_satellite.get_ECEF_position();
+  double test_timestep = 10;  // s
+  while (test_satellite.get_instantaneous_time() < 3600) {
+    double timestep_to_use = std::min(
+        test_timestep, 3600 - test_satellite.get_instantaneous_time());
+    test_timestep =
+        test_satellite.evolve_RK45(pow(10.0, -7), timestep_to_use, false).first;
+  }
+  std::array<double, 3> ECI_position = test_satellite.get_ECI_position();
+  std::array<double, 3> ECEF_position = test_satellite.get_ECEF_position();
+  double ECI_displacement = 0;
+  double ECEF_displacement = 0;
+  for (size_t ind = 0; ind < 3; ind++) {
+    ECI_displacement +=
+        pow(ECI_position.at(ind) - initial_ECI_position.at(ind), 2);
+    ECEF_displacement +=
+        pow(ECEF_position.at(ind) - initial_ECEF_position.at(ind), 2);
+  }
+  EXPECT_GT(sqrt(ECI_displacement), 10000 * 1000.0);
+  EXPECT_LT(sqrt(ECEF_displacement), 25 * 1000.0);
+  std::array<double, 3> ECEF_velocity = test_satellite.get_ECEF_velocity();
+  EXPECT_LT(sqrt(pow(ECEF_velocity.at(0), 2) + pow(ECEF_velocity.at(1), 2) +
+                 pow(ECEF_velocity.at(2), 2)),
+            10);
+
+  // Copies share the same Earth orientation object
+  Satellite satellite_copy = test_satellite;
+  EXPECT_EQ(satellite_copy.get_earth_orientation(),
+            test_satellite.get_earth_orientation());
+}
+
+TEST(MiscTests, GeomagneticFieldTest1) {
+  // An axial dipole (g_1^0 only) should give a northward field of |g_1^0| at
+  // the equator and twice that, pointing down, at the north pole, falling off
+  // as 1/r^3
+  const double g_10 = -29404.8;  // nT
+  GeomagneticField dipole_field({g_10, 0}, {0, 0}, 1);
+  const double a = geomagnetic_reference_radius;
+  const double field_tolerance = pow(10.0, -15);  // T
+  std::array<double, 3> equator_field =
+      dipole_field.calculate_field_ECEF({a, 0, 0});
+  std::array<double, 3> expected_equator_field = {0, 0, -g_10 * 1e-9};
+  std::array<double, 3> pole_field =
+      dipole_field.calculate_field_ECEF({0, 0, a});
+  std::array<double, 3> expected_pole_field = {0, 0, 2 * g_10 * 1e-9};
+  std::array<double, 3> distant_field =
+      dipole_field.calculate_field_ECEF({0, 2 * a, 0});
+  std::array<double, 3> expected_distant_field = {0, 0, -g_10 * 1e-9 / 8};
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_NEAR(equator_field.at(ind), expected_equator_field.at(ind),
+                field_tolerance);
+    EXPECT_NEAR(pole_field.at(ind), expected_pole_field.at(ind),
+                field_tolerance);
+    EXPECT_NEAR(distant_field.at(ind), expected_distant_field.at(ind),
+                field_tolerance);
+  }
+  EXPECT_THROW(GeomagneticField(0), std::invalid_argument);
+  EXPECT_THROW(GeomagneticField(5), std::invalid_argument);
+  EXPECT_THROW(GeomagneticField({g_10}, {0}, 1), std::invalid_argument);
+}
+
+TEST(MiscTests, GeomagneticFieldTest2) {
+  // The full field is the gradient of a potential satisfying Laplace's
+  // equation, so outside the Earth its curl and divergence vanish. Checking
+  // them by central differences exercises every term of the Legendre
+  // recursion and the spherical to Cartesian conversion
+  GeomagneticField field;
+  const std::array<double, 3> position = {4.1e6, -3.3e6, 4.4e6};
+  const double delta = 10;  // m
+  std::array<std::array<double, 3>, 3> jacobian;  // d B_i / d x_j
+  for (size_t j = 0; j < 3; j++) {
+    std::array<double, 3> forward_position = position;
+    std::array<double, 3> backward_position = position;
+    forward_position.at(j) += delta;
+    backward_position.at(j) -= delta;
+    std::array<double, 3> forward_field =
+        field.calculate_field_ECEF(forward_position);
+    std::array<double, 3> backward_field =
+        field.calculate_field_ECEF(backward_position);
+    for (size_t i = 0; i < 3; i++) {
+      jacobian.at(i).at(j) =
+          (forward_field.at(i) - backward_field.at(i)) / (2 * delta);
+    }
+  }
+  std::array<double, 3> center_field = field.calculate_field_ECEF(position);
+  double field_magnitude =
+      sqrt(pow(center_field.at(0), 2) + pow(center_field.at(1), 2) +
+           pow(center_field.at(2), 2));
+  // Field gradients are of order |B|/r
+  double gradient_scale = field_magnitude / 7e6;
+  double divergence = jacobian.at(0).at(0) + jacobian.at(1).at(1) +
+                      jacobian.at(2).at(2);
+  EXPECT_TRUE(fabs(divergence) < pow(10.0, -6) * gradient_scale)
+      << "Field divergence: " << divergence << "\n";
+  EXPECT_TRUE(fabs(jacobian.at(0).at(1) - jacobian.at(1).at(0)) <
+              pow(10.0, -6) * gradient_scale);
+  EXPECT_TRUE(fabs(jacobian.at(0).at(2) - jacobian.at(2).at(0)) <
+              pow(10.0, -6) * gradient_scale);
+  EXPECT_TRUE(fabs(jacobian.at(1).at(2) - jacobian.at(2).at(1)) <
+              pow(10.0, -6) * gradient_scale);
+  // Surface field strength is between about 22 and 67 microtesla
+  EXPECT_TRUE((field_magnitude > 1e-5) && (field_magnitude < 7e-5))
+      << "Field magnitude out of expected range: " << field_magnitude << "\n";
+  EXPECT_EQ(field.get_num_field_evaluations(), 7);
+}
+
+TEST(MiscTests, LazyDerivedQuantitiesTest1) {
+  // Orbital elements, the orbit rate and the Tait-Bryan angles are only
+  // computed when read, so reading them at every step shouldn't change the
+  // propagation or the values read at the end
+  Satellite reading_satellite("../tests/elliptical_orbit_test_1.json");
+  Satellite headless_satellite("../tests/elliptical_orbit_test_1.json");
+  const double epsilon = pow(10.0, -12);
+  double reading_timestep = 1;
+  double headless_timestep = 1;
+  for (size_t step_ind = 0; step_ind < 200; step_ind++) {
+    reading_timestep =
+        reading_satellite.evolve_RK45(epsilon, reading_timestep, false).first;
+    reading_satellite.get_orbital_element("True Anomaly");
+    reading_satellite.get_orbital_element("Orbital Rate");
+    reading_satellite.get_attitude_val("Pitch");
+    headless_timestep =
+        headless_satellite.evolve_RK45(epsilon, headless_timestep, false)
+            .first;
+  }
+  EXPECT_EQ(reading_satellite.get_instantaneous_time(),
+            headless_satellite.get_instantaneous_time());
+  std::array<double, 6> reading_elements =
+      reading_satellite.get_orbital_elements();
+  std::array<double, 6> headless_elements =
+      headless_satellite.get_orbital_elements();
+  for (size_t ind = 0; ind < reading_elements.size(); ind++) {
+    EXPECT_EQ(reading_elements.at(ind), headless_elements.at(ind))
+        << "Orbital element mismatch at index " << ind << "\n";
+  }
+  EXPECT_EQ(reading_satellite.get_orbital_element("Orbital Rate"),
+            headless_satellite.get_orbital_element("Orbital Rate"));
+  std::array<std::string, 3> angle_names = {"Roll", "Pitch", "Yaw"};
+  for (const std::string& angle_name : angle_names) {
+    EXPECT_EQ(reading_satellite.get_attitude_val(angle_name),
+              headless_satellite.get_attitude_val(angle_name))
+        << "Mismatch in " << angle_name << "\n";
+  }
+  // The radius from the refreshed perifocal position matches the ECI one
+  EXPECT_NEAR(headless_satellite.get_radius(),
+              headless_satellite.get_radius_ECI(),
+              pow(10.0, -6) * headless_satellite.get_radius_ECI());
+
+  // A state which can't be evolved further is reported by the step that
+  // reaches it, without any derived quantity having been read
+  Satellite diverging_satellite("../tests/elliptical_orbit_test_1.json");
+  diverging_satellite.add_impulsive_maneuver({NAN, 0, 0}, 0,
+                                             ManeuverFrame::ECI);
+  EXPECT_EQ(diverging_satellite.evolve_RK45(epsilon, 1, false).second, 2);
+}
+
+TEST(MiscTests, SatelliteStoreTest1) {
+  // Names and plotting colors can be read through the store or from the
+  // stored satellites, and propagating through a handle updates the satellite
+  // held by the store
+  Satellite elliptical_satellite("../tests/elliptical_orbit_test_1.json");
+  elliptical_satellite.plotting_color_ = "red";
+  std::vector<Satellite> satellite_vector = {
+      elliptical_satellite,
+      Satellite("../tests/circular_orbit_test_1_input.json")};
+  SatelliteStore satellite_store(satellite_vector);
+  SatelliteHandle added_handle =
+      satellite_store.add_satellite("../tests/elliptical_orbit_test_2.json");
+  EXPECT_EQ(satellite_store.size(), 3);
+  EXPECT_EQ(added_handle.index, 2);
+  std::vector<SatelliteHandle> handles = satellite_store.get_handles();
+  EXPECT_EQ(satellite_store.get_name(handles.at(0)), "Elliptical_Test_1");
+  EXPECT_EQ(satellite_store.get_plotting_color(handles.at(0)), "red");
+  EXPECT_EQ(satellite_store.get_name(handles.at(1)), "Circ_Test_1");
+  EXPECT_EQ(satellite_store.get_plotting_color(handles.at(1)), "");
+  EXPECT_EQ(satellite_store.get_satellite(handles.at(0)).get_name(),
+            "Elliptical_Test_1");
+  EXPECT_EQ(satellite_store.get_satellite(handles.at(0)).plotting_color_,
+            "red");
+
+  const double epsilon = pow(10.0, -12);
+  double store_timestep = 1;
+  double reference_timestep = 1;
+  for (size_t step_ind = 0; step_ind < 50; step_ind++) {
+    Satellite& stored_satellite = satellite_store.get_satellite(handles.at(0));
+    store_timestep =
+        stored_satellite.evolve_RK45(epsilon, store_timestep, false).first;
+    reference_timestep =
+        elliptical_satellite.evolve_RK45(epsilon, reference_timestep, false)
+            .first;
+  }
+  std::array<double, 3> stored_position =
+      satellite_store.get_satellite(handles.at(0)).get_ECI_position();
+  std::array<double, 3> reference_position =
+      elliptical_satellite.get_ECI_position();
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_EQ(stored_position.at(ind), reference_position.at(ind));
+  }
+  // The other satellites weren't propagated
+  EXPECT_EQ(
+      satellite_store.get_satellite(handles.at(1)).get_instantaneous_time(), 0);
+}
+
+TEST(MiscTests, CheckpointRestartTest1) {
+  // Resuming from a checkpoint should reproduce the uninterrupted run exactly,
+  // through later thrust, torque and maneuver events
+  Satellite test_satellite("../tests/elliptical_orbit_test_1.json");
+  test_satellite.add_LVLH_thrust_profile({0, 1, 0}, 0.5, 100, 900, 300);
+  test_satellite.add_bodyframe_torque_profile({0.001, 0, -0.002}, 50, 400);
+  test_satellite.add_impulsive_maneuver({0, 2, 0}, 1500);
+  const double epsilon = pow(10.0, -12);
+  double timestep = 1;
+  // Checkpointing partway through the torque profile, before the burn
+  while (test_satellite.get_instantaneous_time() < 80) {
+    timestep = test_satellite.evolve_RK45(epsilon, timestep, true, false, {},
+                                          true, false)
+                   .first;
+  }
+  save_checkpoint("checkpoint_test_1.bin", test_satellite, timestep);
+  std::pair<Satellite, double> restored_satellite_and_timestep =
+      load_checkpoint("checkpoint_test_1.bin");
+  Satellite restored_satellite = restored_satellite_and_timestep.first;
+  double restored_timestep = restored_satellite_and_timestep.second;
+  EXPECT_EQ(restored_timestep, timestep);
+  EXPECT_EQ(restored_satellite.get_name(), test_satellite.get_name());
+
+  while (test_satellite.get_instantaneous_time() < 2000) {
+    timestep = test_satellite.evolve_RK45(epsilon, timestep, true, false, {},
+                                          true, false)
+                   .first;
+    restored_timestep =
+        restored_satellite
+            .evolve_RK45(epsilon, restored_timestep, true, false, {}, true,
+                         false)
+            .first;
+  }
+  EXPECT_EQ(restored_satellite.get_instantaneous_time(),
+            test_satellite.get_instantaneous_time());
+  EXPECT_EQ(restored_satellite.get_mass(), test_satellite.get_mass());
+  std::array<double, 3> position = test_satellite.get_ECI_position();
+  std::array<double, 3> velocity = test_satellite.get_ECI_velocity();
+  std::array<double, 3> restored_position =
+      restored_satellite.get_ECI_position();
+  std::array<double, 3> restored_velocity =
+      restored_satellite.get_ECI_velocity();
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_EQ(restored_position.at(ind), position.at(ind));
+    EXPECT_EQ(restored_velocity.at(ind), velocity.at(ind));
+  }
+  std::array<std::string, 7> attitude_val_names = {
+      "q_0", "q_1", "q_2", "q_3", "omega_x", "omega_y", "omega_z"};
+  for (const std::string& attitude_val_name : attitude_val_names) {
+    EXPECT_EQ(restored_satellite.get_attitude_val(attitude_val_name),
+              test_satellite.get_attitude_val(attitude_val_name))
+        << "Mismatch in " << attitude_val_name << "\n";
+  }
+
+  // Round trip of a store, keeping names and plotting colors
+  SatelliteStore satellite_store(std::vector<Satellite>{
+      test_satellite, Satellite("../tests/circular_orbit_test_1_input.json")});
+  save_store_checkpoint("checkpoint_test_2.bin", satellite_store, {10, 20});
+  std::pair<SatelliteStore, std::vector<double>> restored_store_and_timesteps =
+      load_store_checkpoint("checkpoint_test_2.bin");
+  SatelliteStore& restored_store = restored_store_and_timesteps.first;
+  EXPECT_EQ(restored_store.size(), 2);
+  EXPECT_EQ(restored_store_and_timesteps.second.at(1), 20);
+  EXPECT_EQ(restored_store.get_name({1}), "Circ_Test_1");
+  EXPECT_EQ(restored_store.get_satellite({0}).get_ECI_position().at(0),
+            position.at(0));
+  // A satellite checkpoint isn't accepted as a store checkpoint
+  EXPECT_THROW(load_store_checkpoint("checkpoint_test_1.bin"),
+               std::invalid_argument);
+}
+
+TEST(MiscTests, TrajectoryBranchTest1) {
+  // Branches forked from a common prefix share its samples, and propagating
+  // them in parallel gives the same result as propagating them one at a time
+  Satellite test_satellite("../tests/elliptical_orbit_test_1.json");
+  const double epsilon = pow(10.0, -10);
+  std::vector<ForceTerm> force_terms = {ForceTerm::central_body,
+                                        ForceTerm::J2, ForceTerm::thrust};
+  TrajectoryBranch reference_branch(test_satellite);
+  TrajectoryBranch prefix_branch(test_satellite);
+  EXPECT_EQ(reference_branch.propagate(500, epsilon, force_terms), 0);
+  EXPECT_EQ(prefix_branch.propagate(500, epsilon, force_terms), 0);
+  EXPECT_EQ(prefix_branch.get_satellite().get_instantaneous_time(), 500);
+  size_t num_prefix_samples = prefix_branch.get_num_samples();
+
+  std::vector<TrajectoryBranch> branches = prefix_branch.fork(3);
+  branches.at(1).get_satellite().add_LVLH_thrust_profile({0, 1, 0}, 0.5, 600,
+                                                         900);
+  branches.at(2).get_satellite().add_LVLH_thrust_profile({1, 0, 0}, 0.5, 600,
+                                                         900);
+  std::vector<int> error_codes =
+      propagate_branches(branches, 1500, epsilon, force_terms, {}, 3);
+  EXPECT_EQ(reference_branch.propagate(1500, epsilon, force_terms), 0);
+
+  for (size_t branch_ind = 0; branch_ind < branches.size(); branch_ind++) {
+    EXPECT_EQ(error_codes.at(branch_ind), 0);
+    const TrajectoryBranch& branch = branches.at(branch_ind);
+    // The prefix samples are stored once, not copied into each branch
+    EXPECT_EQ(&branch.get_sample(num_prefix_samples - 1),
+              &prefix_branch.get_sample(num_prefix_samples - 1));
+    EXPECT_EQ(branch.get_sample(0).t, 0);
+    EXPECT_EQ(branch.get_sample(branch.get_num_samples() - 1).t, 1500);
+  }
+  // The unmodified branch follows the unforked trajectory exactly
+  std::vector<TrajectorySample> reference_trajectory =
+      reference_branch.get_trajectory();
+  std::vector<TrajectorySample> branch_trajectory =
+      branches.at(0).get_trajectory();
+  EXPECT_EQ(branch_trajectory.size(), reference_trajectory.size());
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_EQ(branch_trajectory.back().ECI_position.at(ind),
+              reference_trajectory.back().ECI_position.at(ind));
+  }
+  // The thrusting branches diverge from it and from each other
+  std::array<double, 3> final_position_0 =
+      branches.at(0).get_satellite().get_ECI_position();
+  std::array<double, 3> final_position_1 =
+      branches.at(1).get_satellite().get_ECI_position();
+  std::array<double, 3> final_position_2 =
+      branches.at(2).get_satellite().get_ECI_position();
+  EXPECT_TRUE(final_position_1 != final_position_0);
+  EXPECT_TRUE(final_position_2 != final_position_0);
+  EXPECT_TRUE(final_position_2 != final_position_1);
+
+  // Editing a branch's plan before the fork rewinds it into the shared
+  // prefix, which the other branches keep unchanged
+  TrajectorySample last_prefix_sample =
+      prefix_branch.get_sample(num_prefix_samples - 1);
+  EXPECT_EQ(branches.at(0).add_LVLH_thrust_profile(
+                ThrustProfileLVLH(100, 200, {0, 0, 0.5})),
+            0);
+  EXPECT_EQ(branches.at(0).get_sample(0).t, 0);
+  EXPECT_EQ(branches.at(0)
+                .get_sample(branches.at(0).get_num_samples() - 1)
+                .t,
+            1500);
+  EXPECT_TRUE(branches.at(0).get_satellite().get_ECI_position() !=
+              final_position_0);
+  EXPECT_EQ(branches.at(1).get_sample(num_prefix_samples - 1).ECI_position,
+            last_prefix_sample.ECI_position);
+}
+
+TEST(MiscTests, IncrementalRepropagationTest1) {
+  // Editing the thrust plan only re-propagates from the last checkpoint
+  // before the edit, and ends up where propagating the edited plan from the
+  // start would
+  Satellite test_satellite("../tests/elliptical_orbit_test_1.json");
+  const double epsilon = pow(10.0, -10);
+  std::vector<ForceTerm> force_terms = {ForceTerm::central_body,
+                                        ForceTerm::J2, ForceTerm::thrust};
+  TrajectoryBranch edited_branch(test_satellite);
+  edited_branch.set_checkpoint_interval(20);
+  EXPECT_EQ(edited_branch.propagate(3000, epsilon, force_terms), 0);
+  EXPECT_TRUE(edited_branch.get_num_checkpoints() > 2);
+
+  std::vector<std::vector<ThrustProfileLVLH>> plans = {
+      {ThrustProfileLVLH(2000, 2300, {0, 0.5, 0})},
+      {ThrustProfileLVLH(2000, 2300, {0, 0.5, 0}),
+       ThrustProfileLVLH(1000, 1200, {0.2, 0, 0.1})},
+      {ThrustProfileLVLH(1000, 1200, {0.2, 0, 0.1})}};
+  EXPECT_EQ(edited_branch.add_LVLH_thrust_profile(plans.at(0).at(0)), 0);
+  for (size_t plan_ind = 0; plan_ind < plans.size(); plan_ind++) {
+    if (plan_ind > 0) {
+      EXPECT_EQ(edited_branch.set_LVLH_thrust_profiles(plans.at(plan_ind)),
+                0);
+    }
+    Satellite reference_satellite("../tests/elliptical_orbit_test_1.json");
+    reference_satellite.set_LVLH_thrust_profiles(plans.at(plan_ind));
+    TrajectoryBranch reference_branch(reference_satellite);
+    EXPECT_EQ(reference_branch.propagate(3000, epsilon, force_terms), 0);
+
+    EXPECT_EQ(edited_branch.get_num_samples(),
+              reference_branch.get_num_samples());
+    std::vector<TrajectorySample> edited_trajectory =
+        edited_branch.get_trajectory();
+    std::vector<TrajectorySample> reference_trajectory =
+        reference_branch.get_trajectory();
+    for (size_t ind = 0; ind < 3; ind++) {
+      EXPECT_EQ(edited_trajectory.back().ECI_position.at(ind),
+                reference_trajectory.back().ECI_position.at(ind))
+          << "Mismatch for plan " << plan_ind << "\n";
+      EXPECT_EQ(edited_trajectory.back().ECI_velocity.at(ind),
+                reference_trajectory.back().ECI_velocity.at(ind))
+          << "Mismatch for plan " << plan_ind << "\n";
+    }
+    EXPECT_EQ(edited_trajectory.back().t, 3000);
+  }
+
+  // Forked branches share the checkpoints taken before the fork, and an edit
+  // to one branch doesn't change the plan the other branch rewinds to
+  std::vector<TrajectoryBranch> forked_branches = edited_branch.fork(2);
+  EXPECT_EQ(forked_branches.at(0).set_LVLH_thrust_profiles(plans.at(0)), 0);
+  ThrustProfileLVLH added_profile(500, 600, {0, 0, 0.3});
+  EXPECT_EQ(forked_branches.at(1).add_LVLH_thrust_profile(added_profile), 0);
+  std::vector<ThrustProfileLVLH> expected_plan = plans.back();
+  expected_plan.push_back(added_profile);
+  Satellite reference_satellite("../tests/elliptical_orbit_test_1.json");
+  reference_satellite.set_LVLH_thrust_profiles(expected_plan);
+  TrajectoryBranch reference_branch(reference_satellite);
+  EXPECT_EQ(reference_branch.propagate(3000, epsilon, force_terms), 0);
+  EXPECT_EQ(forked_branches.at(1).get_satellite().get_ECI_position(),
+            reference_branch.get_satellite().get_ECI_position());
+  EXPECT_EQ(forked_branches.at(1).get_satellite().get_ECI_velocity(),
+            reference_branch.get_satellite().get_ECI_velocity());
+}
+
+TEST(MiscTests, CatalogLoadingTest1) {
+  // JSON and CSV catalogs, loaded in parallel, give the same satellites as
+  // their individual input files, in catalog order, and the binary cache
+  // gives the same store back
+  std::vector<Satellite> individual_satellites = {
+      Satellite("../tests/elliptical_orbit_test_1.json"),
+      Satellite("../tests/circular_orbit_test_1_input.json"),
+      Satellite("../tests/elliptical_orbit_test_2.json")};
+  std::remove("catalog_test_cache.bin");
+  std::vector<SatelliteStore> catalog_stores = {};
+  catalog_stores.push_back(load_catalog("../tests/catalog_test_input.json", 2));
+  catalog_stores.push_back(load_catalog("../tests/catalog_test_input.csv", 3));
+  // The first call writes the cache, the second reads it
+  catalog_stores.push_back(load_catalog_cached(
+      "../tests/catalog_test_input.csv", "catalog_test_cache.bin", 2));
+  catalog_stores.push_back(load_catalog_cached(
+      "../tests/catalog_test_input.csv", "catalog_test_cache.bin", 2));
+  std::ifstream cache_filestream("catalog_test_cache.bin");
+  EXPECT_TRUE(cache_filestream.good());
+  // A cache with a valid header but a garbled satellite count is ignored
+  std::string cache_header(8 + 4 + 16, ' ');
+  cache_filestream.read(cache_header.data(), cache_header.size());
+  cache_filestream.close();
+  std::ofstream corrupted_cache_filestream("catalog_test_cache.bin",
+                                           std::ios::binary);
+  corrupted_cache_filestream << cache_header << std::string(8, '\xff');
+  corrupted_cache_filestream.close();
+  catalog_stores.push_back(load_catalog_cached(
+      "../tests/catalog_test_input.csv", "catalog_test_cache.bin", 2));
+
+  for (size_t store_ind = 0; store_ind < catalog_stores.size(); store_ind++) {
+    SatelliteStore& catalog_store = catalog_stores.at(store_ind);
+    EXPECT_EQ(catalog_store.size(), individual_satellites.size());
+    for (size_t ind = 0; ind < individual_satellites.size(); ind++) {
+      Satellite& individual_satellite = individual_satellites.at(ind);
+      EXPECT_EQ(catalog_store.get_name({ind}), individual_satellite.get_name());
+      EXPECT_EQ(catalog_store.get_satellite({ind}).get_ECI_position(),
+                individual_satellite.get_ECI_position())
+          << "Mismatch for store " << store_ind << ", satellite " << ind
+          << "\n";
+      EXPECT_EQ(catalog_store.get_satellite({ind}).get_ECI_velocity(),
+                individual_satellite.get_ECI_velocity());
+    }
+    EXPECT_EQ(catalog_store.get_plotting_color({1}), "red");
+    EXPECT_EQ(catalog_store.get_plotting_color({2}), "");
+    // Same epoch, so one shared environment
+    EXPECT_EQ(catalog_store.get_satellite({0}).get_environment(),
+              catalog_store.get_satellite({2}).get_environment());
+  }
+}
+
+TEST(MiscTests, SGP4PropagationTest1) {
+  // SGP4 states match the reference implementation's verification output
+  // (Vallado et al., AIAA 2006-6753) for satellite 00005, both directly and
+  // through Satellite::evolve_RK45 for satellites loaded from a TLE catalog
+  std::vector<TwoLineElementSet> element_sets =
+      load_TLE_file("../tests/sgp4_test_input.tle");
+  EXPECT_EQ(element_sets.size(), 3);
+  EXPECT_EQ(element_sets.at(0).name, "VANGUARD 1");
+  EXPECT_EQ(element_sets.at(0).catalog_number, 5);
+  EXPECT_DOUBLE_EQ(element_sets.at(0).epoch.get_julian_date(),
+                   2451723.28495062);
+  EXPECT_DOUBLE_EQ(element_sets.at(0).bstar, 0.28098e-4);
+  EXPECT_DOUBLE_EQ(element_sets.at(0).eccentricity, 0.1859667);
+  EXPECT_EQ(element_sets.at(2).name, "");
+
+  // Reference positions in km, at 0 and 360 minutes
+  std::vector<std::array<double, 3>> reference_positions = {
+      {7022.46529266, -1400.08296755, 0.03995155},
+      {-7154.03120202, -3783.17682504, -3536.19412294}};
+  std::vector<std::array<double, 3>> reference_velocities = {
+      {1.893841015, 6.405893759, 4.534807250},
+      {4.741887409, -4.151817765, -2.093935425}};
+  std::vector<double> reference_times = {0, 21600};
+  SGP4Propagator SGP4_propagator(element_sets);
+  for (size_t time_ind = 0; time_ind < reference_times.size(); time_ind++) {
+    std::array<double, 3> TEME_position = {0, 0, 0};
+    std::array<double, 3> TEME_velocity = {0, 0, 0};
+    EXPECT_EQ(SGP4_propagator.propagate_element_set(
+                  0, reference_times.at(time_ind), TEME_position,
+                  TEME_velocity),
+              0);
+    for (size_t ind = 0; ind < 3; ind++) {
+      EXPECT_NEAR(TEME_position.at(ind),
+                  reference_positions.at(time_ind).at(ind) * 1000.0, 1e-3);
+      EXPECT_NEAR(TEME_velocity.at(ind),
+                  reference_velocities.at(time_ind).at(ind) * 1000.0, 1e-6);
+    }
+  }
+
+  // The batch gives the same states as propagating element sets one by one
+  std::vector<double> batch_times = {21600, 600, 1800};
+  std::vector<std::array<double, 3>> batch_positions = {};
+  std::vector<std::array<double, 3>> batch_velocities = {};
+  std::vector<int> batch_error_codes = {};
+  SGP4_propagator.propagate(batch_times, batch_positions, batch_velocities,
+                            batch_error_codes);
+  for (size_t set_ind = 0; set_ind < element_sets.size(); set_ind++) {
+    std::array<double, 3> TEME_position = {0, 0, 0};
+    std::array<double, 3> TEME_velocity = {0, 0, 0};
+    EXPECT_EQ(SGP4_propagator.propagate_element_set(
+                  set_ind, batch_times.at(set_ind), TEME_position,
+                  TEME_velocity),
+              batch_error_codes.at(set_ind));
+    EXPECT_EQ(TEME_position, batch_positions.at(set_ind));
+    EXPECT_EQ(TEME_velocity, batch_velocities.at(set_ind));
+  }
+
+  // Satellites from a TLE catalog step with SGP4 through evolve_RK45
+  SatelliteStore catalog_store =
+      load_catalog("../tests/sgp4_test_input.tle", 2);
+  EXPECT_EQ(catalog_store.size(), 3);
+  EXPECT_EQ(catalog_store.get_name({1}), "ISS (ZARYA)");
+  // A store read back from the binary cache shares one propagator between
+  // its satellites, as the store loaded from the catalog does
+  std::remove("sgp4_catalog_test_cache.bin");
+  load_catalog_cached("../tests/sgp4_test_input.tle",
+                      "sgp4_catalog_test_cache.bin");
+  SatelliteStore cached_catalog_store = load_catalog_cached(
+      "../tests/sgp4_test_input.tle", "sgp4_catalog_test_cache.bin");
+  std::remove("sgp4_catalog_test_cache.bin");
+  std::shared_ptr<const SGP4Propagator> cached_SGP4_propagator =
+      cached_catalog_store.get_satellite({0}).get_SGP4_propagator();
+  EXPECT_EQ(cached_SGP4_propagator->get_num_element_sets(), 3);
+  for (size_t ind = 0; ind < cached_catalog_store.size(); ind++) {
+    Satellite& cached_satellite = cached_catalog_store.get_satellite({ind});
+    EXPECT_EQ(cached_satellite.get_SGP4_propagator(), cached_SGP4_propagator);
+    EXPECT_EQ(cached_satellite.get_SGP4_element_set_index(), ind);
+    EXPECT_EQ(cached_satellite.get_ECI_position(),
+              catalog_store.get_satellite({ind}).get_ECI_position());
+  }
+  Satellite& vanguard = catalog_store.get_satellite({0});
+  EXPECT_TRUE(vanguard.get_SGP4_propagation());
+  double timestep = 60;
+  while (vanguard.get_instantaneous_time() < 21600) {
+    std::pair<double, int> output = vanguard.evolve_RK45(1e-9, timestep);
+    EXPECT_EQ(output.second, 0);
+    timestep = output.first;
+  }
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_NEAR(vanguard.get_ECI_position().at(ind),
+                reference_positions.at(1).at(ind) * 1000.0, 1e-3);
+  }
+
+  // Checkpoints keep the element set, and numerical integration continues
+  // from the SGP4 state once SGP4 is disabled
+  std::stringstream checkpoint_stream;
+  vanguard.write_checkpoint(checkpoint_stream);
+  Satellite restored_vanguard(checkpoint_stream);
+  EXPECT_TRUE(restored_vanguard.get_SGP4_propagation());
+  restored_vanguard.evolve_RK45(1e-9, 60);
+  vanguard.evolve_RK45(1e-9, 60);
+  EXPECT_EQ(restored_vanguard.get_ECI_position(), vanguard.get_ECI_position());
+  vanguard.set_SGP4_propagation(false);
+  std::pair<double, int> output = vanguard.evolve_RK45(1e-9, 1);
+  EXPECT_EQ(output.second, 0);
+  EXPECT_GT(vanguard.get_instantaneous_time(), 21660);
+
+  // Checksum errors and deep-space element sets are rejected
+  EXPECT_THROW(
+      parse_TLE("1 00005U 58002B   00179.78495062  .00000023  00000-0  "
+                "28098-4 0  4754",
+                "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 "
+                "10.82419157413667"),
+      std::invalid_argument);
+  TwoLineElementSet deep_space_element_set = element_sets.at(0);
+  deep_space_element_set.mean_motion = 2.0;
+  EXPECT_THROW(SGP4Propagator({deep_space_element_set}),
+               std::invalid_argument);
+  Satellite numerical_satellite("../tests/elliptical_orbit_test_1.json");
+  EXPECT_THROW(numerical_satellite.set_SGP4_propagation(true),
+               std::invalid_argument);
+}
+
+TEST(MiscTests, ConstellationGenerationTest1) {
+  // Satellites set up from elements in memory match those set up from the
+  // equivalent input file
+  SatelliteElements elements;
+  elements.name = "Elliptical_Test_1";
+  elements.inclination = 23.2;
+  elements.raan = 50;
+  elements.arg_of_periapsis = 29;
+  elements.eccentricity = 0.78;
+  elements.semimajor_axis = 11035;
+  elements.true_anomaly = 0;
+  elements.mass = 930;
+  Satellite satellite_from_elements(elements);
+  Satellite satellite_from_file("../tests/elliptical_orbit_test_1.json");
+  EXPECT_EQ(satellite_from_elements.get_ECI_position(),
+            satellite_from_file.get_ECI_position());
+  EXPECT_EQ(satellite_from_elements.get_ECI_velocity(),
+            satellite_from_file.get_ECI_velocity());
+  EXPECT_EQ(satellite_from_elements.get_name(), satellite_from_file.get_name());
+  EXPECT_EQ(satellite_from_elements.get_mass(), satellite_from_file.get_mass());
+
+  // Walker delta 53:24/3/1 and star 86.4:12/6/2 constellations at 550 km.
+  // Each satellite's position follows from its plane's RAAN and its argument
+  // of latitude
+  SatelliteElements constellation_template;
+  constellation_template.mass = 260;
+  constellation_template.raan = 10;
+  std::vector<WalkerPattern> patterns = {WalkerPattern::delta,
+                                         WalkerPattern::star};
+  std::vector<std::array<size_t, 3>> constellation_sizes = {{3, 8, 1},
+                                                            {6, 2, 2}};
+  std::vector<double> inclinations = {53, 86.4};
+  const double deg_to_rad = M_PI / 180.0;
+  const double orbit_radius = radius_Earth + 550000;
+  for (size_t pattern_ind = 0; pattern_ind < patterns.size(); pattern_ind++) {
+    const size_t num_planes = constellation_sizes.at(pattern_ind).at(0);
+    const size_t satellites_per_plane =
+        constellation_sizes.at(pattern_ind).at(1);
+    const size_t phasing = constellation_sizes.at(pattern_ind).at(2);
+    const double inclination = inclinations.at(pattern_ind) * deg_to_rad;
+    const double RAAN_spread =
+        (patterns.at(pattern_ind) == WalkerPattern::star) ? 180 : 360;
+    SatelliteStore constellation_store = generate_walker_constellation(
+        num_planes, satellites_per_plane, phasing, 550,
+        inclinations.at(pattern_ind), patterns.at(pattern_ind),
+        constellation_template);
+    EXPECT_EQ(constellation_store.size(), num_planes * satellites_per_plane);
+    for (size_t plane = 0; plane < num_planes; plane++) {
+      for (size_t slot = 0; slot < satellites_per_plane; slot++) {
+        SatelliteHandle handle = {plane * satellites_per_plane + slot};
+        EXPECT_EQ(constellation_store.get_name(handle),
+                  "Walker_" + std::to_string(plane) + "_" +
+                      std::to_string(slot));
+        Satellite& satellite = constellation_store.get_satellite(handle);
+        EXPECT_EQ(satellite.get_mass(), 260);
+        double RAAN = (10 + plane * RAAN_spread / num_planes) * deg_to_rad;
+        double argument_of_latitude =
+            (slot * 360.0 / satellites_per_plane +
+             plane * 360.0 * phasing / (num_planes * satellites_per_plane)) *
+            deg_to_rad;
+        std::array<double, 3> expected_position = {
+            orbit_radius * (cos(RAAN) * cos(argument_of_latitude) -
+                            sin(RAAN) * sin(argument_of_latitude) *
+                                cos(inclination)),
+            orbit_radius * (sin(RAAN) * cos(argument_of_latitude) +
+                            cos(RAAN) * sin(argument_of_latitude) *
+                                cos(inclination)),
+            orbit_radius * sin(argument_of_latitude) * sin(inclination)};
+        for (size_t ind = 0; ind < 3; ind++) {
+          EXPECT_NEAR(satellite.get_ECI_position().at(ind),
+                      expected_position.at(ind), 1e-6)
+              << "Mismatch for plane " << plane << ", slot " << slot << "\n";
+        }
+      }
+    }
+    EXPECT_EQ(constellation_store.get_satellite({0}).get_environment(),
+              constellation_store.get_satellite({1}).get_environment());
+  }
+
+  EXPECT_THROW(generate_walker_constellation(3, 8, 3, 550, 53),
+               std::invalid_argument);
+}
+
+TEST(MiscTests, LockstepSchedulerTest1) {
+  // Split epochs keep the seconds in [0, 86400) and differences exact
+  AbsoluteEpoch epoch_1(2460676, -10.5);
+  EXPECT_EQ(epoch_1.day, 2460675);
+  EXPECT_EQ(epoch_1.seconds, 86389.5);
+  AbsoluteEpoch epoch_2 = epoch_1.add_seconds(3 * 86400.0 + 20.25);
+  EXPECT_EQ(epoch_2.day, 2460679);
+  EXPECT_EQ(epoch_2.seconds, 9.75);
+  EXPECT_EQ(epoch_2.seconds_since(epoch_1), 3 * 86400.0 + 20.25);
+  EXPECT_TRUE(epoch_1 < epoch_2);
+  EXPECT_EQ(AbsoluteEpoch::from_julian_date(2460676.25),
+            AbsoluteEpoch(2460676, 21600));
+  json epoch_input_data = {
+      {"Inclination", 45},  {"RAAN", 0},  {"Argument of Periapsis", 0},
+      {"Eccentricity", 0},  {"Semimajor Axis", 7000},
+      {"True Anomaly", 0},  {"Mass", 1},  {"Name", "Epoch_Test"},
+      {"Epoch", {2460676, 43200.125}}};
+  EXPECT_EQ(Satellite::from_JSON(epoch_input_data).get_epoch(),
+            AbsoluteEpoch(2460676, 43200.125));
+
+  // Satellites starting at different epochs, numerically integrated or
+  // propagated with SGP4, are brought to common synchronization epochs
+  SatelliteElements elements;
+  elements.semimajor_axis = 7000;
+  elements.inclination = 45;
+  elements.epoch = AbsoluteEpoch(2451723, 25000);
+  SatelliteStore satellite_store;
+  satellite_store.add_satellite(Satellite(elements));
+  elements.epoch = elements.epoch.add_seconds(1000);
+  elements.true_anomaly = 90;
+  satellite_store.add_satellite(Satellite(elements));
+  std::vector<TwoLineElementSet> element_sets =
+      load_TLE_file("../tests/sgp4_test_input.tle");
+  satellite_store.add_satellite(Satellite::from_TLE(element_sets.at(0)));
+  const AbsoluteEpoch first_sync_epoch = elements.epoch;
+
+  LockstepScheduler scheduler(1e-9, {ForceTerm::central_body, ForceTerm::J2},
+                              {}, 10);
+  size_t num_callbacks = 0;
+  int error_code = scheduler.run(
+      satellite_store, first_sync_epoch, 600, 5,
+      [&](const AbsoluteEpoch& input_sync_epoch,
+          SatelliteStore& input_satellite_store) {
+        EXPECT_EQ(input_sync_epoch.seconds_since(first_sync_epoch),
+                  600.0 * num_callbacks);
+        for (const SatelliteHandle& handle :
+             input_satellite_store.get_handles()) {
+          EXPECT_NEAR(input_satellite_store.get_satellite(handle)
+                          .get_current_epoch()
+                          .seconds_since(input_sync_epoch),
+                      0, 1e-9)
+              << "Mismatch for satellite " << handle.index << "\n";
+        }
+        num_callbacks++;
+      });
+  EXPECT_EQ(error_code, 0);
+  EXPECT_EQ(num_callbacks, 5);
+  EXPECT_EQ(satellite_store.get_satellite({0}).get_instantaneous_time(),
+            1000 + 2400);
+  EXPECT_EQ(satellite_store.get_satellite({1}).get_instantaneous_time(), 2400);
+  // The adapted step size carries over between synchronizations
+  EXPECT_NE(scheduler.get_next_timestep({0}), 10);
+
+  // The SGP4 satellite matches SGP4 evaluated directly at the last epoch
+  SGP4Propagator SGP4_propagator({element_sets.at(0)});
+  std::array<double, 3> TEME_position = {0, 0, 0};
+  std::array<double, 3> TEME_velocity = {0, 0, 0};
+  SGP4_propagator.propagate_element_set(
+      0,
+      first_sync_epoch.add_seconds(2400).seconds_since(
+          element_sets.at(0).epoch),
+      TEME_position, TEME_velocity);
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_NEAR(satellite_store.get_satellite({2}).get_ECI_position().at(ind),
+                TEME_position.at(ind), 1e-6);
+  }
+
+  EXPECT_THROW(scheduler.synchronize(satellite_store, first_sync_epoch),
+               std::invalid_argument);
+}
+
+TEST(MiscTests, CompensatedSummationTest1) {
+  // Compensated summation of many small increments stays at the correctly
+  // rounded sum, while plain summation drifts away from it
+  double plain_sum = 0;
+  double compensated_sum = 0;
+  double compensation = 0;
+  for (size_t ind = 0; ind < 1000000; ind++) {
+    plain_sum += 0.1;
+    add_compensated(compensated_sum, compensation, 0.1);
+  }
+  EXPECT_EQ(compensated_sum, 100000);
+  EXPECT_NE(plain_sum, 100000);
+
+  SatelliteElements elements;
+  elements.semimajor_axis = 7000;
+  elements.inclination = 45;
+  Satellite compensated_satellite(elements);
+  Satellite plain_satellite(elements);
+  plain_satellite.set_compensated_summation(false);
+  Satellite split_time_satellite(elements);
+  split_time_satellite.set_split_time(true);
+  std::vector<ForceTerm> force_terms = {ForceTerm::central_body};
+  const double timestep = 0.1;
+  const size_t num_steps = 20000;
+  for (size_t ind = 0; ind < num_steps; ind++) {
+    compensated_satellite.evolve_RK45(1e-3, timestep, force_terms);
+    plain_satellite.evolve_RK45(1e-3, timestep, force_terms);
+    split_time_satellite.evolve_RK45(1e-3, timestep, force_terms);
+    if (ind == num_steps / 2) {
+      save_checkpoint("checkpoint_test_compensated.bin", split_time_satellite,
+                      timestep);
+    }
+  }
+  EXPECT_EQ(compensated_satellite.get_instantaneous_time(), 2000);
+  EXPECT_NE(plain_satellite.get_instantaneous_time(), 2000);
+  EXPECT_EQ(split_time_satellite.get_instantaneous_time(), 2000);
+  EXPECT_EQ(split_time_satellite.get_current_epoch(),
+            elements.epoch.add_seconds(2000));
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_NEAR(compensated_satellite.get_ECI_position().at(ind),
+                plain_satellite.get_ECI_position().at(ind), 1e-3);
+  }
+
+  // The compensation terms and split time are restored from a checkpoint,
+  // so the resumed run matches the uninterrupted one exactly
+  std::pair<Satellite, double> restored_pair =
+      load_checkpoint("checkpoint_test_compensated.bin");
+  std::remove("checkpoint_test_compensated.bin");
+  Satellite restored_satellite = restored_pair.first;
+  EXPECT_TRUE(restored_satellite.get_split_time());
+  EXPECT_TRUE(restored_satellite.get_compensated_summation());
+  for (size_t ind = num_steps / 2 + 1; ind < num_steps; ind++) {
+    restored_satellite.evolve_RK45(1e-3, restored_pair.second, force_terms);
+  }
+  EXPECT_EQ(restored_satellite.get_instantaneous_time(),
+            split_time_satellite.get_instantaneous_time());
+  EXPECT_EQ(restored_satellite.get_ECI_position(),
+            split_time_satellite.get_ECI_position());
+  EXPECT_EQ(restored_satellite.get_ECI_velocity(),
+            split_time_satellite.get_ECI_velocity());
+
+  // Switching split time off keeps the time
+  split_time_satellite.set_split_time(false);
+  EXPECT_EQ(split_time_satellite.get_instantaneous_time(), 2000);
+
+  // With split time, disabling compensated summation also leaves the
+  // fraction of a second to plain summation, which drifts for small steps
+  Satellite compensated_split_time_satellite(elements);
+  compensated_split_time_satellite.set_split_time(true);
+  Satellite plain_split_time_satellite(elements);
+  plain_split_time_satellite.set_split_time(true);
+  plain_split_time_satellite.set_compensated_summation(false);
+  for (size_t ind = 0; ind < 2000; ind++) {
+    compensated_split_time_satellite.evolve_RK45(1e-3, 0.01, force_terms);
+    plain_split_time_satellite.evolve_RK45(1e-3, 0.01, force_terms);
+  }
+  EXPECT_EQ(compensated_split_time_satellite.get_instantaneous_time(), 20);
+  EXPECT_NE(plain_split_time_satellite.get_instantaneous_time(), 20);
+}
@@ -0,0 +1,378 @@
+#include <gtest/gtest.h>
+
+#include <iostream>
+
+#include "Satellite.h"
+#include "ephemeris.h"
+#include "force_model.h"
+#include "utils.h"
+
+// Tolerance on the difference between the Chebyshev-cached and analytic Sun
+// and Moon positions, relative to their distance from the Earth
+const double ephemeris_relative_tolerance = pow(10.0, -9);
+const double epsilon = pow(10.0, -5);
+
+TEST(PerturbationTests, ChebyshevEphemerisMatchesAnalytic1) {
+  const double epoch_julian_date = 2460676.5;
+  SunMoonEphemeris ephemeris(epoch_julian_date);
+  ephemeris.prefit(0, 5 * seconds_per_day);
+  for (double t = 0; t < 5 * seconds_per_day; t += 3917.3) {
+    double julian_date = epoch_julian_date + t / seconds_per_day;
+    std::array<double, 3> cached_sun = ephemeris.get_sun_position_ECI(t);
+    std::array<double, 3> analytic_sun =
+        calculate_sun_position_ECI_analytic(julian_date);
+    std::array<double, 3> cached_moon = ephemeris.get_moon_position_ECI(t);
+    std::array<double, 3> analytic_moon =
+        calculate_moon_position_ECI_analytic(julian_date);
+    double sun_distance = 0;
+    double moon_distance = 0;
+    double sun_error = 0;
+    double moon_error = 0;
+    for (size_t ind = 0; ind < 3; ind++) {
+      sun_distance += pow(analytic_sun.at(ind), 2);
+      moon_distance += pow(analytic_moon.at(ind), 2);
+      sun_error += pow(cached_sun.at(ind) - analytic_sun.at(ind), 2);
+      moon_error += pow(cached_moon.at(ind) - analytic_moon.at(ind), 2);
+    }
+    EXPECT_TRUE(sqrt(sun_error / sun_distance) < ephemeris_relative_tolerance)
+        << "Cached Sun position didn't match analytic ephemeris at t=" << t
+        << ". Relative difference: " << sqrt(sun_error / sun_distance) << "\n";
+    EXPECT_TRUE(sqrt(moon_error / moon_distance) < ephemeris_relative_tolerance)
+        << "Cached Moon position didn't match analytic ephemeris at t=" << t
+        << ". Relative difference: " << sqrt(moon_error / moon_distance)
+        << "\n";
+  }
+  // 5 days of 12-hour segments, plus the one starting exactly at the end
+  EXPECT_EQ(ephemeris.get_num_fitted_segments(), 11);
+
+  EXPECT_THROW(SunMoonEphemeris(epoch_julian_date, 0), std::invalid_argument);
+  EXPECT_THROW(SunMoonEphemeris(epoch_julian_date, -43200),
+               std::invalid_argument);
+  EXPECT_THROW(SunMoonEphemeris(epoch_julian_date, 43200, 0),
+               std::invalid_argument);
+}
+
+TEST(PerturbationTests, ThirdBodyAccelerationMagnitudeGEO1) {
+  // At GEO, the lunar and solar perturbing accelerations should be on the
+  // order of 1e-5 m/s^2 and 5e-6 m/s^2 respectively (e.g., Montenbruck & Gill,
+  // Satellite Orbits, fig. 3.1)
+  Satellite test_satellite("../tests/geostationary_test_input.json");
+  std::array<double, 3> position = test_satellite.get_ECI_position();
+  std::shared_ptr<SunMoonEphemeris> ephemeris =
+      test_satellite.get_sun_moon_ephemeris();
+  std::array<double, 3> sun_acceleration = calculate_third_body_acceleration(
+      position, ephemeris->get_sun_position_ECI(0), mu_Sun);
+  std::array<double, 3> moon_acceleration = calculate_third_body_acceleration(
+      position, ephemeris->get_moon_position_ECI(0), mu_Moon);
+  double sun_magnitude =
+      sqrt(pow(sun_acceleration.at(0), 2) + pow(sun_acceleration.at(1), 2) +
+           pow(sun_acceleration.at(2), 2));
+  double moon_magnitude =
+      sqrt(pow(moon_acceleration.at(0), 2) + pow(moon_acceleration.at(1), 2) +
+           pow(moon_acceleration.at(2), 2));
+  EXPECT_TRUE((sun_magnitude > pow(10.0, -7)) &&
+              (sun_magnitude < pow(10.0, -5)))
+      << "Solar perturbing acceleration at GEO out of expected range: "
+      << sun_magnitude << "\n";
+  EXPECT_TRUE((moon_magnitude > pow(10.0, -7)) &&
+              (moon_magnitude < 3 * pow(10.0, -5)))
+      << "Lunar perturbing acceleration at GEO out of expected range: "
+      << moon_magnitude << "\n";
+}
+
+TEST(PerturbationTests, ThirdBodyEvolution1) {
+  // Over a few hours at GEO, third-body perturbations should shift the
+  // satellite by something on the order of tens of meters to kilometers
+  Satellite unperturbed_satellite("../tests/geostationary_test_input.json");
+  Satellite perturbed_satellite("../tests/geostationary_test_input.json");
+  const double sim_time = 3 * 3600;  // s
+  // Fixed timestep, small enough that no steps get rejected, so both
+  // satellites end up at the same time
+  const double test_timestep = 10;  // s
+  while (unperturbed_satellite.get_instantaneous_time() < sim_time) {
+    unperturbed_satellite.evolve_RK45(epsilon, test_timestep, false, false, {},
+                                      false);
+    perturbed_satellite.evolve_RK45(epsilon, test_timestep, false, false, {},
+                                    true);
+  }
+  ASSERT_EQ(unperturbed_satellite.get_instantaneous_time(),
+            perturbed_satellite.get_instantaneous_time());
+  std::array<double, 3> unperturbed_position =
+      unperturbed_satellite.get_ECI_position();
+  std::array<double, 3> perturbed_position =
+      perturbed_satellite.get_ECI_position();
+  double separation =
+      sqrt(pow(perturbed_position.at(0) - unperturbed_position.at(0), 2) +
+           pow(perturbed_position.at(1) - unperturbed_position.at(1), 2) +
+           pow(perturbed_position.at(2) - unperturbed_position.at(2), 2));
+  EXPECT_TRUE((separation > 1) && (separation < pow(10.0, 4)))
+      << "Separation due to third-body perturbations out of expected range: "
+      << separation << "\n";
+}
+
+TEST(PerturbationTests, ShadowFunctionLimits1) {
+  // Sun along +x at 1 AU. A satellite on the sunward side is fully lit, one
+  // directly behind the Earth is in umbra, and one with the Sun's center on
+  // the Earth's limb sees half of the solar disk
+  std::array<double, 3> sun_position = {astronomical_unit, 0, 0};
+  double r = radius_Earth + 700000;
+  std::array<double, 3> sunlit_position = {r, 0, 0};
+  std::array<double, 3> umbra_position = {-r, 0, 0};
+  // Sun center on the Earth's limb (neglecting the parallax of the Sun, which
+  // shifts the apparent separation by ~1% of the Sun's apparent radius here)
+  double limb_angle = asin(radius_Earth / r);
+  std::array<double, 3> limb_position = {-r * cos(limb_angle),
+                                         r * sin(limb_angle), 0};
+  EXPECT_NEAR(calculate_shadow_function(sunlit_position, sun_position), 1.0,
+              pow(10.0, -12));
+  EXPECT_NEAR(calculate_shadow_function(umbra_position, sun_position), 0.0,
+              pow(10.0, -12));
+  EXPECT_NEAR(calculate_shadow_function(limb_position, sun_position), 0.5,
+              2 * pow(10.0, -2));
+}
+
+TEST(PerturbationTests, ShadowFunctionSmoothness1) {
+  // Sweeping the satellite from behind the Earth out through the shadow
+  // boundary (near 1.12 rad from the anti-Sun direction at this altitude), the
+  // shadow function should change monotonically and without jumps
+  std::array<double, 3> sun_position = {astronomical_unit, 0, 0};
+  double r = radius_Earth + 700000;
+  double previous_visible_fraction = 0;
+  const double angle_increment = pow(10.0, -5);
+  for (double angle = 1.0; angle < 1.3; angle += angle_increment) {
+    std::array<double, 3> position = {-r * cos(angle), r * sin(angle), 0};
+    double visible_fraction =
+        calculate_shadow_function(position, sun_position);
+    EXPECT_TRUE(visible_fraction >= previous_visible_fraction)
+        << "Shadow function not monotonic at angle " << angle << "\n";
+    EXPECT_TRUE(visible_fraction - previous_visible_fraction < 0.01)
+        << "Shadow function jumped at angle " << angle << "\n";
+    previous_visible_fraction = visible_fraction;
+  }
+  EXPECT_NEAR(previous_visible_fraction, 1.0, pow(10.0, -3));
+}
+
+TEST(PerturbationTests, SolarRadiationPressureMagnitude1) {
+  // In full sunlight at ~1 AU, the SRP acceleration should be
+  // P*C_R*A/m, directed away from the Sun
+  std::array<double, 3> sun_position = {astronomical_unit, 0, 0};
+  std::array<double, 3> position = {radius_Earth + 35786000, 0, 0};
+  const double A_srp = 20;  // m^2
+  const double C_R = 1.3;
+  const double mass = 2000;  // kg
+  std::array<double, 3> srp_acceleration =
+      calculate_solar_radiation_pressure_acceleration(position, sun_position,
+                                                      A_srp, C_R, mass);
+  double expected_magnitude = solar_radiation_pressure_1AU * C_R * A_srp /
+                              mass *
+                              pow(astronomical_unit /
+                                      (astronomical_unit - position.at(0)),
+                                  2);
+  EXPECT_NEAR(srp_acceleration.at(0), -expected_magnitude, pow(10.0, -15));
+  EXPECT_NEAR(srp_acceleration.at(1), 0, pow(10.0, -15));
+  EXPECT_NEAR(srp_acceleration.at(2), 0, pow(10.0, -15));
+}
+
+TEST(PerturbationTests, ForceModelPipelineMatchesRuntime1) {
+  // A compile-time force model pipeline and the runtime-selected force model
+  // with the same terms enabled should give identical accelerations
+  PiecewiseConstantSchedule<4> thrust_schedule;
+  thrust_schedule.add_window(0, 100, {0.5, 0.2, -0.1, 0});
+  EnvironmentCache environment(std::make_shared<SunMoonEphemeris>(2460676.5),
+                               std::make_shared<EarthOrientation>(2460676.5));
+  ForceModelContext context;
+  context.spacecraft_mass_ = 500;
+  context.inclination_ = 0.9;
+  context.arg_of_periapsis_ = 0.3;
+  context.true_anomaly_ = 1.2;
+  context.F_10_ = 150;
+  context.A_p_ = 10;
+  context.A_s_ = 4;
+  context.A_srp_ = 4;
+  context.thrust_schedule_LVLH_ = &thrust_schedule;
+  context.environment_ = &environment;
+  context.force_term_mask_ = J2DragThrustForceModel::force_term_mask;
+
+  std::array<double, 3> position = {radius_Earth + 300000, 1000, 2000};
+  std::array<double, 3> velocity = {10, 7700, 100};
+  for (double t : {0.0, 50.0, 150.0}) {
+    std::array<double, 3> pipeline_acceleration =
+        J2DragThrustForceModel::calculate_acceleration(position, velocity, t,
+                                                       context);
+    std::array<double, 3> runtime_acceleration =
+        RuntimeForceModel::calculate_acceleration(position, velocity, t,
+                                                  context);
+    for (size_t ind = 0; ind < 3; ind++) {
+      EXPECT_EQ(pipeline_acceleration.at(ind), runtime_acceleration.at(ind))
+          << "Mismatch in component " << ind << " at t=" << t << "\n";
+    }
+  }
+
+  // Enabling more terms at runtime should change the acceleration
+  context.force_term_mask_ |=
+      force_term_bit(ForceTerm::third_body) |
+      force_term_bit(ForceTerm::solar_radiation_pressure);
+  std::array<double, 3> full_acceleration =
+      RuntimeForceModel::calculate_acceleration(position, velocity, 0, context);
+  std::array<double, 3> partial_acceleration =
+      J2DragThrustForceModel::calculate_acceleration(position, velocity, 0,
+                                                     context);
+  EXPECT_NE(full_acceleration.at(0), partial_acceleration.at(0));
+}
+
+TEST(PerturbationTests, ForceTermListMatchesFlags1) {
+  // Evolving with the on/off flags and with the equivalent list of force
+  // terms should give identical trajectories
+  Satellite flags_satellite("../tests/geostationary_test_input.json");
+  Satellite list_satellite("../tests/geostationary_test_input.json");
+  const double test_timestep = 10;  // s
+  for (size_t step = 0; step < 100; step++) {
+    flags_satellite.evolve_RK45(epsilon, test_timestep, true, false, {}, true,
+                                true);
+    list_satellite.evolve_RK45(
+        epsilon, test_timestep,
+        {ForceTerm::central_body, ForceTerm::J2, ForceTerm::third_body,
+         ForceTerm::solar_radiation_pressure});
+  }
+  ASSERT_EQ(flags_satellite.get_instantaneous_time(),
+            list_satellite.get_instantaneous_time());
+  std::array<double, 3> flags_position = flags_satellite.get_ECI_position();
+  std::array<double, 3> list_position = list_satellite.get_ECI_position();
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_EQ(flags_position.at(ind), list_position.at(ind));
+  }
+}
+
+TEST(PerturbationTests, AltitudeFidelitySwitching1) {
+  // On an orbit from 200 km to 30000 km altitude, with a 10^-3 m/s^2 error
+  // budget, J2 and drag should each be dropped once on the way up to apogee
+  // and restored once on the way back down, at altitudes consistent with the
+  // budget and hysteresis. Drag is dropped again shortly after the next
+  // perigee
+  Satellite test_satellite("../tests/fidelity_switching_test_input.json");
+  const double error_budget = pow(10.0, -3);
+  const double hysteresis_ratio = 0.5;
+  const double mu = G * mass_Earth;
+  // Distances at which the J2 upper bound equals the budget, and the fraction
+  // of it at which J2 gets dropped
+  const double J2_enable_distance = pow(
+      3 * mu * J2_Earth * radius_Earth * radius_Earth / error_budget, 0.25);
+  const double J2_disable_distance =
+      pow(3 * mu * J2_Earth * radius_Earth * radius_Earth /
+              (hysteresis_ratio * error_budget),
+          0.25);
+  const unsigned int J2_bit = force_term_bit(ForceTerm::J2);
+  const unsigned int drag_bit = force_term_bit(ForceTerm::atmospheric_drag);
+
+  const double orbital_period = test_satellite.calculate_orbital_period();
+  std::vector<ForceTerm> force_terms = {
+      ForceTerm::central_body, ForceTerm::J2, ForceTerm::atmospheric_drag};
+  std::pair<double, double> drag_elements = {150, 10};
+  double test_timestep = 10;  // s
+  unsigned int previous_disabled_mask = 0;
+  int num_J2_switches = 0;
+  int num_drag_switches = 0;
+  double previous_distance = test_satellite.get_radius_ECI();
+  while (test_satellite.get_instantaneous_time() < orbital_period + 1000) {
+    test_timestep = test_satellite
+                        .evolve_RK45(epsilon, test_timestep, force_terms,
+                                     drag_elements)
+                        .first;
+    unsigned int disabled_mask = test_satellite.get_disabled_force_term_mask();
+    unsigned int switched_terms = disabled_mask ^ previous_disabled_mask;
+    if (switched_terms & J2_bit) {
+      num_J2_switches++;
+      // The switch is decided from the state at the start of the step
+      if (disabled_mask & J2_bit) {
+        EXPECT_GT(previous_distance, J2_disable_distance);
+      } else {
+        EXPECT_LE(previous_distance, J2_enable_distance);
+      }
+    }
+    if (switched_terms & drag_bit) {
+      num_drag_switches++;
+    }
+    previous_disabled_mask = disabled_mask;
+    previous_distance = test_satellite.get_radius_ECI();
+  }
+  EXPECT_EQ(num_J2_switches, 2);
+  EXPECT_EQ(num_drag_switches, 3);
+  EXPECT_EQ(test_satellite.get_disabled_force_term_mask(), drag_bit);
+
+  EXPECT_THROW(test_satellite.set_force_model_error_budget(-1),
+               std::invalid_argument);
+  EXPECT_THROW(test_satellite.set_force_model_error_budget(1, 1.5),
+               std::invalid_argument);
+}
+
+TEST(PerturbationTests, SharedEnvironmentLockstep1) {
+  // Two satellites with the same epoch stepped in lockstep through one shared
+  // environment should need no more Sun and Moon evaluations than a single
+  // satellite with its own environment, and should be unaffected by sharing
+  Satellite reference_satellite("../tests/geostationary_test_input.json");
+  std::vector<Satellite> satellite_vector = {
+      Satellite("../tests/geostationary_test_input.json"),
+      Satellite("../tests/geostationary_test_input.json")};
+  share_environment(satellite_vector);
+  ASSERT_EQ(satellite_vector.at(0).get_environment(),
+            satellite_vector.at(1).get_environment());
+  ASSERT_NE(satellite_vector.at(0).get_environment(),
+            reference_satellite.get_environment());
+
+  std::vector<ForceTerm> force_terms = {
+      ForceTerm::central_body, ForceTerm::third_body,
+      ForceTerm::solar_radiation_pressure};
+  const double sim_time = 3600;     // s
+  const double test_timestep = 10;  // s
+  while (reference_satellite.get_instantaneous_time() < sim_time) {
+    reference_satellite.evolve_RK45(epsilon, test_timestep, force_terms);
+    for (Satellite& current_satellite : satellite_vector) {
+      current_satellite.evolve_RK45(epsilon, test_timestep, force_terms);
+    }
+  }
+  EXPECT_EQ(
+      satellite_vector.at(0).get_environment()->get_num_sun_moon_evaluations(),
+      reference_satellite.get_environment()->get_num_sun_moon_evaluations());
+  for (Satellite& current_satellite : satellite_vector) {
+    ASSERT_EQ(current_satellite.get_instantaneous_time(),
+              reference_satellite.get_instantaneous_time());
+    for (size_t ind = 0; ind < 3; ind++) {
+      EXPECT_EQ(current_satellite.get_ECI_position().at(ind),
+                reference_satellite.get_ECI_position().at(ind))
+          << "Shared environment changed position component " << ind << "\n";
+    }
+  }
+}
+
+TEST(PerturbationTests, EnvironmentSpaceWeather1) {
+  // A space weather window covering the whole run should give the same drag
+  // as passing the same F_10 and A_p directly
+  Satellite direct_satellite("../tests/elliptical_orbit_test_4.json");
+  Satellite windowed_satellite("../tests/elliptical_orbit_test_4.json");
+  std::pair<double, double> drag_elements = {100, 120};
+  const double sim_time = 100;  // s
+  windowed_satellite.get_environment()->add_space_weather_window(
+      0, 2 * sim_time, drag_elements.first, drag_elements.second);
+  std::vector<ForceTerm> force_terms = {ForceTerm::central_body,
+                                        ForceTerm::atmospheric_drag};
+  const double test_timestep = 1;  // s
+  while (direct_satellite.get_instantaneous_time() < sim_time) {
+    direct_satellite.evolve_RK45(epsilon, test_timestep, force_terms,
+                                 drag_elements);
+    windowed_satellite.evolve_RK45(epsilon, test_timestep, force_terms);
+  }
+  ASSERT_EQ(direct_satellite.get_instantaneous_time(),
+            windowed_satellite.get_instantaneous_time());
+  for (size_t ind = 0; ind < 3; ind++) {
+    EXPECT_EQ(direct_satellite.get_ECI_velocity().at(ind),
+              windowed_satellite.get_ECI_velocity().at(ind))
+        << "Space weather window changed velocity component " << ind << "\n";
+  }
+
+  // Satellites with their own space weather keep their own environment
+  std::vector<Satellite> satellite_vector = {direct_satellite,
+                                             windowed_satellite};
+  share_environment(satellite_vector);
+  EXPECT_EQ(satellite_vector.at(1).get_environment(),
+            windowed_satellite.get_environment());
+}